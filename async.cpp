@@ -0,0 +1,84 @@
+#include "async.h"
+#include <algorithm>
+
+namespace d64lib::async {
+
+ThreadPool::ThreadPool(unsigned count)
+{
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads.reserve(count);
+    for (unsigned t = 0; t < count; ++t) {
+        threads.emplace_back([this] {
+            while (true) {
+                std::function<void()> work;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [this] { return stopping || !queue.empty(); });
+                    if (queue.empty()) return;
+                    work = std::move(queue.front());
+                    queue.pop_front();
+                }
+                work();
+            }
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::post(std::function<void()> work)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(work));
+    }
+    ready.notify_one();
+}
+
+Scheduler& defaultScheduler()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+Operation<d64> open(std::string filename, Scheduler& scheduler)
+{
+    return Operation<d64>(scheduler, [filename = std::move(filename)] { return d64(filename); });
+}
+
+Operation<bool> save(d64& disk, std::string filename, Scheduler& scheduler)
+{
+    return Operation<bool>(scheduler, [&disk, filename = std::move(filename)] { return disk.save(filename); });
+}
+
+Operation<bool> extract(d64& disk, std::string filename, Scheduler& scheduler)
+{
+    return Operation<bool>(scheduler, [&disk, filename = std::move(filename)] { return disk.extractFile(filename); });
+}
+
+Operation<std::optional<std::vector<uint8_t>>> readFile(d64& disk, std::string filename, Scheduler& scheduler)
+{
+    return Operation<std::optional<std::vector<uint8_t>>>(scheduler, [&disk, filename = std::move(filename)] {
+        if (!disk.findFile(filename).has_value()) return std::optional<std::vector<uint8_t>>();
+        return disk.readFile(filename);
+    });
+}
+
+Operation<bool> verify(d64& disk, Scheduler& scheduler)
+{
+    return Operation<bool>(scheduler, [&disk] { return disk.verifyBAMIntegrity(false, ""); });
+}
+
+} // namespace d64lib::async
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "d64.h"
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace d64lib::async {
+
+/// <summary>
+/// Runs posted work somewhere other than the calling thread
+/// implement it to drive the operations from an event loop or an io_uring backend
+/// </summary>
+class Scheduler {
+public:
+    virtual ~Scheduler() = default;
+
+    /// <summary>
+    /// Queue work, it may run on any thread but must run exactly once
+    /// </summary>
+    virtual void post(std::function<void()> work) = 0;
+};
+
+/// <summary>
+/// Scheduler backed by a fixed set of threads
+/// </summary>
+class ThreadPool : public Scheduler {
+public:
+    /// <summary>
+    /// Start the threads
+    /// </summary>
+    /// <param name="threads">number of threads, 0 for one per core</param>
+    explicit ThreadPool(unsigned threads = 0);
+
+    /// <summary>
+    /// Finish the queued work, then stop the threads
+    /// </summary>
+    ~ThreadPool() override;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void post(std::function<void()> work) override;
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> queue;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+/// <summary>
+/// Thread pool used when no scheduler is given, started on first use
+/// </summary>
+Scheduler& defaultScheduler();
+
+/// <summary>
+/// Awaitable that runs blocking work on a scheduler
+/// the awaiting coroutine continues on the thread that ran the work, exceptions are rethrown there
+/// </summary>
+template <typename T>
+class Operation {
+public:
+    Operation(Scheduler& scheduler, std::function<T()> work) :
+        scheduler(scheduler),
+        work(std::move(work))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> caller)
+    {
+        // the coroutine may be resumed before post returns, nothing here is touched after it
+        scheduler.post([this, caller] {
+            try {
+                result.emplace(work());
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            caller.resume();
+        });
+    }
+
+    T await_resume()
+    {
+        if (error) std::rethrow_exception(error);
+        return std::move(result.value());
+    }
+
+private:
+    Scheduler& scheduler;
+    std::function<T()> work;
+    std::optional<T> result;
+    std::exception_ptr error;
+};
+
+/// <summary>
+/// Awaitable that moves the awaiting coroutine onto a scheduler
+/// co_await on(pool) before CPU heavy steps keeps them off the caller's executor
+/// </summary>
+struct on {
+    Scheduler& scheduler;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> caller) { scheduler.post([caller] { caller.resume(); }); }
+    void await_resume() const noexcept {}
+};
+
+/// <summary>
+/// Load a disk image
+/// throws std::invalid_argument on resume if the image can not be loaded
+/// </summary>
+/// <param name="filename">image to load</param>
+/// <param name="scheduler">where the file is read</param>
+/// <returns>the loaded disk</returns>
+Operation<d64> open(std::string filename, Scheduler& scheduler = defaultScheduler());
+
+/// <summary>
+/// Save a disk image, the disk must not be used until the save has finished
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">file to write</param>
+/// <param name="scheduler">where the file is written</param>
+/// <returns>true if successful</returns>
+Operation<bool> save(d64& disk, std::string filename, Scheduler& scheduler = defaultScheduler());
+
+/// <summary>
+/// Extract a file to the current directory, named after it with its type as extension
+/// throws std::runtime_error on resume if the file is missing
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">file to extract</param>
+/// <param name="scheduler">where the file is written</param>
+/// <returns>true if successful</returns>
+Operation<bool> extract(d64& disk, std::string filename, Scheduler& scheduler = defaultScheduler());
+
+/// <summary>
+/// Read a file into memory
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">file to read</param>
+/// <param name="scheduler">where the file is read</param>
+/// <returns>contents of the file or nullopt if it is missing</returns>
+Operation<std::optional<std::vector<uint8_t>>> readFile(d64& disk, std::string filename, Scheduler& scheduler = defaultScheduler());
+
+/// <summary>
+/// Check the BAM against the files without changing the disk
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="scheduler">where the check runs</param>
+/// <returns>true if the BAM matches the files</returns>
+Operation<bool> verify(d64& disk, Scheduler& scheduler = defaultScheduler());
+
+} // namespace d64lib::async
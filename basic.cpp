@@ -0,0 +1,201 @@
+#include "basic.h"
+#include "corpus.h"
+#include <stdexcept>
+#include <iostream>
+
+namespace d64lib::basic {
+
+// links that point further ahead than this are not followed
+static constexpr uint32_t MAX_LINK_GAP = 0x10000;
+
+Detokenizer::Detokenizer(d64& disk, const directoryEntry& entry, petscii::Charset charset) :
+    disk(disk),
+    charset(charset),
+    position(entry.start)
+{
+    auto lo = get();
+    auto hi = get();
+    if (lo.has_value() && hi.has_value()) {
+        load = static_cast<uint16_t>(lo.value() | (hi.value() << 8));
+    }
+    else {
+        done = true;
+    }
+}
+
+/// <summary>
+/// Next byte of the file
+/// </summary>
+/// <returns>byte or nullopt at the end of the file</returns>
+std::optional<uint8_t> Detokenizer::get()
+{
+    while (block.empty()) {
+        if (blocksRead++ >= d64::MAX_CHAIN_SECTORS) {
+            throw std::runtime_error("Sector chain loops");
+        }
+        auto payload = disk.nextFileBlock(position);
+        if (!payload.has_value()) return std::nullopt;
+        block = payload.value();
+    }
+    auto value = block.front();
+    block = block.subspan(1);
+    ++consumed;
+    return value;
+}
+
+/// <summary>
+/// Skip bytes of the file
+/// </summary>
+/// <returns>false if the file ended first</returns>
+bool Detokenizer::skip(uint32_t count)
+{
+    while (count > 0) {
+        if (block.empty()) {
+            // get refills the block and takes one byte of it
+            if (!get().has_value()) return false;
+            --count;
+            continue;
+        }
+        auto step = std::min<size_t>(count, block.size());
+        block = block.subspan(step);
+        consumed += static_cast<uint32_t>(step);
+        count -= static_cast<uint32_t>(step);
+    }
+    return true;
+}
+
+/// <summary>
+/// Append a character of the program text
+/// control codes have no printable form so they are written as {$hh}
+/// </summary>
+void Detokenizer::appendCharacter(uint8_t c)
+{
+    auto u = petscii::toUnicode(c, charset);
+    if (u < 0x20 || (u >= 0x80 && u < 0xA0)) {
+        static constexpr char hex[] = "0123456789abcdef";
+        line += "{$";
+        line += hex[c >> 4];
+        line += hex[c & 0x0F];
+        line += '}';
+        return;
+    }
+    petscii::appendUtf8(std::span<const uint8_t>(&c, 1), line, charset);
+}
+
+std::optional<std::string_view> Detokenizer::next()
+{
+    if (done) return std::nullopt;
+
+    auto linkLo = get();
+    auto linkHi = get();
+    if (!linkHi.has_value() || (linkLo.value() == 0 && linkHi.value() == 0)) {
+        done = true;
+        return std::nullopt;
+    }
+    uint16_t link = static_cast<uint16_t>(linkLo.value() | (linkHi.value() << 8));
+
+    auto numberLo = get();
+    auto numberHi = get();
+    if (!numberHi.has_value()) {
+        done = true;
+        return std::nullopt;
+    }
+
+    line.clear();
+    line += std::to_string(numberLo.value() | (numberHi.value() << 8));
+    line += ' ';
+
+    bool quote = false;
+    while (true) {
+        auto c = get();
+        if (!c.has_value()) {
+            // the program was cut short, keep what there is
+            done = true;
+            return line;
+        }
+        if (c.value() == 0) break;
+
+        if (c.value() == '"') {
+            quote = !quote;
+        }
+        auto word = keyword(c.value());
+        if (!quote && word.has_value()) {
+            petscii::appendUtf8(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(word->data()), word->size()), line, charset);
+        }
+        else {
+            appendCharacter(c.value());
+        }
+    }
+
+    // follow the link to the next line. it normally points right here
+    // a link backwards would loop so the listing ends after this line
+    uint32_t address = load.value() + consumed - 2;
+    if (link < address) {
+        done = true;
+    }
+    else if (link > address && (link - address >= MAX_LINK_GAP || !skip(link - address))) {
+        done = true;
+    }
+    return line;
+}
+
+bool isBasicProgram(d64& disk, const directoryEntry& entry)
+{
+    if (entry.file_type.type != d64FileTypes::PRG || entry.start.track == 0) return false;
+
+    trackSector position = entry.start;
+    auto payload = disk.nextFileBlock(position);
+    if (!payload.has_value() || payload->size() < 2) return false;
+    return ((*payload)[0] | ((*payload)[1] << 8)) == BASIC_START;
+}
+
+bool listProgram(d64& disk, std::string_view filename, const std::function<bool(std::string_view)>& line, petscii::Charset charset)
+{
+    auto entry = disk.findFile(filename);
+    if (!entry.has_value()) return false;
+
+    Detokenizer detokenizer(disk, *entry.value(), charset);
+    while (auto text = detokenizer.next()) {
+        if (!line(text.value())) break;
+    }
+    return true;
+}
+
+std::vector<Listing> listPrograms(d64& disk, petscii::Charset charset)
+{
+    std::vector<Listing> listings;
+    for (const auto& entry : disk.directory()) {
+        if (!isBasicProgram(disk, entry)) continue;
+
+        Listing listing;
+        listing.filename = petscii::toUtf8(petscii_name::fromRaw(entry.fileName), charset);
+        try {
+            Detokenizer detokenizer(disk, entry, charset);
+            while (auto text = detokenizer.next()) {
+                listing.lines.emplace_back(text.value());
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error listing " << listing.filename << ": " << e.what() << std::endl;
+        }
+        listings.push_back(std::move(listing));
+    }
+    return listings;
+}
+
+std::vector<ImageListing> listCorpus(const std::vector<std::string>& images, petscii::Charset charset, unsigned threads)
+{
+    std::vector<ImageListing> results(images.size());
+    corpus::Options options;
+    options.threads = threads;
+    corpus::forEachImage(images, [&](size_t index, d64& disk) {
+        results[index].loaded = true;
+        results[index].programs = listPrograms(disk, charset);
+    }, options);
+    for (size_t index = 0; index < images.size(); ++index) {
+        results[index].image = images[index];
+    }
+    return results;
+}
+
+} // namespace d64lib::basic
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "d64.h"
+#include "petscii.h"
+#include <string>
+#include <vector>
+#include <string_view>
+#include <optional>
+#include <functional>
+#include <cstdint>
+#include <array>
+
+namespace d64lib::basic {
+
+inline constexpr uint16_t BASIC_START = 0x0801;
+inline constexpr uint8_t FIRST_TOKEN = 0x80;
+inline constexpr uint8_t LAST_TOKEN = 0xCB;
+
+/// <summary>
+/// BASIC V2 keywords for tokens $80 - $CB as PETSCII text
+/// </summary>
+inline constexpr std::array<std::string_view, LAST_TOKEN - FIRST_TOKEN + 1> TOKENS = {
+    "END", "FOR", "NEXT", "DATA", "INPUT#", "INPUT", "DIM", "READ",
+    "LET", "GOTO", "RUN", "IF", "RESTORE", "GOSUB", "RETURN", "REM",
+    "STOP", "ON", "WAIT", "LOAD", "SAVE", "VERIFY", "DEF", "POKE",
+    "PRINT#", "PRINT", "CONT", "LIST", "CLR", "CMD", "SYS", "OPEN",
+    "CLOSE", "GET", "NEW", "TAB(", "TO", "FN", "SPC(", "THEN",
+    "NOT", "STEP", "+", "-", "*", "/", "\x5E", "AND",
+    "OR", ">", "=", "<", "SGN", "INT", "ABS", "USR",
+    "FRE", "POS", "SQR", "RND", "LOG", "EXP", "COS", "SIN",
+    "TAN", "ATN", "PEEK", "LEN", "STR$", "VAL", "ASC", "CHR$",
+    "LEFT$", "RIGHT$", "MID$", "GO"
+};
+
+/// <summary>
+/// Get the keyword of a token
+/// </summary>
+/// <param name="token">token byte</param>
+/// <returns>keyword or nullopt if the byte is not a token</returns>
+constexpr std::optional<std::string_view> keyword(uint8_t token)
+{
+    if (token < FIRST_TOKEN || token > LAST_TOKEN) return std::nullopt;
+    return TOKENS[token - FIRST_TOKEN];
+}
+
+/// <summary>
+/// Lists a tokenized BASIC program straight from its sector chain
+/// one line at a time, like LIST does
+/// </summary>
+class Detokenizer {
+public:
+    /// <summary>
+    /// Start listing a file
+    /// </summary>
+    /// <param name="disk">d64 disk instance, must outlive the detokenizer</param>
+    /// <param name="entry">directory entry of the program</param>
+    /// <param name="charset">character set used for the listing</param>
+    Detokenizer(d64& disk, const directoryEntry& entry, petscii::Charset charset = petscii::Charset::Uppercase);
+
+    /// <summary>
+    /// Load address of the program
+    /// </summary>
+    /// <returns>load address or nullopt if the file is too short</returns>
+    std::optional<uint16_t> loadAddress() const { return load; }
+
+    /// <summary>
+    /// List the next line
+    /// </summary>
+    /// <returns>line as UTF-8 valid until the next call, or nullopt at the end of the program</returns>
+    std::optional<std::string_view> next();
+
+private:
+    std::optional<uint8_t> get();
+    bool skip(uint32_t count);
+    void appendCharacter(uint8_t c);
+
+    d64& disk;
+    petscii::Charset charset;
+    trackSector position;
+    std::span<const uint8_t> block;
+    int blocksRead = 0;
+    uint32_t consumed = 0;
+    std::optional<uint16_t> load;
+    bool done = false;
+    std::string line;
+};
+
+/// <summary>
+/// Check if a file looks like a BASIC program
+/// a PRG that loads at the start of BASIC
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="entry">directory entry of the file</param>
+/// <returns>true if it is a BASIC program</returns>
+bool isBasicProgram(d64& disk, const directoryEntry& entry);
+
+/// <summary>
+/// List a BASIC program
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the program</param>
+/// <param name="line">called for each line, return false to stop</param>
+/// <param name="charset">character set used for the listing</param>
+/// <returns>false if the file was not found</returns>
+bool listProgram(d64& disk, std::string_view filename, const std::function<bool(std::string_view)>& line, petscii::Charset charset = petscii::Charset::Uppercase);
+
+struct Listing {
+    std::string filename;
+    std::vector<std::string> lines;
+};
+
+struct ImageListing {
+    std::string image;
+    bool loaded = false;
+    std::vector<Listing> programs;
+};
+
+/// <summary>
+/// List every BASIC program on a disk
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="charset">character set used for the listing</param>
+/// <returns>listings in directory order</returns>
+std::vector<Listing> listPrograms(d64& disk, petscii::Charset charset = petscii::Charset::Uppercase);
+
+/// <summary>
+/// List every BASIC program on many disk images in parallel
+/// </summary>
+/// <param name="images">paths of .d64 files</param>
+/// <param name="charset">character set used for the listing</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per image in the same order as images</returns>
+std::vector<ImageListing> listCorpus(const std::vector<std::string>& images, petscii::Charset charset = petscii::Charset::Uppercase, unsigned threads = 0);
+
+} // namespace d64lib::basic
@@ -0,0 +1,218 @@
+#include "bloom.h"
+#include "hash.h"
+#include "parallel.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+namespace d64lib::bloom {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'D', '6', '4', 'B', 'L', 'O', 'O', 'M' };
+constexpr uint32_t VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.put(static_cast<char>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+}
+
+template <typename T>
+T readValue(std::istream& in)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        auto c = in.get();
+        if (c == std::char_traits<char>::eof()) {
+            throw std::runtime_error("Unexpected end of filter file");
+        }
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(c)) << (i * 8);
+    }
+    return static_cast<T>(value);
+}
+
+/// <summary>
+/// Bit positions of a name
+/// the two halves of one XXH64 are combined to make the probes (Kirsch-Mitzenmacher)
+/// </summary>
+std::array<uint32_t, FILTER_HASHES> probes(const petscii_name& name)
+{
+    const auto& padded = name.padded();
+    auto h = hash::xxh64(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(padded.data()), padded.size()));
+    auto h1 = static_cast<uint32_t>(h);
+    auto h2 = static_cast<uint32_t>(h >> 32) | 1;
+    std::array<uint32_t, FILTER_HASHES> result;
+    for (size_t i = 0; i < FILTER_HASHES; ++i) {
+        result[i] = (h1 + static_cast<uint32_t>(i) * h2) % FILTER_BITS;
+    }
+    return result;
+}
+
+} // namespace
+
+void NameFilter::add(const petscii_name& name)
+{
+    for (auto bit : probes(name)) {
+        bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool NameFilter::mayContain(const petscii_name& name) const
+{
+    for (auto bit : probes(name)) {
+        if ((bits[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) return false;
+    }
+    return true;
+}
+
+NameFilter buildFilter(d64& disk)
+{
+    NameFilter filter;
+    for (const auto& entry : disk.directory()) {
+        filter.add(petscii_name::fromRaw(entry.fileName));
+    }
+    return filter;
+}
+
+NameFilter& FilterSet::filterOf(const std::string& image)
+{
+    auto it = ids.find(image);
+    if (it != ids.end()) return filters[it->second];
+    ids[image] = images.size();
+    images.push_back(image);
+    return filters.emplace_back();
+}
+
+void FilterSet::add(const std::string& image, const petscii_name& name)
+{
+    filterOf(image).add(name);
+}
+
+void FilterSet::set(const std::string& image, const NameFilter& filter)
+{
+    filterOf(image) = filter;
+}
+
+size_t FilterSet::addImages(const std::vector<std::string>& paths, unsigned threads)
+{
+    std::vector<std::optional<NameFilter>> results(paths.size());
+    parallelFor(paths.size(), threads, [&](size_t index) {
+        try {
+            d64 disk(paths[index]);
+            results[index] = buildFilter(disk);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << paths[index] << ": " << e.what() << std::endl;
+        }
+    });
+
+    size_t count = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!results[i].has_value()) continue;
+        set(paths[i], results[i].value());
+        ++count;
+    }
+    return count;
+}
+
+const NameFilter* FilterSet::find(const std::string& image) const
+{
+    auto it = ids.find(image);
+    return it == ids.end() ? nullptr : &filters[it->second];
+}
+
+std::vector<std::string> FilterSet::candidates(const petscii_name& name) const
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (filters[i].mayContain(name)) result.push_back(images[i]);
+    }
+    return result;
+}
+
+std::vector<std::string> FilterSet::locate(const petscii_name& name, unsigned threads) const
+{
+    auto possible = candidates(name);
+    std::vector<char> found(possible.size(), 0);
+    parallelFor(possible.size(), threads, [&](size_t index) {
+        try {
+            d64 disk(possible[index]);
+            found[index] = disk.findFile(name).has_value();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << possible[index] << ": " << e.what() << std::endl;
+        }
+    });
+
+    std::vector<std::string> result;
+    for (size_t i = 0; i < possible.size(); ++i) {
+        if (found[i]) result.push_back(std::move(possible[i]));
+    }
+    return result;
+}
+
+bool FilterSet::save(const std::string& filename) const
+{
+    std::ofstream outFile(filename, std::ios::binary);
+    if (!outFile) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+
+    outFile.write(MAGIC, sizeof(MAGIC));
+    writeValue<uint32_t>(outFile, VERSION);
+    writeValue<uint32_t>(outFile, static_cast<uint32_t>(FILTER_BITS));
+    writeValue<uint32_t>(outFile, static_cast<uint32_t>(images.size()));
+    for (size_t i = 0; i < images.size(); ++i) {
+        writeValue<uint32_t>(outFile, static_cast<uint32_t>(images[i].size()));
+        outFile.write(images[i].data(), images[i].size());
+        for (auto word : filters[i].words()) {
+            writeValue<uint64_t>(outFile, word);
+        }
+    }
+    outFile.close();
+    return static_cast<bool>(outFile);
+}
+
+bool FilterSet::load(const std::string& filename)
+{
+    try {
+        std::ifstream inFile(filename, std::ios::binary);
+        if (!inFile) {
+            throw std::ios_base::failure("Error: Could not open filter file " + filename + " for reading");
+        }
+
+        char magic[sizeof(MAGIC)];
+        inFile.read(magic, sizeof(magic));
+        if (!inFile || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || readValue<uint32_t>(inFile) != VERSION) {
+            throw std::invalid_argument("Not a filter file");
+        }
+        if (readValue<uint32_t>(inFile) != FILTER_BITS) {
+            throw std::invalid_argument("Unsupported filter size");
+        }
+
+        FilterSet loaded;
+        auto count = readValue<uint32_t>(inFile);
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string image(readValue<uint32_t>(inFile), '\0');
+            inFile.read(image.data(), image.size());
+            NameFilter filter;
+            for (auto& word : filter.words()) {
+                word = readValue<uint64_t>(inFile);
+            }
+            loaded.set(image, filter);
+        }
+        *this = std::move(loaded);
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace d64lib::bloom
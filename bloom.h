@@ -0,0 +1,122 @@
+#pragma once
+
+#include "d64.h"
+#include "petscii_name.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace d64lib::bloom {
+
+inline constexpr size_t FILTER_BITS = 1024;
+inline constexpr size_t FILTER_HASHES = 4;
+
+/// <summary>
+/// Bloom filter over the padded file names of one image
+/// 128 bytes keep false positives around 3% even with a full directory of 144 files
+/// </summary>
+class NameFilter {
+public:
+    void add(const petscii_name& name);
+
+    /// <summary>
+    /// Check if a name may be on the image
+    /// </summary>
+    /// <param name="name">file name</param>
+    /// <returns>false if the name is certainly not on the image</returns>
+    bool mayContain(const petscii_name& name) const;
+
+    const std::array<uint64_t, FILTER_BITS / 64>& words() const { return bits; }
+    std::array<uint64_t, FILTER_BITS / 64>& words() { return bits; }
+
+    bool operator==(const NameFilter& other) const = default;
+
+private:
+    std::array<uint64_t, FILTER_BITS / 64> bits{};
+};
+
+/// <summary>
+/// Build the filter of a disk from its directory
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <returns>filter with every file name of the disk</returns>
+NameFilter buildFilter(d64& disk);
+
+/// <summary>
+/// The name filters of a corpus of images, saved together as one sidecar file
+/// </summary>
+class FilterSet {
+public:
+    /// <summary>
+    /// Add a name to the filter of an image, creating the filter if needed
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="name">file name</param>
+    void add(const std::string& image, const petscii_name& name);
+
+    /// <summary>
+    /// Set the filter of an image
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="filter">filter of the image</param>
+    void set(const std::string& image, const NameFilter& filter);
+
+    /// <summary>
+    /// Read the directories of many images in parallel and build their filters
+    /// </summary>
+    /// <param name="images">paths of .d64 files</param>
+    /// <param name="threads">number of worker threads, 0 for one per core</param>
+    /// <returns>number of images that were added</returns>
+    size_t addImages(const std::vector<std::string>& images, unsigned threads = 0);
+
+    /// <summary>
+    /// Get the filter of an image
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <returns>filter or nullptr if the image is not in the set</returns>
+    const NameFilter* find(const std::string& image) const;
+
+    /// <summary>
+    /// Get the images that may hold a file
+    /// </summary>
+    /// <param name="name">file name</param>
+    /// <returns>images in the order they were added</returns>
+    std::vector<std::string> candidates(const petscii_name& name) const;
+
+    /// <summary>
+    /// Get the images that hold a file
+    /// only the candidate images are opened to confirm the name
+    /// </summary>
+    /// <param name="name">file name</param>
+    /// <param name="threads">number of worker threads, 0 for one per core</param>
+    /// <returns>images in the order they were added</returns>
+    std::vector<std::string> locate(const petscii_name& name, unsigned threads = 0) const;
+
+    size_t size() const { return images.size(); }
+
+    /// <summary>
+    /// Save the filters
+    /// </summary>
+    /// <param name="filename">file to write</param>
+    /// <returns>true if successful</returns>
+    bool save(const std::string& filename) const;
+
+    /// <summary>
+    /// Load filters written by save, replacing the current ones
+    /// </summary>
+    /// <param name="filename">file to read</param>
+    /// <returns>true if successful</returns>
+    bool load(const std::string& filename);
+
+private:
+    NameFilter& filterOf(const std::string& image);
+
+    std::vector<std::string> images;
+    std::vector<NameFilter> filters;
+    std::unordered_map<std::string, size_t> ids;
+};
+
+} // namespace d64lib::bloom
@@ -0,0 +1,200 @@
+#include "concurrent_writer.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace d64lib {
+
+namespace {
+
+// tells the per-thread cursors of different writers apart
+std::atomic<uint64_t> nextWriterId = 1;
+
+// lanes start this many places apart in the track order
+constexpr size_t LANE_STRIDE = 7;
+
+constexpr uint8_t CLOSED = 0x80;
+
+}
+
+ConcurrentWriter::ConcurrentWriter(d64& disk) :
+    disk(disk),
+    id(nextWriterId++)
+{
+    // the same order the disk itself fills tracks in, less the directory track which is kept for directory sectors
+    if (disk.disktype == diskType::eighty_track) {
+        for (auto step = 1; step < 2 * disk.TRACKS; ++step) {
+            auto t = disk.dirTrack + (step % 2 ? -(step + 1) / 2 : step / 2);
+            if (t >= 1 && t <= disk.TRACKS) order.push_back(t);
+        }
+    }
+    else if (disk.disktype == diskType::seventy_track) {
+        std::copy_if(d64::TRACK_70_SEARCH_ORDER.begin(), d64::TRACK_70_SEARCH_ORDER.end(), std::back_inserter(order),
+            [&](int t) { return t != disk.dirTrack; });
+    }
+    else {
+        std::copy_if(d64::TRACK_40_SEARCH_ORDER.begin(), d64::TRACK_40_SEARCH_ORDER.end(), std::back_inserter(order),
+            [&](int t) { return t != disk.dirTrack && t <= disk.TRACKS; });
+    }
+}
+
+bool ConcurrentWriter::addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData)
+{
+    if (filename.empty() || fileData.empty()) {
+        throw std::runtime_error("Error: Filename or file data cannot be empty");
+    }
+    if (type.type == d64FileTypes::REL) {
+        throw std::invalid_argument("REL files can not be written concurrently");
+    }
+
+    constexpr size_t BLOCK_SIZE = SECTOR_SIZE - sizeof(trackSector);
+    auto blocks = (fileData.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    auto& position = cursor();
+
+    std::vector<trackSector> claimed;
+    claimed.reserve(blocks);
+    auto giveBack = [&]() {
+        for (auto& block : claimed) releaseSector(block.track, block.sector);
+        return false;
+    };
+
+    for (size_t b = 0; b < blocks; ++b) {
+        int track, sector;
+        if (!claimSector(position, track, sector)) return giveBack();
+        claimed.push_back({ static_cast<uint8_t>(track), static_cast<uint8_t>(sector) });
+    }
+
+    // the claimed sectors belong to this thread alone, they are written without atomics
+    for (size_t b = 0; b < blocks; ++b) {
+        auto sectorPtr = disk.getSectorPtr(claimed[b].track, claimed[b].sector);
+        auto offset = b * BLOCK_SIZE;
+        auto len = std::min(BLOCK_SIZE, fileData.size() - offset);
+        if (b + 1 < blocks) {
+            sectorPtr->next = claimed[b + 1];
+        }
+        else {
+            sectorPtr->next = trackSector(0, static_cast<int>(len + 1));
+        }
+        std::copy_n(fileData.begin() + offset, len, sectorPtr->data.begin());
+        std::fill(sectorPtr->data.begin() + len, sectorPtr->data.end(), 0);
+    }
+
+    auto fileEntry = claimDirectorySlot(static_cast<uint8_t>(type) | CLOSED);
+    if (!fileEntry.has_value()) return giveBack();
+
+    fileEntry.value()->start = claimed.front();
+    petscii_name(filename).copyTo(fileEntry.value()->fileName);
+    fileEntry.value()->recordLength = 0;
+    fileEntry.value()->side = { 0, 0 };
+    fileEntry.value()->replace = claimed.front();
+    fileEntry.value()->fileSize[0] = blocks & 0xFF;
+    fileEntry.value()->fileSize[1] = (blocks & 0xFF00) >> 8;
+    return true;
+}
+
+ConcurrentWriter::Cursor& ConcurrentWriter::cursor()
+{
+    thread_local Cursor current;
+    if (current.owner != id) {
+        current = { id, (lanes++ * LANE_STRIDE) % order.size(), 0 };
+    }
+    return current;
+}
+
+bool ConcurrentWriter::claimSector(Cursor& cursor, int& track, int& sector)
+{
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto position = (cursor.position + i) % order.size();
+        if (claimOnTrack(order[position], cursor.sector, sector)) {
+            track = order[position];
+            cursor.position = position;
+            cursor.sector = sector + d64::INTERLEAVE;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConcurrentWriter::claimOnTrack(int track, int start, int& sector)
+{
+    auto bam = disk.bamtrack(track - 1);
+    std::atomic_ref<uint8_t> free(bam.free);
+    if (free.load(std::memory_order_relaxed) == 0) return false;
+
+    auto sectors = disk.sectorCount(track);
+    for (auto i = 0; i < sectors; ++i) {
+        auto candidate = (start + i) % sectors;
+        auto mask = static_cast<uint8_t>(1 << (candidate % 8));
+        std::atomic_ref<uint8_t> bits(bam.bytes[candidate / 8]);
+        auto value = bits.load(std::memory_order_relaxed);
+        while (value & mask) {
+            if (bits.compare_exchange_weak(value, static_cast<uint8_t>(value & ~mask), std::memory_order_acq_rel)) {
+                free.fetch_sub(1, std::memory_order_relaxed);
+                sector = candidate;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ConcurrentWriter::releaseSector(int track, int sector)
+{
+    auto bam = disk.bamtrack(track - 1);
+    std::atomic_ref<uint8_t>(bam.bytes[sector / 8]).fetch_or(static_cast<uint8_t>(1 << (sector % 8)), std::memory_order_acq_rel);
+    std::atomic_ref<uint8_t>(bam.free).fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ConcurrentWriter::claimDirectorySector(int& track, int& sector)
+{
+    if (claimOnTrack(disk.dirTrack, 0, sector)) {
+        track = disk.dirTrack;
+        return true;
+    }
+    return claimSector(cursor(), track, sector);
+}
+
+std::optional<directoryEntryPtr> ConcurrentWriter::claimDirectorySlot(uint8_t type)
+{
+    int track = disk.dirTrack;
+    int sector = disk.dirSector;
+
+    while (true) {
+        auto dirSectorPtr = disk.getDirectory_SectorPtr(track, sector);
+        for (auto& fileEntry : dirSectorPtr->fileEntry) {
+            std::atomic_ref<uint8_t> slot(*reinterpret_cast<uint8_t*>(&fileEntry.file_type));
+            auto value = slot.load(std::memory_order_acquire);
+            while (!(value & CLOSED)) {
+                if (slot.compare_exchange_weak(value, type, std::memory_order_acq_rel)) {
+                    return &fileEntry;
+                }
+            }
+        }
+
+        // the link sits at the start of a sector, so it is aligned for a 16 bit atomic
+        std::atomic_ref<uint16_t> link(*reinterpret_cast<uint16_t*>(&dirSectorPtr->next));
+        auto next = std::bit_cast<trackSector>(link.load(std::memory_order_acquire));
+        if (next.track == 0 || !disk.isValidTrackSector(next.track, next.sector)) {
+            // the last sector is full, link a new one unless another thread got there first
+            int newTrack, newSector;
+            if (!claimDirectorySector(newTrack, newSector)) return std::nullopt;
+            auto newSectorPtr = disk.getDirectory_SectorPtr(newTrack, newSector);
+            std::fill_n(reinterpret_cast<uint8_t*>(newSectorPtr), SECTOR_SIZE, 0);
+            newSectorPtr->next = { 0, 0xFF };
+
+            trackSector linked = { static_cast<uint8_t>(newTrack), static_cast<uint8_t>(newSector) };
+            auto expected = std::bit_cast<uint16_t>(next);
+            if (link.compare_exchange_strong(expected, std::bit_cast<uint16_t>(linked), std::memory_order_acq_rel)) {
+                next = linked;
+            }
+            else {
+                releaseSector(newTrack, newSector);
+                next = std::bit_cast<trackSector>(expected);
+            }
+        }
+        track = next.track;
+        sector = next.sector;
+    }
+}
+
+} // namespace d64lib
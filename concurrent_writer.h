@@ -0,0 +1,60 @@
+#pragma once
+
+#include "d64.h"
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace d64lib {
+
+/// <summary>
+/// Adds files to one disk from many threads at once
+/// sectors are claimed by atomic updates of the BAM bytes and directory slots by atomic updates of the file type,
+/// so independent files never wait for each other
+/// while writers run nothing else may use the disk, afterwards it is an ordinary d64
+/// </summary>
+class ConcurrentWriter {
+public:
+    /// <summary>
+    /// The disk must outlive the writer
+    /// </summary>
+    /// <param name="disk">d64 disk instance to write to</param>
+    explicit ConcurrentWriter(d64& disk);
+
+    /// <summary>
+    /// Write a file and give it a directory entry, safe to call from any number of threads
+    /// names are not checked against files added at the same time
+    /// throws std::runtime_error if the name or data is empty
+    /// throws std::invalid_argument for REL files, their side sectors need the whole image
+    /// </summary>
+    /// <param name="filename">name of the file</param>
+    /// <param name="type">file type</param>
+    /// <param name="fileData">contents of the file</param>
+    /// <returns>false if the disk or directory is full, the sectors claimed so far are given back</returns>
+    bool addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData);
+
+private:
+    // where a thread looks for its next sector, threads start at different tracks
+    struct Cursor {
+        uint64_t owner = 0;
+        size_t position = 0;
+        int sector = 0;
+    };
+
+    Cursor& cursor();
+    bool claimSector(Cursor& cursor, int& track, int& sector);
+    bool claimOnTrack(int track, int start, int& sector);
+    void releaseSector(int track, int sector);
+    bool claimDirectorySector(int& track, int& sector);
+    std::optional<directoryEntryPtr> claimDirectorySlot(uint8_t type);
+
+    d64& disk;
+    std::vector<int> order;             // data tracks in the order the disk fills them
+    uint64_t id;
+    std::atomic<unsigned> lanes = 0;
+};
+
+} // namespace d64lib
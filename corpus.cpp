@@ -0,0 +1,198 @@
+#include "corpus.h"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace d64lib::corpus {
+
+namespace {
+
+bool isImage(const std::filesystem::path& path)
+{
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".d64" || extension == ".d71" || extension == ".d81";
+}
+
+// one queue per worker, the owner takes from the front and thieves from the back
+class WorkQueues {
+public:
+    WorkQueues(size_t count, unsigned workers) :
+        queues(workers)
+    {
+        for (unsigned w = 0; w < workers; ++w) {
+            for (auto index = count * w / workers; index < count * (w + 1) / workers; ++index) {
+                queues[w].items.push_back(index);
+            }
+        }
+    }
+
+    // nothing is added once the workers run, so every queue being empty means the work is done
+    bool next(unsigned worker, size_t& index)
+    {
+        {
+            auto& own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.lock);
+            if (!own.items.empty()) {
+                index = own.items.front();
+                own.items.pop_front();
+                return true;
+            }
+        }
+        for (size_t step = 1; step < queues.size(); ++step) {
+            auto& victim = queues[(worker + step) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if (!victim.items.empty()) {
+                index = victim.items.back();
+                victim.items.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> items;
+    };
+
+    std::vector<Queue> queues;
+};
+
+// loaded disks handed from task to task, so each image reuses a buffer instead of allocating its own
+class DiskPool {
+public:
+    explicit DiskPool(size_t limit) :
+        limit(limit)
+    {
+    }
+
+    std::unique_ptr<d64> acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [&] { return !idle.empty() || created < limit; });
+        if (!idle.empty()) {
+            auto disk = std::move(idle.back());
+            idle.pop_back();
+            return disk;
+        }
+        ++created;
+        lock.unlock();
+        return std::make_unique<d64>();
+    }
+
+    void release(std::unique_ptr<d64> disk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(std::move(disk));
+        }
+        available.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<d64>> idle;
+    size_t created = 0;
+    size_t limit;
+};
+
+}
+
+std::vector<std::string> findImages(const std::string& directory, bool recursive)
+{
+    std::vector<std::string> images;
+    auto add = [&](const std::filesystem::directory_entry& item) {
+        if (item.is_regular_file() && isImage(item.path())) {
+            images.push_back(item.path().string());
+        }
+    };
+    if (recursive) {
+        for (const auto& item : std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied)) add(item);
+    }
+    else {
+        for (const auto& item : std::filesystem::directory_iterator(directory)) add(item);
+    }
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+std::vector<std::string> forEachImage(const std::vector<std::string>& images, const std::function<void(size_t, d64&)>& task, const Options& options)
+{
+    std::vector<std::string> errors(images.size());
+    if (images.empty()) return errors;
+
+    auto threads = options.threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : options.threads;
+    threads = static_cast<unsigned>(std::min<size_t>(threads, images.size()));
+
+    WorkQueues work(images.size(), threads);
+    DiskPool pool(options.maxResident == 0 ? threads : options.maxResident);
+    Progress progress;
+    progress.total = images.size();
+    std::mutex progressLock;
+
+    auto worker = [&](unsigned id) {
+        while (true) {
+            auto disk = pool.acquire();
+            size_t index;
+            if (!work.next(id, index)) {
+                pool.release(std::move(disk));
+                return;
+            }
+
+            auto& error = errors[index];
+            try {
+                if (disk->load(images[index])) {
+                    task(index, *disk);
+                }
+                else {
+                    error = "Unable to load disk";
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error: " << images[index] << ": " << e.what() << std::endl;
+                error = e.what();
+            }
+            pool.release(std::move(disk));
+
+            std::lock_guard<std::mutex> lock(progressLock);
+            ++progress.done;
+            if (!error.empty()) ++progress.failed;
+            if (options.progress) options.progress(progress, images[index]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back(worker, t);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    return errors;
+}
+
+Verification verify(d64& disk)
+{
+    Verification result;
+    result.intact = disk.verifyBAMIntegrity(false, "");
+    result.freeSectors = disk.getFreeSectorCount();
+    result.files = disk.directory().size();
+    return result;
+}
+
+std::vector<directoryEntry> catalog(d64& disk)
+{
+    return disk.directory();
+}
+
+} // namespace d64lib::corpus
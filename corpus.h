@@ -0,0 +1,93 @@
+#pragma once
+
+#include "d64.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace d64lib::corpus {
+
+/// <summary>
+/// Disk images under a directory, sorted by path
+/// </summary>
+/// <param name="directory">directory to search</param>
+/// <param name="recursive">true to search sub directories too</param>
+/// <returns>paths of the .d64, .d71 and .d81 files</returns>
+std::vector<std::string> findImages(const std::string& directory, bool recursive = true);
+
+struct Progress {
+    size_t done = 0;            // images finished, loaded or not
+    size_t failed = 0;
+    size_t total = 0;
+};
+
+struct Options {
+    unsigned threads = 0;       // 0 for one per core
+    size_t maxResident = 0;     // images loaded at the same time, 0 for one per thread
+
+    // called after every image, never by two threads at once
+    std::function<void(const Progress& progress, const std::string& image)> progress;
+};
+
+template <typename Result>
+struct ImageResult {
+    std::string image;
+    std::optional<Result> result;   // empty if the image could not be loaded or the operation threw
+    std::string error;
+};
+
+/// <summary>
+/// Load every image and run task on it, on a work stealing pool
+/// each worker starts on its own share of the images and takes from the others once it runs out
+/// loaded images are reused, a worker waits when maxResident images are in use
+/// </summary>
+/// <param name="images">paths of disk images</param>
+/// <param name="task">called with the index of the image and the loaded disk</param>
+/// <param name="options">threads, memory limit and progress callback</param>
+/// <returns>error of every image in the same order as images, empty if it succeeded</returns>
+std::vector<std::string> forEachImage(const std::vector<std::string>& images, const std::function<void(size_t, d64&)>& task, const Options& options = {});
+
+/// <summary>
+/// Run an operation on every image
+/// </summary>
+/// <param name="images">paths of disk images</param>
+/// <param name="op">called with the loaded disk, its result is kept, it must not keep the disk</param>
+/// <param name="options">threads, memory limit and progress callback</param>
+/// <returns>one result per image in the same order as images</returns>
+template <typename Op>
+auto run(const std::vector<std::string>& images, Op&& op, const Options& options = {})
+{
+    using Result = std::invoke_result_t<Op&, d64&>;
+    static_assert(!std::is_void_v<Result>, "the operation must return a result");
+
+    std::vector<ImageResult<Result>> results(images.size());
+    auto errors = forEachImage(images, [&](size_t index, d64& disk) { results[index].result = op(disk); }, options);
+    for (size_t index = 0; index < images.size(); ++index) {
+        results[index].image = images[index];
+        results[index].error = std::move(errors[index]);
+    }
+    return results;
+}
+
+struct Verification {
+    bool intact = false;        // the BAM matches the files
+    uint16_t freeSectors = 0;
+    size_t files = 0;
+};
+
+/// <summary>
+/// Operation that checks the BAM of a disk without changing it
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+Verification verify(d64& disk);
+
+/// <summary>
+/// Operation that reads the directory of a disk
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+std::vector<directoryEntry> catalog(d64& disk);
+
+} // namespace d64lib::corpus
@@ -12,6 +12,8 @@
 #include <map>
 #include <sstream>
 #include <bitset>
+#include <span>
+#include <memory_resource>
 
 #include "d64.h"
 
@@ -50,7 +52,41 @@ d64::d64(std::string name)
 }
 
 /// <summary>
-/// Initialize 35 or 40 track
+/// copy constructor
+/// the BAM pointers are set up again for the new image
+/// </summary>
+/// <param name="other">disk to copy</param>
+d64::d64(const d64& other)
+{
+    *this = other;
+}
+
+/// <summary>
+/// copy assignment
+/// </summary>
+/// <param name="other">disk to copy</param>
+/// <returns>this disk</returns>
+d64& d64::operator=(const d64& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    TRACKS = other.TRACKS;
+    lastSectorUsed = other.lastSectorUsed;
+    disktype = other.disktype;
+    sectorTable = other.sectorTable;
+    offsetTable = other.offsetTable;
+    dirTrack = other.dirTrack;
+    dirSector = other.dirSector;
+    partitionStart = other.partitionStart;
+    partitionTracks = other.partitionTracks;
+    data = other.data;
+    initBAMPtr();
+    return *this;
+}
+
+/// <summary>
+/// Initialize 35, 40, 70 or 80 track
 /// </summary>
 void d64::init_disk()
 {
@@ -64,11 +100,33 @@ void d64::init_disk()
             TRACKS = TRACKS_40;
             sz = D64_DISK40_SZ;
             break;
+        case diskType::seventy_track:
+            TRACKS = TRACKS_70;
+            sz = D71_DISK_SZ;
+            break;
+        case diskType::eighty_track:
+            TRACKS = TRACKS_80;
+            sz = D81_DISK_SZ;
+            break;
         default:
             throw std::runtime_error("Invalid Disk type");
     }
+    switch (disktype) {
+        case diskType::seventy_track:
+            sectorTable = D71_SECTORS_PER_TRACK.data();
+            offsetTable = D71_TRACK_OFFSETS.data();
+            break;
+        case diskType::eighty_track:
+            sectorTable = D81_SECTORS_PER_TRACK.data();
+            offsetTable = D81_TRACK_OFFSETS.data();
+            break;
+        default:
+            sectorTable = SECTORS_PER_TRACK.data();
+            offsetTable = TRACK_OFFSETS.data();
+            break;
+    }
     data.resize(sz, 0x01);
-    std::fill_n(lastSectorUsed.begin(), TRACKS_40, 1);
+    std::fill_n(lastSectorUsed.begin(), TRACKS_80, 1);
     formatDisk("NEW DISK");
 }
 
@@ -78,7 +136,7 @@ int d64::calcOffset(int track, int sector) const
     if (!isValidTrackSector(track, sector)) {
         throw std::runtime_error("Invalid Track and Sector TRACK:" + std::to_string(track) + " SECTOR:" + std::to_string(sector));
     }
-    return TRACK_OFFSETS[track - 1] + sector * SECTOR_SIZE;
+    return offsetTable[track - 1] + sector * SECTOR_SIZE;
 }
 
 /// <summary>
@@ -88,35 +146,53 @@ int d64::calcOffset(int track, int sector) const
 /// <param name="name">new name for disk</param>
 void d64::initBAM(std::string_view name)
 {
-    // set the BAM pointer
-    initBAMPtr();
+    // set the BAM pointer of the root directory
+    openRoot();
 
     // initialize the BAM fields
     // bamPtr must already be set!
     initializeBAMFields(name);
 
+    // the second side BAM sector only holds bitmaps
+    if (disktype == diskType::seventy_track) {
+        std::fill_n(data.begin() + calcOffset(D71_BAM_TRACK, BAM_SECTOR), SECTOR_SIZE, 0);
+    }
+
     // Mark all sectors free
     for (auto t = 0; t < TRACKS; ++t) {
         auto bam = bamtrack(t);
-        bam->free = SECTORS_PER_TRACK[t];
-        bam->clear();
-        for (auto b = 0; b < SECTORS_PER_TRACK[t]; b++) {
-            bam->set(b);
+        bam.free = sectorTable[t];
+        bam.clear();
+        for (auto b = 0; b < sectorTable[t]; b++) {
+            bam.set(b);
         }
     }
 
+    // a 1571 reserves the whole BAM track of the second side
+    if (disktype == diskType::seventy_track) {
+        auto bam = bamtrack(D71_BAM_TRACK - 1);
+        bam.free = 0;
+        bam.clear();
+    }
+
     // Initialize the directory structure
-    auto index = calcOffset(DIRECTORY_TRACK, DIRECTORY_SECTOR);
+    auto index = calcOffset(dirTrack, dirSector);
     std::fill_n(data.begin() + index, SECTOR_SIZE, 0);
 
     // mark as the last directory sector
     data[index + 1] = 0xFF;
 
     // allocate the BAM sector
-    allocateSector(DIRECTORY_TRACK, BAM_SECTOR);
+    allocateSector(dirTrack, BAM_SECTOR);
+
+    // a 1581 has the header in sector 0 and the BAM in the next two
+    if (disktype == diskType::eighty_track) {
+        allocateSector(dirTrack, D81_BAM_SECTOR);
+        allocateSector(dirTrack, D81_BAM_SECTOR + 1);
+    }
 
     // allocate the 1st directory sector
-    allocateSector(DIRECTORY_TRACK, DIRECTORY_SECTOR);
+    allocateSector(dirTrack, dirSector);
 }
 
 /// <summary>
@@ -125,9 +201,17 @@ void d64::initBAM(std::string_view name)
 /// <param name="name">new name for disk</param>
 bool d64::rename_disk(std::string_view name) const
 {
-    auto len = std::min(name.size(), static_cast<size_t>(DISK_NAME_SZ));
-    std::copy_n(name.begin(), len, diskBamPtr->diskName);
-    std::fill(diskBamPtr->diskName + len, diskBamPtr->diskName + DISK_NAME_SZ, static_cast<char>(A0_VALUE));
+    return rename_disk(petscii_name(name));
+}
+
+/// <summary>
+/// Rename the disk
+/// </summary>
+/// <param name="name">new padded name for disk</param>
+bool d64::rename_disk(const petscii_name& name) const
+{
+    static_assert(DISK_NAME_SZ == petscii_name::capacity);
+    name.copyTo(diskNameField());
     return true;
 }
 
@@ -151,7 +235,19 @@ void d64::formatDisk(std::string_view name)
 /// <param name="sector">sector number</param>
 /// <param name="bytes">arrray of SECTOR_SIZE bytes</param>
 /// <returns>true on success</returns>
-bool d64::writeSector(int track, int sector, std::vector<uint8_t> bytes)
+bool d64::writeSector(int track, int sector, const std::vector<uint8_t>& bytes)
+{
+    return writeSector(track, sector, std::span<const uint8_t>(bytes));
+}
+
+/// <summary>
+/// write an entire sector from a span without copying it first
+/// </summary>
+/// <param name="track">track number</param>
+/// <param name="sector">sector number</param>
+/// <param name="bytes">span of SECTOR_SIZE bytes</param>
+/// <returns>true on success</returns>
+bool d64::writeSector(int track, int sector, std::span<const uint8_t> bytes)
 {
     try {
         if (!isValidTrackSector(track, sector) || bytes.size() != SECTOR_SIZE) {
@@ -166,6 +262,22 @@ bool d64::writeSector(int track, int sector, std::vector<uint8_t> bytes)
     return false;
 }
 
+/// <summary>
+/// write an entire track
+/// the sectors of a track are contiguous in the image
+/// so this is a single copy
+/// </summary>
+/// <param name="track">track number</param>
+/// <param name="bytes">span of trackSize(track) bytes</param>
+/// <returns>true on success</returns>
+bool d64::writeTrack(int track, std::span<const uint8_t> bytes)
+{
+    auto size = trackSize(track);
+    if (size == 0 || bytes.size() != static_cast<size_t>(size)) return false;
+    std::copy(bytes.begin(), bytes.end(), data.begin() + calcOffset(track, 0));
+    return true;
+}
+
 /// <summary>
 /// Write a byte to a sector
 /// </summary>
@@ -177,7 +289,7 @@ bool d64::writeSector(int track, int sector, std::vector<uint8_t> bytes)
 bool d64::writeByte(int track, int sector, int byteoffset, uint8_t value)
 {
     if (!isValidTrackSector(track, sector) || byteoffset < 0 || byteoffset >= SECTOR_SIZE) return false;
-    return writeData(track, sector, { value }, byteoffset);
+    return writeData(track, sector, std::span<const uint8_t>(&value, 1), byteoffset);
 }
 
 /// <summary>
@@ -215,6 +327,44 @@ std::optional<std::vector<uint8_t>> d64::readSector(int track, int sector)
     return std::nullopt;
 }
 
+/// <summary>
+/// Read a sector into a caller supplied buffer
+/// </summary>
+/// <param name="track">track number</param>
+/// <param name="sector">sector number</param>
+/// <param name="bytes">span of SECTOR_SIZE bytes to fill</param>
+/// <returns>true on success</returns>
+bool d64::readSector(int track, int sector, std::span<uint8_t> bytes) const
+{
+    if (!isValidTrackSector(track, sector) || bytes.size() != SECTOR_SIZE) return false;
+    std::copy_n(data.begin() + calcOffset(track, sector), SECTOR_SIZE, bytes.begin());
+    return true;
+}
+
+/// <summary>
+/// Read an entire track into a caller supplied buffer
+/// </summary>
+/// <param name="track">track number</param>
+/// <param name="bytes">span of trackSize(track) bytes to fill</param>
+/// <returns>true on success</returns>
+bool d64::readTrack(int track, std::span<uint8_t> bytes) const
+{
+    auto size = trackSize(track);
+    if (size == 0 || bytes.size() != static_cast<size_t>(size)) return false;
+    std::copy_n(data.begin() + calcOffset(track, 0), size, bytes.begin());
+    return true;
+}
+
+/// <summary>
+/// Get the size in bytes of a track
+/// </summary>
+/// <param name="track">track number</param>
+/// <returns>size of the track or 0 if the track is invalid</returns>
+int d64::trackSize(int track) const
+{
+    return sectorCount(track) * SECTOR_SIZE;
+}
+
 /// <summary>
 /// Find an empty slot in the directory
 /// This will create a new directory sector if needed
@@ -222,8 +372,8 @@ std::optional<std::vector<uint8_t>> d64::readSector(int track, int sector)
 /// <returns>optional Directory_EntryPtr to free slot</returns>
 std::optional<directoryEntryPtr> d64::findEmptyDirectorySlot()
 {
-    auto dir_track = DIRECTORY_TRACK;
-    auto dir_sector = DIRECTORY_SECTOR;
+    auto dir_track = dirTrack;
+    auto dir_sector = dirSector;
 
     while (dir_track != 0) {
         directorySectorPtr dirSectorPtr = getDirectory_SectorPtr(dir_track, dir_sector);
@@ -235,7 +385,7 @@ std::optional<directoryEntryPtr> d64::findEmptyDirectorySlot()
         dir_track = dirSectorPtr->next.track;
         dir_sector = dirSectorPtr->next.sector;
 
-        if (dir_track == 0 || dir_track > TRACKS || dir_sector < 0 || dir_sector > SECTORS_PER_TRACK[dir_track - 1]) {
+        if (dir_track == 0 || dir_track > TRACKS || dir_sector < 0 || dir_sector > sectorTable[dir_track - 1]) {
             if (!allocateNewDirectorySector(dir_track, dir_sector, dirSectorPtr)) {
                 throw std::runtime_error("Disk full. Unable to find directory slot");
             }
@@ -249,6 +399,10 @@ bool d64::allocateNewDirectorySector(int& dir_track, int& dir_sector, directoryS
     if (!findAndAllocateFreeSector(dir_track, dir_sector)) {
         return false;
     }
+    // the new sector stays in the directory chain even if the file that needed it fails
+    if (allocations != nullptr) {
+        allocations->pop_back();
+    }
     dirSectorPtr->next.track = dir_track;
     dirSectorPtr->next.sector = dir_sector;
     dirSectorPtr = getDirectory_SectorPtr(dir_track, dir_sector);
@@ -296,7 +450,7 @@ bool d64::allocateDataSector(int& track, int& sector, sectorPtr& sectorPtr)
 /// <param name="fileData">data to write</param>
 /// <param name="offset">offset of data</param>
 /// <param name="bytesLeft">number of bytes left to write</param>
-void d64::writeDataToSector(sectorPtr sectorPtr, const std::vector<uint8_t>& fileData, int& offset, int& bytesLeft)
+void d64::writeDataToSector(sectorPtr sectorPtr, std::span<const uint8_t> fileData, int& offset, int& bytesLeft)
 {
     if (!sectorPtr) {
         throw std::invalid_argument("Invalid null sector pointer");
@@ -357,28 +511,58 @@ void d64::writeDataToSector(sectorPtr sectorPtr, const std::vector<uint8_t>& fil
 /// <param name="type">file type</param>
 /// <param name="fileData">data to the file</param>
 /// <returns>true if successful</returns>
-/// <summary>
 bool d64::addFile(std::string_view filename, c64FileType type, const std::vector<uint8_t>& fileData, int recordSize)
+{
+    return addFile(filename, type, std::span<const uint8_t>(fileData), recordSize);
+}
+
+/// <summary>
+/// Add a file to the disk from a span
+/// </summary>
+/// <param name="filename">file to load</param>
+/// <param name="type">file type</param>
+/// <param name="fileData">data to the file</param>
+/// <param name="recordSize">record size of .REL file</param>
+/// <returns>true if successful, on failure the sectors taken so far are freed again</returns>
+bool d64::addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize)
 {
     // Validate inputs
     if (filename.empty() || fileData.empty()) {
         throw std::runtime_error("Error: Filename or file data cannot be empty");
     }
 
-    // Find and allocate the first sector for the file
-    int start_track, start_sector;
-    if (!findAndAllocateFirstSector(start_track, start_sector)) {
-        return false;
-    }
+    std::vector<trackSector> allocated;
+    allocations = &allocated;
+    auto release = [&]() {
+        allocations = nullptr;
+        for (auto& taken : allocated) {
+            freeSector(taken.track, taken.sector);
+        }
+    };
 
-    // Write file data to sectors
-    auto allocatedSectors = writeFileDataToSectors(start_track, start_sector, fileData);
+    try {
+        // Find and allocate the first sector for the file
+        int start_track, start_sector;
+        if (!findAndAllocateFirstSector(start_track, start_sector)) {
+            release();
+            return false;
+        }
 
-    // Create a directory entry for the file
-    if (!createDirectoryEntry(filename, type, start_track, start_sector, allocatedSectors, recordSize)) {
-        return false;
+        // Write file data to sectors
+        auto allocatedSectors = writeFileDataToSectors(start_track, start_sector, fileData);
+
+        // Create a directory entry for the file
+        if (!createDirectoryEntry(petscii_name(filename), type, start_track, start_sector, allocatedSectors, recordSize)) {
+            release();
+            return false;
+        }
+    }
+    catch (...) {
+        release();
+        throw;
     }
 
+    allocations = nullptr;
     return true;
 }
 
@@ -404,7 +588,7 @@ bool d64::findAndAllocateFirstSector(int& start_track, int& start_sector)
 /// <param name="start_sector">starting sector></param>
 /// <param name="fileData">data to write</param>
 /// <returns>vector of allocated sectors</returns>
-std::vector<trackSector> d64::writeFileDataToSectors(int start_track, int start_sector, const std::vector<uint8_t>& fileData)
+std::vector<trackSector> d64::writeFileDataToSectors(int start_track, int start_sector, std::span<const uint8_t> fileData)
 {
     std::vector<trackSector> allocatedSectors;
     int next_track = start_track;
@@ -438,29 +622,36 @@ std::vector<trackSector> d64::writeFileDataToSectors(int start_track, int start_
 }
 
 /// <summary>
-/// Create a side sector list
+/// Create the side sectors of a .REL file
+/// on a 1581 a super side sector lists the groups of six side sectors
 /// </summary>
 /// <param name="allocatedSectors">list of file sectors</param>
 /// <param name="record_size">size of each record</param>
-/// <returns>list of side sectors</returns>
-std::optional<std::vector<sideSectorPtr>> d64::createSideSectors(const std::vector<trackSector>& allocatedSectors, uint8_t record_size)
+/// <returns>side sector to store in the directory entry</returns>
+std::optional<trackSector> d64::createSideSectors(const std::vector<trackSector>& allocatedSectors, uint8_t record_size)
 {
     int ssecTrack, ssecSector;
     sideSectorPtr sideSector{};
 
+    superSideSectorPtr super = nullptr;
+    int superTrack = 0, superSector = 0;
+    if (disktype == diskType::eighty_track) {
+        if (!allocateSideSector(superTrack, superSector, sideSector)) return std::nullopt;
+        super = reinterpret_cast<superSideSectorPtr>(sideSector);
+        super->id = SUPER_SIDE_SECTOR_ID;
+    }
+
     std::vector<sideSectorPtr> sideSectorList;
-    int block = 0;
-    int sideCount = 0;
+    std::vector<trackSector> positions;
     int chainCount = 0;
 
     if (!allocateSideSector(ssecTrack, ssecSector, sideSector)) return std::nullopt;
 
     sideSectorList.push_back(sideSector);
+    positions.emplace_back(ssecTrack, ssecSector);
     sideSector->recordsize = record_size;
     sideSector->next = { 0, 16 };
-    sideSector->block = block++;
-    sideSectorPtr first = sideSector;
-    first->sideSectors[sideCount++] = { ssecTrack, ssecSector };
+    sideSector->block = 0;
 
     for (const auto& ts : allocatedSectors) {
         if (chainCount < SIDE_SECTOR_CHAIN_SZ) {
@@ -468,13 +659,14 @@ std::optional<std::vector<sideSectorPtr>> d64::createSideSectors(const std::vect
             sideSector->next.sector += 2;
         }
         else {
-            if (sideSectorList.size() >= SIDE_SECTOR_ENTRY_SIZE) {
-                throw std::runtime_error("Exceeded maximum number of side sectors (6)");
+            if (static_cast<int>(sideSectorList.size()) >= maxSideSectors()) {
+                throw std::runtime_error("Exceeded maximum number of side sectors (" + std::to_string(maxSideSectors()) + ")");
             }
             if (!allocateSideSector(ssecTrack, ssecSector, sideSector)) return std::nullopt;
-            first->sideSectors[sideCount++] = { ssecTrack, ssecSector };
             sideSectorList.back()->next = { ssecTrack, ssecSector };
-            sideSector->block = block++;
+            sideSector->block = positions.size() % SIDE_SECTOR_ENTRY_SIZE;
+            sideSectorList.push_back(sideSector);
+            positions.emplace_back(ssecTrack, ssecSector);
             sideSector->recordsize = record_size;
             chainCount = 0;
             sideSector->chain[chainCount++] = ts;
@@ -482,10 +674,71 @@ std::optional<std::vector<sideSectorPtr>> d64::createSideSectors(const std::vect
         }
     }
 
-    for (auto& sideSectors : sideSectorList) {
-        std::copy_n(first->sideSectors, sideCount, sideSectors->sideSectors);
+    // every side sector lists the side sectors of its group
+    for (size_t i = 0; i < sideSectorList.size(); ++i) {
+        auto group = i - i % SIDE_SECTOR_ENTRY_SIZE;
+        auto count = std::min(positions.size() - group, static_cast<size_t>(SIDE_SECTOR_ENTRY_SIZE));
+        std::copy_n(positions.begin() + group, count, sideSectorList[i]->sideSectors);
+    }
+
+    if (super) {
+        super->first = positions[0];
+        for (size_t group = 0; group * SIDE_SECTOR_ENTRY_SIZE < positions.size(); ++group) {
+            super->groups[group] = positions[group * SIDE_SECTOR_ENTRY_SIZE];
+        }
+        return trackSector(superTrack, superSector);
+    }
+    return positions[0];
+}
+
+/// <summary>
+/// Skip the super side sector of a 1581 .REL file
+/// </summary>
+/// <param name="side">side sector of the directory entry</param>
+/// <returns>first side sector of the file</returns>
+trackSector d64::firstSideSector(trackSector side)
+{
+    if (side.track == 0) return side;
+    auto super = reinterpret_cast<superSideSectorPtr>(getSideSectorPtr(side.track, side.sector));
+    return super->id == SUPER_SIDE_SECTOR_ID ? super->first : side;
+}
+
+/// <summary>
+/// Find a side sector of a .REL file by its number
+/// the super side sector and the group lists make this a fixed number of lookups
+/// </summary>
+/// <param name="entry">directory entry of the file</param>
+/// <param name="index">side sector number starting at 0</param>
+/// <returns>side sector or nullopt if the file has fewer</returns>
+std::optional<sideSectorPtr> d64::sideSectorAt(const directoryEntry& entry, int index)
+{
+    if (index < 0 || entry.side.track == 0) return std::nullopt;
+
+    auto first = entry.side;
+    auto super = reinterpret_cast<superSideSectorPtr>(getSideSectorPtr(first.track, first.sector));
+    if (super->id == SUPER_SIDE_SECTOR_ID) {
+        auto group = index / SIDE_SECTOR_ENTRY_SIZE;
+        if (group >= SUPER_SIDE_SECTOR_GROUPS) return std::nullopt;
+        first = super->groups[group];
+        index %= SIDE_SECTOR_ENTRY_SIZE;
     }
-    return sideSectorList;
+    else if (index >= SIDE_SECTOR_ENTRY_SIZE) {
+        return std::nullopt;
+    }
+    if (first.track == 0) return std::nullopt;
+
+    auto position = getSideSectorPtr(first.track, first.sector)->sideSectors[index];
+    if (position.track == 0) return std::nullopt;
+    return getSideSectorPtr(position.track, position.sector);
+}
+
+/// <summary>
+/// Most side sectors a .REL file can have
+/// </summary>
+/// <returns>6, or 6 per group of the super side sector on a 1581</returns>
+int d64::maxSideSectors() const
+{
+    return disktype == diskType::eighty_track ? SIDE_SECTOR_ENTRY_SIZE * SUPER_SIDE_SECTOR_GROUPS : SIDE_SECTOR_ENTRY_SIZE;
 }
 
 /// <summary>
@@ -497,30 +750,32 @@ std::optional<std::vector<sideSectorPtr>> d64::createSideSectors(const std::vect
 /// <param name="start_sector">first sector</param>
 /// <param name="allocated_sectors">number of sectors</param>
 /// <returns>true on success</returns>
-bool d64::createDirectoryEntry(std::string_view filename, c64FileType type, int start_track, int start_sector, const std::vector<trackSector>& allocatedSectors, uint8_t record_size)
+bool d64::createDirectoryEntry(const petscii_name& filename, c64FileType type, int start_track, int start_sector, const std::vector<trackSector>& allocatedSectors, uint8_t record_size)
 {
     auto fileEntry = findEmptyDirectorySlot();
     if (!fileEntry.has_value()) {
         return false;
     }
 
+    // create side sectors for .REL files before the entry is filled, so a failure leaves the slot empty
+    std::optional<trackSector> side;
+    if (type.type == d64FileTypes::REL) {
+        side = createSideSectors(allocatedSectors, record_size);
+        if (!side.has_value()) {
+            throw std::runtime_error("Error: Unable to create side sector list");
+        }
+    }
+
     fileEntry.value()->file_type = type;
     fileEntry.value()->start.track = start_track;
     fileEntry.value()->start.sector = start_sector;
 
-    auto len = std::min(filename.size(), static_cast<size_t>(FILE_NAME_SZ));
-    std::copy_n(filename.begin(), len, fileEntry.value()->fileName);
-    std::fill(fileEntry.value()->fileName + len, fileEntry.value()->fileName + FILE_NAME_SZ, static_cast<char>(A0_VALUE));
+    filename.copyTo(fileEntry.value()->fileName);
 
-    // create side sectors for .REL files
-    if (type.type == d64FileTypes::REL) {
-        auto sideSectorList = createSideSectors(allocatedSectors, record_size);
-        if (!sideSectorList.has_value() || sideSectorList.value().size() < 1) {
-            throw std::runtime_error("Error: Unable to create side sector list");
-        }
+    if (side.has_value()) {
         fileEntry.value()->recordLength = record_size;
-        fileEntry.value()->side.track = sideSectorList.value()[0]->sideSectors[0].track;
-        fileEntry.value()->side.sector = sideSectorList.value()[0]->sideSectors[0].sector;
+        fileEntry.value()->side.track = side.value().track;
+        fileEntry.value()->side.sector = side.value().sector;
     }
     else {
         fileEntry.value()->recordLength = 0;
@@ -559,14 +814,28 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
     }
 
     // Temp map to count sector usage
-    std::array<std::array<bool, 21>, TRACKS_40> sectorUsage = {}; // Max sectors per track
+    std::array<std::array<bool, D81_TRACK_SECTORS>, TRACKS_80> sectorUsage = {}; // Max sectors per track
 
     // **Step 1: Mark BAM itself as used**
-    sectorUsage[DIRECTORY_TRACK - 1][BAM_SECTOR] = true;
+    sectorUsage[dirTrack - 1][BAM_SECTOR] = true;
+    if (disktype == diskType::seventy_track) {
+        sectorUsage[D71_BAM_TRACK - 1].fill(true);
+    }
+    if (disktype == diskType::eighty_track) {
+        sectorUsage[dirTrack - 1][D81_BAM_SECTOR] = true;
+        sectorUsage[dirTrack - 1][D81_BAM_SECTOR + 1] = true;
+
+        // the BAM of a partition shows the rest of the disk as used
+        for (auto track = 1; partitionTracks > 0 && track <= TRACKS; ++track) {
+            if (track < partitionStart || track >= partitionStart + partitionTracks) {
+                sectorUsage[track - 1].fill(true);
+            }
+        }
+    }
 
     // **Step 2: Scan directory for used sectors**
-    auto dir_track = DIRECTORY_TRACK;
-    auto dir_sector = DIRECTORY_SECTOR;
+    auto dir_track = dirTrack;
+    auto dir_sector = dirSector;
     directorySectorPtr dirSectorPtr;
 
     while (dir_track != 0) {
@@ -583,18 +852,27 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
             int sector = entry.start.sector;
             sectorUsage[track - 1][sector] = true;
 
-            if (entry.file_type.type == d64FileTypes::REL) {
-                // get the first location of a side sector
-                trackSector sidePosition = entry.side;
-
-                // load the side sector 
-                sideSectorPtr side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
-                for (auto side_sectors : side->sideSectors) {
-                    if (side_sectors.track == 0)
-                        break;
+            if (entry.file_type.type == d64FileTypes::CBM) {
+                // a partition is a contiguous run of sectors
+                auto size = entry.fileSize[0] | (entry.fileSize[1] << 8);
+                for (auto i = 0; i < size; ++i) {
+                    auto position = sector + i;
+                    auto partitionTrack = track + position / D81_TRACK_SECTORS;
+                    if (!isValidTrackSector(partitionTrack, position % D81_TRACK_SECTORS)) break;
+                    sectorUsage[partitionTrack - 1][position % D81_TRACK_SECTORS] = true;
+                }
+            }
+            else if (entry.file_type.type == d64FileTypes::REL) {
+                // the super side sector if there is one
+                if (entry.side.track != 0) {
+                    sectorUsage[entry.side.track - 1][entry.side.sector] = true;
+                }
 
-                    side = getSideSectorPtr(side_sectors.track, side_sectors.sector);
-                    sectorUsage[side_sectors.track - 1][side_sectors.sector] = true;
+                // follow the side sectors through all groups
+                auto sidePosition = firstSideSector(entry.side);
+                for (auto count = 0; sidePosition.track != 0 && count < MAX_CHAIN_SECTORS; ++count) {
+                    auto side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
+                    sectorUsage[sidePosition.track - 1][sidePosition.sector] = true;
 
                     for (auto chainEntry : side->chain) {
                         if (chainEntry.track == 0) {
@@ -602,6 +880,7 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
                         }
                         sectorUsage[chainEntry.track - 1][chainEntry.sector] = true;
                     }
+                    sidePosition = side->next;
                 }
             }
             else {
@@ -625,8 +904,8 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
     for (auto track = 1; track <= TRACKS; ++track) {
         auto correctFreeCount = 0;
 
-        for (auto sector = 0; sector < SECTORS_PER_TRACK[track - 1]; ++sector) {
-            auto isFreeInBAM = bamtrack(track - 1)->test(sector);
+        for (auto sector = 0; sector < sectorTable[track - 1]; ++sector) {
+            auto isFreeInBAM = bamtrack(track - 1).test(sector);
             auto isUsedInDirectory = sectorUsage[track - 1][sector];
 
             // Error: Sector incorrectly marked as used
@@ -637,7 +916,7 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
 
                 if (fix) {
                     *logOutput << "FIXING: Freeing sector " << sector << " on Track " << track << ".\n";
-                    bamtrack(track - 1)->set(sector);
+                    bamtrack(track - 1).set(sector);
                 }
             }
 
@@ -649,7 +928,7 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
 
                 if (fix) {
                     *logOutput << "FIXING: Marking sector " << sector << " on Track " << track << " as used.\n";
-                    bamtrack(track - 1)->reset(sector);
+                    bamtrack(track - 1).reset(sector);
                 }
             }
 
@@ -659,7 +938,7 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
         }
 
         // Error: Incorrect free sector count
-        int free = bamtrack(track - 1)->free;
+        int free = bamtrack(track - 1).free;
 
         if (free != correctFreeCount) {
             *logOutput << "WARNING: BAM free sector count mismatch on Track " << track
@@ -669,7 +948,7 @@ bool d64::verifyBAMIntegrity(bool fix, const std::string& logFile)
 
             if (fix) {
                 *logOutput << "FIXING: Correcting free sector count for Track " << track << ".\n";
-                bamtrack(track - 1)->free = correctFreeCount;
+                bamtrack(track - 1).free = correctFreeCount;
             }
         }
     }
@@ -724,8 +1003,8 @@ bool d64::compactDirectory()
 {
     std::vector<directoryEntry> files;
 
-    int dir_track = DIRECTORY_TRACK;
-    int dir_sector = DIRECTORY_SECTOR;
+    int dir_track = dirTrack;
+    int dir_sector = dirSector;
     directorySectorPtr dirSectorPtr;
 
     // **Step 1: Collect all valid directory entries**
@@ -746,8 +1025,8 @@ bool d64::compactDirectory()
     if (files.empty()) return false; // No valid files
 
     // **Step 2: Rewrite the directory with compacted entries**
-    dir_track = DIRECTORY_TRACK;
-    dir_sector = DIRECTORY_SECTOR;
+    dir_track = dirTrack;
+    dir_sector = dirSector;
     dirSectorPtr = getDirectory_SectorPtr(dir_track, dir_sector);
 
     size_t index = 0;
@@ -767,8 +1046,8 @@ bool d64::compactDirectory()
                 int next_track = dirSectorPtr->next.track;
                 int next_sector = dirSectorPtr->next.sector;
 
-                // never mark track 18 as free
-                if (dir_track != DIRECTORY_TRACK || dir_sector != DIRECTORY_SECTOR) {
+                // never mark the first directory sector as free
+                if (dir_track != dirTrack || dir_sector != dirSector) {
 
                     // Free the sector in BAM
                     freeSector(dir_track, dir_sector);
@@ -802,10 +1081,24 @@ bool d64::compactDirectory()
 /// <param name="filename">file to find</param>
 /// <returns>optional pointer to the fiels directory entry</returns>
 std::optional<directoryEntryPtr> d64::findFile(std::string_view filename)
+{
+    // a name that can not be stored never matches
+    if (filename.size() > FILE_NAME_SZ || filename.find(static_cast<char>(A0_VALUE)) != std::string_view::npos) {
+        return std::nullopt;
+    }
+    return findFile(petscii_name(filename));
+}
+
+/// <summary>
+/// find a file on the disk
+/// </summary>
+/// <param name="filename">padded name of file to find</param>
+/// <returns>optional pointer to the fiels directory entry</returns>
+std::optional<directoryEntryPtr> d64::findFile(const petscii_name& filename)
 {
     try {
-        auto dir_track = DIRECTORY_TRACK;
-        auto dir_sector = DIRECTORY_SECTOR;
+        auto dir_track = dirTrack;
+        auto dir_sector = dirSector;
 
         while (dir_track != 0) {
             auto dirSectorPtr = getDirectory_SectorPtr(dir_track, dir_sector);
@@ -813,9 +1106,8 @@ std::optional<directoryEntryPtr> d64::findFile(std::string_view filename)
                 if (fileEntry.file_type.closed == 0) {
                     continue;
                 }
-                std::string entryName(fileEntry.fileName, FILE_NAME_SZ);
-                entryName.erase(std::find_if(entryName.begin(), entryName.end(), [](char c) { return c == static_cast<char>(A0_VALUE); }), entryName.end());
-                if (entryName == filename) {
+                // names are normally padded so try the direct compare first
+                if (filename.equalsPadded(fileEntry.fileName) || filename == petscii_name::fromRaw(fileEntry.fileName)) {
                     return &fileEntry;
                 }
             }
@@ -850,6 +1142,15 @@ bool d64::removeFile(std::string_view filename)
         int track = fileEntry.value()->start.track;
         int sector = fileEntry.value()->start.sector;
 
+        // a partition has no chain, its sectors follow each other
+        if (fileEntry.value()->file_type.type == d64FileTypes::CBM) {
+            auto size = fileEntry.value()->fileSize[0] | (fileEntry.value()->fileSize[1] << 8);
+            for (auto i = 0; i < size; ++i) {
+                freeSector(track + (sector + i) / D81_TRACK_SECTORS, (sector + i) % D81_TRACK_SECTORS);
+            }
+            track = 0;
+        }
+
         while (track != 0) {
             auto sectorPtr = getTrackSectorPtr(track, sector);
             auto next_track = sectorPtr->track;
@@ -883,9 +1184,23 @@ bool d64::renameFile(std::string_view oldfilename, std::string_view newfilename)
     if (!fileEntry.has_value()) {
         throw std::runtime_error("File not found: " + std::string(oldfilename));
     }
-    auto len = std::min(newfilename.size(), static_cast<size_t>(FILE_NAME_SZ));
-    std::copy_n(newfilename.begin(), len, fileEntry.value()->fileName);
-    std::fill(fileEntry.value()->fileName + len, fileEntry.value()->fileName + FILE_NAME_SZ, static_cast<char>(A0_VALUE));
+    petscii_name(newfilename).copyTo(fileEntry.value()->fileName);
+    return true;
+}
+
+/// <summary>
+/// Rename a file
+/// </summary>
+/// <param name="oldfilename">padded old file name</param>
+/// <param name="newfilename">padded new file name</param>
+/// <returns>true if successful</returns>
+bool d64::renameFile(const petscii_name& oldfilename, const petscii_name& newfilename)
+{
+    auto fileEntry = findFile(oldfilename);
+    if (!fileEntry.has_value()) {
+        throw std::runtime_error("File not found: " + std::string(oldfilename.view()));
+    }
+    newfilename.copyTo(fileEntry.value()->fileName);
     return true;
 }
 
@@ -957,10 +1272,42 @@ std::optional<std::vector<uint8_t>> d64::readFile(std::string filename)
 
     // the file data will be stored here
     std::vector<uint8_t> fileData;
+    readFileData(fileEntry.value(), fileData);
+
+    // exit
+    return fileData;
+}
 
+/// <summary>
+/// get file data from the disk
+/// allocating the result from a memory resource
+/// </summary>
+/// <param name="filename">file to read</param>
+/// <param name="resource">memory resource for the result</param>
+/// <returns>file data allocated from resource</returns>
+std::optional<std::pmr::vector<uint8_t>> d64::readFile(std::string_view filename, std::pmr::memory_resource* resource)
+{
+    auto fileEntry = findFile(filename);
+    if (!fileEntry.has_value()) {
+        throw std::runtime_error("File not found: " + std::string(filename));
+    }
+
+    std::pmr::vector<uint8_t> fileData(resource);
+    readFileData(fileEntry.value(), fileData);
+    return fileData;
+}
+
+/// <summary>
+/// append the data of a file to a container
+/// </summary>
+/// <param name="fileEntry">directory entry of the file</param>
+/// <param name="fileData">container to append to</param>
+template <typename Container>
+void d64::readFileData(directoryEntryPtr fileEntry, Container& fileData)
+{
     // get the files start track and sector
-    int track = fileEntry.value()->start.track;
-    int sector = fileEntry.value()->start.sector;
+    int track = fileEntry->start.track;
+    int sector = fileEntry->start.sector;
 
     // track 0 signifies end
     while (track != 0) {
@@ -977,9 +1324,42 @@ std::optional<std::vector<uint8_t>> d64::readFile(std::string filename)
         track = sectorPtr->next.track;
         sector = sectorPtr->next.sector;
     }
+}
 
-    // exit
-    return fileData;
+/// <summary>
+/// Get the payload of a file sector and step to the next sector
+/// the payload is a view into the image so nothing is copied
+/// </summary>
+/// <param name="position">current sector, updated to the next one. track 0 ends the chain</param>
+/// <returns>payload of the sector or nullopt at the end of the chain</returns>
+std::optional<std::span<const uint8_t>> d64::nextFileBlock(trackSector& position)
+{
+    if (position.track == 0) return std::nullopt;
+
+    auto sectorPtr = getSectorPtr(position.track, position.sector);
+    size_t bytes = sizeof(sectorPtr->data);
+    if (sectorPtr->next.track == 0) {
+        bytes = std::min(bytes, static_cast<size_t>(std::max(sectorPtr->next.sector - 1, 0)));
+    }
+    position = sectorPtr->next;
+    return std::span<const uint8_t>(sectorPtr->data.data(), bytes);
+}
+
+/// <summary>
+/// Walk the sectors of a file without copying them
+/// </summary>
+/// <param name="entry">directory entry of the file</param>
+/// <param name="block">called with the payload of each sector, return false to stop</param>
+/// <returns>true if the whole chain was read</returns>
+bool d64::readFileBlocks(const directoryEntry& entry, const std::function<bool(std::span<const uint8_t>)>& block)
+{
+    trackSector position = entry.start;
+    for (auto count = 0; count < MAX_CHAIN_SECTORS; ++count) {
+        auto payload = nextFileBlock(position);
+        if (!payload.has_value()) return true;
+        if (!block(payload.value())) return false;
+    }
+    throw std::runtime_error("Sector chain loops for file " + Trim(entry.fileName));
 }
 
 /// <summary>
@@ -989,13 +1369,23 @@ std::optional<std::vector<uint8_t>> d64::readFile(std::string filename)
 std::string d64::diskname()
 {
     std::string name;
-    for (auto& ch : diskBamPtr->diskName) {
-        if (ch == static_cast<char>(0xA0)) return name;
-        name += ch;
+    auto field = diskNameField();
+    for (auto i = 0; i < DISK_NAME_SZ; ++i) {
+        if (field[i] == static_cast<char>(0xA0)) return name;
+        name += field[i];
     }
     return name;
 }
 
+/// <summary>
+/// Disk name in the BAM, or in the header of a 1581 disk or partition
+/// </summary>
+/// <returns>DISK_NAME_SZ characters padded with A0</returns>
+char* d64::diskNameField() const
+{
+    return disktype == diskType::eighty_track ? headerPtr->diskName : diskBamPtr->diskName;
+}
+
 /// <summary>
 /// save image to disk
 /// </summary>
@@ -1031,10 +1421,12 @@ bool d64::load(std::string filename)
         auto pos = inFile.tellg();
 
         inFile.seekg(0, std::ios::beg);
-        if (pos != D64_DISK35_SZ && pos != D64_DISK40_SZ) {
+        if (pos != D64_DISK35_SZ && pos != D64_DISK40_SZ && pos != D71_DISK_SZ && pos != D81_DISK_SZ) {
             throw std::invalid_argument("Invalid disk size");
         }
-        disktype = (pos == D64_DISK35_SZ) ? diskType::thirty_five_track : diskType::forty_track;
+        disktype = (pos == D64_DISK35_SZ) ? diskType::thirty_five_track :
+            (pos == D64_DISK40_SZ) ? diskType::forty_track :
+            (pos == D71_DISK_SZ) ? diskType::seventy_track : diskType::eighty_track;
 
         // allocate the disk
         init_disk();
@@ -1079,22 +1471,30 @@ bool d64::freeSector(const int& track, const int& sector)
     if (!isValidTrackSector(track, sector)) {
         throw std::runtime_error("Invalid Tack and Sector TRACK:" + std::to_string(track) + " SECTOR:" + std::to_string(sector));
     }
-    if (track == DIRECTORY_TRACK && sector == DIRECTORY_SECTOR) {
-        std::cerr << "Warning: Attempt to free directory sector ignored (Track 18, Sector 1)\n";
+    if (track == dirTrack && sector == dirSector) {
+        std::cerr << "Warning: Attempt to free directory sector ignored (Track " << track << ", Sector " << sector << ")\n";
         return false;
     }
-    if (track == DIRECTORY_TRACK && sector == BAM_SECTOR) {
-        std::cerr << "Warning: Attempt to free directory sector ignored (Track 18, Sector 0)\n";
+    if (track == dirTrack && sector == BAM_SECTOR) {
+        std::cerr << "Warning: Attempt to free directory sector ignored (Track " << track << ", Sector 0)\n";
+        return false;
+    }
+    if (disktype == diskType::eighty_track && track == dirTrack && sector < dirSector) {
+        std::cerr << "Warning: Attempt to free BAM sector ignored (Track " << track << ", Sector " << sector << ")\n";
+        return false;
+    }
+    if (disktype == diskType::seventy_track && track == D71_BAM_TRACK && sector == BAM_SECTOR) {
+        std::cerr << "Warning: Attempt to free BAM sector ignored (Track 53, Sector 0)\n";
         return false;
     }
 
     // calculate byte of BAM entry for track
     // its stored as a bitmap of 3 bytes. 1 if free and 0 if allocated    
-    if (bamtrack(track - 1)->test(sector))
+    if (bamtrack(track - 1).test(sector))
         return false;
     
-    bamtrack(track - 1)->set(sector);   // mark track sector as free 
-    bamtrack(track - 1)->free++;            // increment free
+    bamtrack(track - 1).set(sector);   // mark track sector as free 
+    bamtrack(track - 1).free++;            // increment free
 
     return true;
 }
@@ -1107,7 +1507,7 @@ bool d64::freeSector(const int& track, const int& sector)
 /// <returns>true if valid</returns>
 bool d64::isValidTrackSector(int track, int sector) const
 {
-    return track >= 1 && track <= TRACKS && sector >= 0 && sector < SECTORS_PER_TRACK[track - 1];
+    return track >= 1 && track <= TRACKS && sector >= 0 && sector < sectorTable[track - 1];
 }
 
 /// <summary>
@@ -1123,11 +1523,14 @@ bool d64::allocateSector(const int& track, const int& sector)
         throw std::runtime_error("Invalid Tack and Sector TRACK:" + std::to_string(track) + " SECTOR:" + std::to_string(sector));
     }
 
-    if (!bamtrack(track - 1)->test(sector))
+    if (!bamtrack(track - 1).test(sector))
         return false;
 
-    bamtrack(track - 1)->reset(sector); // mark track sector as ALLOCATED 
-    bamtrack(track - 1)->free--;        // decrement free
+    bamtrack(track - 1).reset(sector); // mark track sector as ALLOCATED 
+    bamtrack(track - 1).free--;        // decrement free
+    if (allocations != nullptr) {
+        allocations->push_back({ static_cast<uint8_t>(track), static_cast<uint8_t>(sector) });
+    }
 
     return true;
 }
@@ -1145,17 +1548,18 @@ bool d64::findAndAllocateFreeOnTrack(int track, int& sector)
     }
 
     // if there are no free sectors in the track go to next track
-    if (bamtrack(track - 1)->free < 1) 
+    if (bamtrack(track - 1).free < 1) 
         return false;
 
-    auto start_sector = (lastSectorUsed[track - 1] + INTERLEAVE) % SECTORS_PER_TRACK[track - 1];
+    auto sectors = sectorTable[track - 1];
+    auto start_sector = (lastSectorUsed[track - 1] + INTERLEAVE) % sectors;
 
     // find the free sector
-    for (auto i = 0; i < SECTORS_PER_TRACK[track - 1]; ++i) {
-        int search_sector = (start_sector + i) % SECTORS_PER_TRACK[track - 1]; // Wrap around
+    for (auto i = 0; i < sectors; ++i) {
+        int search_sector = (start_sector + i) % sectors; // Wrap around
 
         // see if sector is free
-        if (bamtrack(track - 1)->test(search_sector)) {
+        if (bamtrack(track - 1).test(search_sector)) {
             allocateSector(track, search_sector);
             sector = search_sector;
             // update the last sector used for the track
@@ -1174,12 +1578,21 @@ bool d64::findAndAllocateFreeOnTrack(int track, int& sector)
 /// <returns>true if successful</returns>
 bool d64::findAndAllocateFreeSector(int& track, int& sector)
 {
-    static const std::array<int, 40> TRACK_40_SEARCH_ORDER = {
-        18, 17, 19, 16, 20, 15, 21, 14, 22, 13, 23, 12, 24, 11, 25, 10, 26, 9,
-        27, 8, 28, 7, 29, 6, 30, 5, 31, 4, 32, 3, 33, 2, 34, 1, 35, 36, 37, 38, 39, 40
-    };
+    // a 1581 works outward from the directory of the open partition
+    if (disktype == diskType::eighty_track) {
+        for (auto step = 0; step < 2 * TRACKS; ++step) {
+            auto t = dirTrack + (step % 2 ? -(step + 1) / 2 : step / 2);
+            if (t >= 1 && t <= TRACKS && findAndAllocateFreeOnTrack(t, sector)) {
+                track = t;
+                return true;
+            }
+        }
+        return false;
+    }
 
-    for (auto& t : TRACK_40_SEARCH_ORDER) {
+    auto order = disktype == diskType::seventy_track ?
+        std::span<const int>(TRACK_70_SEARCH_ORDER) : std::span<const int>(TRACK_40_SEARCH_ORDER);
+    for (auto& t : order) {
         if (disktype == diskType::thirty_five_track && t > TRACKS_35)
             continue;
         if (findAndAllocateFreeOnTrack(t, sector)) {
@@ -1203,12 +1616,27 @@ uint16_t d64::getFreeSectorCount()
     // loop through tracks
     for (auto t = 1; t <= TRACKS; ++t) {
 
-        // skip directory track
-        if (t == DIRECTORY_TRACK)
+        // skip directory track and the BAM track of a 1571
+        if (t == dirTrack || (disktype == diskType::seventy_track && t == D71_BAM_TRACK))
             continue;
 
         // add the free bytes of each track
-        free += static_cast<uint16_t>(bamtrack(t - 1)->free);
+        free += static_cast<uint16_t>(bamtrack(t - 1).free);
+    }
+    return free;
+}
+
+/// <summary>
+/// Get the number of sectors the allocator can still hand out
+/// unlike getFreeSectorCount this includes the directory track,
+/// file data is placed there as well
+/// </summary>
+/// <returns>number of allocatable sectors</returns>
+uint16_t d64::getAllocatableSectorCount()
+{
+    uint16_t free = 0;
+    for (auto t = 1; t <= TRACKS; ++t) {
+        free += static_cast<uint16_t>(bamtrack(t - 1).free);
     }
     return free;
 }
@@ -1221,6 +1649,10 @@ uint16_t d64::getFreeSectorCount()
 /// <param name="name"></param>
 void d64::initializeBAMFields(std::string_view name)
 {
+    if (disktype == diskType::eighty_track) {
+        initializeD81Fields(name);
+        return;
+    }
     if (!diskBamPtr) {
         throw std::runtime_error("Invalid BAM pointer");
     }
@@ -1229,7 +1661,7 @@ void d64::initializeBAMFields(std::string_view name)
     diskBamPtr->dirStart.sector = DIRECTORY_SECTOR;
 
     diskBamPtr->dosVersion = DOS_VERSION;
-    diskBamPtr->unused = 0;
+    diskBamPtr->unused = disktype == diskType::seventy_track ? D71_DOUBLE_SIDED : 0;
 
     auto len = std::min(name.size(), static_cast<size_t>(DISK_NAME_SZ));
     std::fill_n(diskBamPtr->diskName, DISK_NAME_SZ, static_cast<char>(A0_VALUE));
@@ -1253,6 +1685,150 @@ void d64::initializeBAMFields(std::string_view name)
     std::fill_n(diskBamPtr->unused4, UNUSED4_SZ, 0x00);
 }
 
+/// <summary>
+/// Initialize the header and the two BAM sectors of a 1581 disk or partition
+/// every track starts out as used, the caller frees its own tracks
+/// </summary>
+/// <param name="name">name of the disk or partition</param>
+void d64::initializeD81Fields(std::string_view name)
+{
+    std::fill_n(data.begin() + calcOffset(dirTrack, BAM_SECTOR), SECTOR_SIZE * D81_DIRECTORY_SECTOR, 0);
+
+    headerPtr->dirStart = { dirTrack, dirSector };
+    headerPtr->dosVersion = D81_DOS_VERSION;
+    std::fill_n(headerPtr->diskName, DISK_NAME_SZ, static_cast<char>(A0_VALUE));
+    std::copy_n(name.begin(), std::min(name.size(), static_cast<size_t>(DISK_NAME_SZ)), headerPtr->diskName);
+    headerPtr->a0[0] = A0_VALUE;
+    headerPtr->a0[1] = A0_VALUE;
+    headerPtr->diskId[0] = A0_VALUE;
+    headerPtr->diskId[1] = A0_VALUE;
+    headerPtr->unused2 = A0_VALUE;
+    headerPtr->dos_type[0] = D81_DOS_TYPE;
+    headerPtr->dos_type[1] = D81_DOS_VERSION;
+    headerPtr->a0b[0] = A0_VALUE;
+    headerPtr->a0b[1] = A0_VALUE;
+
+    for (auto sector = D81_BAM_SECTOR; sector <= D81_BAM_SECTOR + 1; ++sector) {
+        auto bamSector = reinterpret_cast<d81BamPtr>(&data[calcOffset(dirTrack, sector)]);
+        bamSector->next = sector == D81_BAM_SECTOR ? trackSector(dirTrack, sector + 1) : trackSector(0, 0xFF);
+        bamSector->dosVersion = D81_DOS_VERSION;
+        bamSector->versionComplement = D81_VERSION_COMPLEMENT;
+        bamSector->diskId[0] = A0_VALUE;
+        bamSector->diskId[1] = A0_VALUE;
+        bamSector->ioByte = D81_IO_BYTE;
+    }
+}
+
+/// <summary>
+/// Create a 1581 partition that holds its own directory
+/// the whole tracks are taken from the open directory and formatted
+/// </summary>
+/// <param name="name">name of the partition</param>
+/// <param name="startTrack">first track of the partition</param>
+/// <param name="tracks">number of tracks, at least 3</param>
+/// <returns>true on success, false if a track is not free</returns>
+bool d64::createPartition(std::string_view name, int startTrack, int tracks)
+{
+    if (disktype != diskType::eighty_track) {
+        throw std::invalid_argument("Partitions need a 1581 disk");
+    }
+    if (tracks < D81_PARTITION_MIN_TRACKS || startTrack < 1 || startTrack + tracks - 1 > TRACKS ||
+        (dirTrack >= startTrack && dirTrack < startTrack + tracks)) {
+        throw std::invalid_argument("Invalid partition tracks");
+    }
+    if (findFile(name).has_value()) {
+        return false;
+    }
+
+    // claim the directory slot before the tracks, a new directory sector may land on them
+    // and once they are taken the entry below can no longer fail and leave them lost
+    if (!findEmptyDirectorySlot().has_value()) {
+        return false;
+    }
+    for (auto t = startTrack; t < startTrack + tracks; ++t) {
+        if (bamtrack(t - 1).free != sectorCount(t)) return false;
+    }
+
+    // take the tracks from the open directory
+    std::vector<trackSector> sectors;
+    for (auto t = startTrack; t < startTrack + tracks; ++t) {
+        bamtrack(t - 1).free = 0;
+        bamtrack(t - 1).clear();
+        for (auto s = 0; s < sectorCount(t); ++s) {
+            sectors.emplace_back(t, s);
+        }
+    }
+    if (!createDirectoryEntry(petscii_name(name), c64FileType(d64FileTypes::CBM), startTrack, 0, sectors, 0)) {
+        return false;
+    }
+
+    // format the partition like a disk of its own
+    auto parentTrack = dirTrack;
+    dirTrack = startTrack;
+    initBAMPtr();
+    initializeD81Fields(name);
+    for (auto t = startTrack; t < startTrack + tracks; ++t) {
+        auto bam = bamtrack(t - 1);
+        bam.free = sectorCount(t);
+        for (auto s = 0; s < sectorCount(t); ++s) {
+            bam.set(s);
+        }
+    }
+    auto index = calcOffset(dirTrack, D81_DIRECTORY_SECTOR);
+    std::fill_n(data.begin() + index, SECTOR_SIZE, 0);
+    data[index + 1] = 0xFF;
+    for (auto s = BAM_SECTOR; s <= D81_DIRECTORY_SECTOR; ++s) {
+        allocateSector(dirTrack, s);
+    }
+
+    dirTrack = parentTrack;
+    initBAMPtr();
+    return true;
+}
+
+/// <summary>
+/// Make a partition of the open directory the open directory
+/// file functions work inside the partition until openRoot is called
+/// </summary>
+/// <param name="name">name of the partition</param>
+/// <returns>true on success</returns>
+bool d64::openPartition(std::string_view name)
+{
+    if (disktype != diskType::eighty_track) return false;
+
+    auto entry = findFile(name);
+    if (!entry.has_value() || entry.value()->file_type.type != d64FileTypes::CBM) return false;
+
+    auto start = entry.value()->start;
+    auto size = entry.value()->fileSize[0] | (entry.value()->fileSize[1] << 8);
+    if (start.sector != 0 || size % D81_TRACK_SECTORS != 0 || size / D81_TRACK_SECTORS < D81_PARTITION_MIN_TRACKS) {
+        return false;
+    }
+    auto header = reinterpret_cast<d81HeaderPtr>(&data[calcOffset(start.track, BAM_SECTOR)]);
+    if (header->dirStart.track != start.track || header->dirStart.sector != D81_DIRECTORY_SECTOR) {
+        return false;
+    }
+
+    partitionStart = start.track;
+    partitionTracks = size / D81_TRACK_SECTORS;
+    dirTrack = start.track;
+    dirSector = D81_DIRECTORY_SECTOR;
+    initBAMPtr();
+    return true;
+}
+
+/// <summary>
+/// Make the root directory the open directory
+/// </summary>
+void d64::openRoot()
+{
+    partitionStart = 0;
+    partitionTracks = 0;
+    dirTrack = disktype == diskType::eighty_track ? D81_DIRECTORY_TRACK : DIRECTORY_TRACK;
+    dirSector = disktype == diskType::eighty_track ? D81_DIRECTORY_SECTOR : DIRECTORY_SECTOR;
+    initBAMPtr();
+}
+
 /// <summary>
 /// Trim a file name
 /// stops at A0 padding
@@ -1313,8 +1889,8 @@ bool d64::reorderDirectory(std::vector<directoryEntry>& files)
     if (currentFiles == files)
         return false;  // No need to rewrite if already in the correct order
 
-    int dir_track = DIRECTORY_TRACK;
-    int dir_sector = DIRECTORY_SECTOR;
+    int dir_track = dirTrack;
+    int dir_sector = dirSector;
     auto dirSectorPtr = getDirectory_SectorPtr(dir_track, dir_sector);
     size_t index = 0;
 
@@ -1361,9 +1937,32 @@ bool d64::reorderDirectory(std::function<bool(const directoryEntry&, const direc
 std::vector<directoryEntry> d64::directory()
 {
     std::vector<directoryEntry> files;
+    readDirectory(files);
+    return files;
+}
 
-    int dir_track = DIRECTORY_TRACK;
-    int dir_sector = DIRECTORY_SECTOR;
+/// <summary>
+/// return the current directory entries
+/// allocating the result from a memory resource
+/// </summary >
+/// <param name="resource">memory resource for the result</param>
+/// <returns>current directory entries</returns>
+std::pmr::vector<directoryEntry> d64::directory(std::pmr::memory_resource* resource)
+{
+    std::pmr::vector<directoryEntry> files(resource);
+    readDirectory(files);
+    return files;
+}
+
+/// <summary>
+/// append the directory entries to a container
+/// </summary>
+/// <param name="files">container to append to</param>
+template <typename Container>
+void d64::readDirectory(Container& files)
+{
+    int dir_track = dirTrack;
+    int dir_sector = dirSector;
 
     // Read all directory entries
     while (dir_track != 0) {
@@ -1376,7 +1975,6 @@ std::vector<directoryEntry> d64::directory()
         dir_track = dirSectorPtr->next.track;
         dir_sector = dirSectorPtr->next.sector;
     }
-    return files;
 }
 
 /// <summary>
@@ -1385,21 +1983,24 @@ std::vector<directoryEntry> d64::directory()
 /// <returns>true if valid</returns>
 bool d64::validateD64()
 {
-    auto sz = disktype == diskType::thirty_five_track ? D64_DISK35_SZ : D64_DISK40_SZ;
+    auto sz = disktype == diskType::thirty_five_track ? D64_DISK35_SZ :
+        disktype == diskType::forty_track ? D64_DISK40_SZ :
+        disktype == diskType::seventy_track ? D71_DISK_SZ : D81_DISK_SZ;
     if (data.size() != sz) {
         std::cerr << "Error: Invalid .d64 size (" << data.size() << " bytes), expected " << sz << " bytes\n";
         return false;
     }
 
-    if (diskBamPtr->dirStart.track != DIRECTORY_TRACK || diskBamPtr->dirStart.sector != DIRECTORY_SECTOR) {
+    auto dirStart = disktype == diskType::eighty_track ? headerPtr->dirStart : diskBamPtr->dirStart;
+    if (dirStart.track != dirTrack || dirStart.sector != dirSector) {
         std::cerr << "Warning: BAM structure has non-standard directory track/sector ("
-                  << static_cast<int>(diskBamPtr->dirStart.track) << "/"
-                  << static_cast<int>(diskBamPtr->dirStart.sector) << "). "
+                  << static_cast<int>(dirStart.track) << "/"
+                  << static_cast<int>(dirStart.sector) << "). "
                   << "This may be intentional for copy protection or custom formats.\n";
     }
 
-    auto dir = getTrackSectorPtr(DIRECTORY_TRACK, DIRECTORY_SECTOR);
-    auto valid = (dir->track == DIRECTORY_TRACK || dir->track == 0);
+    auto dir = getTrackSectorPtr(dirTrack, dirSector);
+    auto valid = (dir->track == dirTrack || dir->track == 0);
     if (!valid) {
         std::cerr << "Warning: Directory sector pointer has non-standard next track (" 
                   << static_cast<int>(dir->track) << ").\n";
@@ -1413,10 +2014,41 @@ bool d64::validateD64()
 /// </summary>
 /// <param name="sideTrack">side track</param>
 /// <param name="sideSector">side sector</param>
-/// <returns>true if successful</returns>
+/// <returns>data sectors of the file in record order</returns>
 std::vector<trackSector> d64::parseSideSectors(int sideTrack, int sideSector)
 {
     std::vector<trackSector> recordMap;
+    collectSideSectors(sideTrack, sideSector, recordMap);
+    return recordMap;
+}
+
+/// <summary>
+/// Read side sectors of .REL file
+/// allocating the result from a memory resource
+/// </summary>
+/// <param name="sideTrack">side track</param>
+/// <param name="sideSector">side sector</param>
+/// <param name="resource">memory resource for the result</param>
+/// <returns>data sectors of the file in record order</returns>
+std::pmr::vector<trackSector> d64::parseSideSectors(int sideTrack, int sideSector, std::pmr::memory_resource* resource)
+{
+    std::pmr::vector<trackSector> recordMap(resource);
+    collectSideSectors(sideTrack, sideSector, recordMap);
+    return recordMap;
+}
+
+/// <summary>
+/// append the data sectors listed in the side sectors to a container
+/// </summary>
+/// <param name="sideTrack">side track</param>
+/// <param name="sideSector">side sector</param>
+/// <param name="recordMap">container to append to</param>
+template <typename Container>
+void d64::collectSideSectors(int sideTrack, int sideSector, Container& recordMap)
+{
+    auto first = firstSideSector(trackSector(sideTrack, sideSector));
+    sideTrack = first.track;
+    sideSector = first.sector;
 
     while (sideTrack != 0) {
         auto sideSectorPtr = getSideSectorPtr(sideTrack, sideSector);
@@ -1434,7 +2066,6 @@ std::vector<trackSector> d64::parseSideSectors(int sideTrack, int sideSector)
         sideTrack = nextTrack;
         sideSector = nextSector;
     }
-    return recordMap;
 }
 
 /// <summary>
@@ -1442,10 +2073,10 @@ std::vector<trackSector> d64::parseSideSectors(int sideTrack, int sideSector)
 /// </summary>
 /// <param name="track">tarck to write</param>
 /// <param name="sector">sector to write</param>
-/// <param name="bytes">vector of bytes to write</param>
+/// <param name="bytes">span of bytes to write</param>
 /// <param name="byteoffset">offset of sector write at</param>
 /// <returns></returns>
-bool d64::writeData(int track, int sector, std::vector<uint8_t> bytes, int byteoffset = 0)
+bool d64::writeData(int track, int sector, std::span<const uint8_t> bytes, int byteoffset = 0)
 {
     if (byteoffset < 0 || byteoffset >= SECTOR_SIZE) return false;
     auto index = calcOffset(track, sector) + byteoffset;
@@ -1464,7 +2095,7 @@ int d64::getRecordCount(std::string_view filename) {
     if (recordLength == 0) return 0;
     
     int totalPayloadBytes = 0;
-    trackSector sidePosition = fileEntry.value()->side;
+    trackSector sidePosition = firstSideSector(fileEntry.value()->side);
     
     while (sidePosition.track != 0) {
         auto side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
@@ -1492,44 +2123,52 @@ int d64::getRecordSize(std::string_view filename) {
 }
 
 std::optional<std::vector<uint8_t>> d64::readRecord(std::string_view filename, int recordNumber) {
+    std::vector<uint8_t> recordData;
+    if (!readRecordData(filename, recordNumber, recordData)) return std::nullopt;
+    return recordData;
+}
+
+std::optional<std::pmr::vector<uint8_t>> d64::readRecord(std::string_view filename, int recordNumber, std::pmr::memory_resource* resource) {
+    std::pmr::vector<uint8_t> recordData(resource);
+    if (!readRecordData(filename, recordNumber, recordData)) return std::nullopt;
+    return recordData;
+}
+
+template <typename Container>
+bool d64::readRecordData(std::string_view filename, int recordNumber, Container& recordData) {
     auto fileEntry = findFile(filename);
-    if (!fileEntry.has_value() || fileEntry.value()->file_type.type != d64FileTypes::REL) return std::nullopt;
+    if (!fileEntry.has_value() || fileEntry.value()->file_type.type != d64FileTypes::REL) return false;
     
     int recordLength = fileEntry.value()->recordLength;
-    if (recordLength == 0) return std::nullopt;
+    if (recordLength == 0) return false;
     
-    int recordCount = getRecordCount(filename);
-    if (recordNumber < 1 || recordNumber > recordCount) return std::nullopt;
+    if (recordNumber < 1) return false;
     
     int byteOffset = (recordNumber - 1) * recordLength;
     int sectorIndex = byteOffset / 254;
     int byteOffsetInSector = (byteOffset % 254) + 2;
     
-    int sideSectorIndex = sectorIndex / 120;
-    int pointerIndex = sectorIndex % 120;
+    int sideSectorIndex = sectorIndex / SIDE_SECTOR_CHAIN_SZ;
+    int pointerIndex = sectorIndex % SIDE_SECTOR_CHAIN_SZ;
     
-    trackSector sidePosition = fileEntry.value()->side;
-    sideSectorPtr side = nullptr;
-    
-    for (int i = 0; i <= sideSectorIndex; ++i) {
-        if (sidePosition.track == 0) return std::nullopt;
-        side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
-        sidePosition = side->next;
-    }
-    
-    if (!side) return std::nullopt;
-    trackSector dataSectorPos = side->chain[pointerIndex];
-    if (dataSectorPos.track == 0) return std::nullopt;
+    // go straight to the side sector instead of walking the chain
+    auto side = sideSectorAt(*fileEntry.value(), sideSectorIndex);
+    if (!side.has_value()) return false;
+    trackSector dataSectorPos = side.value()->chain[pointerIndex];
+    if (dataSectorPos.track == 0) return false;
     
     auto dataSector = getSectorPtr(dataSectorPos.track, dataSectorPos.sector);
-    std::vector<uint8_t> recordData(recordLength);
+    recordData.assign(recordLength, 0);
     
     int bytesToRead = recordLength;
     int currentOffset = byteOffsetInSector;
     int recordOffset = 0;
     
     while (bytesToRead > 0) {
-        int bytesAvailableInSector = 256 - currentOffset;
+        // the last sector of the file ends after its used bytes
+        int sectorEnd = dataSector->next.track != 0 ? SECTOR_SIZE : dataSector->next.sector + 1;
+        int bytesAvailableInSector = sectorEnd - currentOffset;
+        if (bytesAvailableInSector <= 0) return false;
         
         int bytesToCopy = std::min(bytesToRead, bytesAvailableInSector);
         
@@ -1540,13 +2179,13 @@ std::optional<std::vector<uint8_t>> d64::readRecord(std::string_view filename, i
         
         if (bytesToRead > 0) {
             dataSectorPos = dataSector->next;
-            if (dataSectorPos.track == 0) return std::nullopt;
+            if (dataSectorPos.track == 0) return false;
             dataSector = getSectorPtr(dataSectorPos.track, dataSectorPos.sector);
             currentOffset = 2;
         }
     }
     
-    return recordData;
+    return true;
 }
 
 bool d64::expandRelFile(std::string_view filename, int requiredBytes) {
@@ -1554,13 +2193,15 @@ bool d64::expandRelFile(std::string_view filename, int requiredBytes) {
     if (!fileEntry.has_value() || fileEntry.value()->file_type.type != d64FileTypes::REL) return false;
     
     int totalPayloadBytes = 0;
-    trackSector sidePosition = fileEntry.value()->side;
+    trackSector sidePosition = firstSideSector(fileEntry.value()->side);
     sideSectorPtr side = nullptr;
     trackSector lastSidePosition = {0, 0};
     trackSector lastDataSectorPos = {0, 0};
     int lastChainIndex = -1;
+    int sideIndex = -1;
     
     while (sidePosition.track != 0) {
+        ++sideIndex;
         lastSidePosition = sidePosition;
         side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
         for (int i = 0; i < SIDE_SECTOR_CHAIN_SZ; ++i) {
@@ -1625,6 +2266,9 @@ bool d64::expandRelFile(std::string_view filename, int requiredBytes) {
         
         lastChainIndex++;
         if (lastChainIndex >= SIDE_SECTOR_CHAIN_SZ) {
+            int index = sideIndex + 1;
+            if (index >= maxSideSectors()) return false;
+            
             int newSideTrack = 0, newSideSector = 0;
             if (!findAndAllocateFreeSector(newSideTrack, newSideSector)) return false;
             
@@ -1634,19 +2278,29 @@ bool d64::expandRelFile(std::string_view filename, int requiredBytes) {
             auto newSide = getSideSectorPtr(newSideTrack, newSideSector);
             std::fill(reinterpret_cast<uint8_t*>(newSide), reinterpret_cast<uint8_t*>(newSide) + SECTOR_SIZE, 0);
             newSide->recordsize = fileEntry.value()->recordLength;
-            newSide->block = side->block + 1;
+            newSide->block = index % SIDE_SECTOR_ENTRY_SIZE;
             
-            int sideSectorsCount = newSide->block + 1;
-            if (sideSectorsCount > SIDE_SECTOR_ENTRY_SIZE) return false;
-            
-            trackSector iterSidePos = fileEntry.value()->side;
-            while (iterSidePos.track != 0) {
-                auto iterSide = getSideSectorPtr(iterSidePos.track, iterSidePos.sector);
-                iterSide->sideSectors[newSide->block] = {static_cast<uint8_t>(newSideTrack), static_cast<uint8_t>(newSideSector)};
-                iterSidePos = iterSide->next;
+            trackSector newPosition(newSideTrack, newSideSector);
+            if (newSide->block == 0) {
+                // a new group starts, only a 1581 gets here and lists it in the super side sector
+                auto super = reinterpret_cast<superSideSectorPtr>(getSideSectorPtr(fileEntry.value()->side.track, fileEntry.value()->side.sector));
+                super->groups[index / SIDE_SECTOR_ENTRY_SIZE] = newPosition;
+                newSide->sideSectors[0] = newPosition;
+            }
+            else {
+                // add it to the list of every side sector in the group
+                auto groupStart = index - newSide->block;
+                for (auto member = groupStart; member < index; ++member) {
+                    auto memberSide = sideSectorAt(*fileEntry.value(), member);
+                    if (!memberSide.has_value()) return false;
+                    memberSide.value()->sideSectors[newSide->block] = newPosition;
+                }
+                auto groupFirst = sideSectorAt(*fileEntry.value(), groupStart);
+                std::copy_n(groupFirst.value()->sideSectors, SIDE_SECTOR_ENTRY_SIZE, newSide->sideSectors);
             }
             
             side = newSide;
+            sideIndex = index;
             lastChainIndex = 0;
             
             uint16_t currentSize = fileEntry.value()->fileSize[0] | (fileEntry.value()->fileSize[1] << 8);
@@ -1683,20 +2337,12 @@ bool d64::writeRecord(std::string_view filename, int recordNumber, const std::ve
     
     int sectorIndex = byteOffset / 254;
     int byteOffsetInSector = (byteOffset % 254) + 2;
-    int sideSectorIndex = sectorIndex / 120;
-    int pointerIndex = sectorIndex % 120;
-    
-    trackSector sidePosition = fileEntry.value()->side;
-    sideSectorPtr side = nullptr;
-    
-    for (int i = 0; i <= sideSectorIndex; ++i) {
-        if (sidePosition.track == 0) return false;
-        side = getSideSectorPtr(sidePosition.track, sidePosition.sector);
-        sidePosition = side->next;
-    }
+    int sideSectorIndex = sectorIndex / SIDE_SECTOR_CHAIN_SZ;
+    int pointerIndex = sectorIndex % SIDE_SECTOR_CHAIN_SZ;
     
-    if (!side) return false;
-    trackSector dataSectorPos = side->chain[pointerIndex];
+    auto side = sideSectorAt(*fileEntry.value(), sideSectorIndex);
+    if (!side.has_value()) return false;
+    trackSector dataSectorPos = side.value()->chain[pointerIndex];
     if (dataSectorPos.track == 0) return false;
     
     auto dataSector = getSectorPtr(dataSectorPos.track, dataSectorPos.sector);
@@ -8,8 +8,14 @@
 #include <cstdint>
 #include <cstring>
 #include <bitset>
+#include <span>
+#include <memory_resource>
+#include <vector>
 
 #include "d64_types.h"
+#include "petscii_name.h"
+
+namespace d64lib { class ConcurrentWriter; }
 
 #pragma pack(push, 1)
 
@@ -19,33 +25,51 @@ public:
     d64();
     d64(diskType type);
     d64(std::string name);
+    d64(const d64& other);
+    d64(d64&& other) noexcept = default;
+    d64& operator=(const d64& other);
+    d64& operator=(d64&& other) noexcept = default;
 
     void formatDisk(std::string_view name);
     bool rename_disk(std::string_view name) const;
+    bool rename_disk(const petscii_name& name) const;
     std::string diskname();
     std::optional<directoryEntryPtr> findFile(std::string_view filename);
+    std::optional<directoryEntryPtr> findFile(const petscii_name& filename);
     bool addFile(std::string_view filename, c64FileType type, const std::vector<uint8_t>& fileData, int recirdSize = 0);
+    bool addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize = 0);
     bool removeFile(std::string_view filename);
     bool renameFile(std::string_view oldfilename, std::string_view newfilename);
+    bool renameFile(const petscii_name& oldfilename, const petscii_name& newfilename);
     bool extractFile(std::string filename);
     bool save(std::string filename);
     bool load(std::string filename);
     int calcOffset(int track, int sector) const;
     bool writeByte(int track, int sector, int offset, uint8_t value);
-    bool writeSector(int track, int sector, std::vector<uint8_t> bytes);
+    bool writeSector(int track, int sector, const std::vector<uint8_t>& bytes);
+    bool writeSector(int track, int sector, std::span<const uint8_t> bytes);
+    bool writeTrack(int track, std::span<const uint8_t> bytes);
     std::optional<uint8_t> readByte(int track, int sector, int offset);
     std::optional<std::vector<uint8_t>> readSector(int track, int sector);
+    bool readSector(int track, int sector, std::span<uint8_t> bytes) const;
+    bool readTrack(int track, std::span<uint8_t> bytes) const;
+    int trackSize(int track) const;
     bool freeSector(const int& track, const int& sector);
     bool allocateSector(const int& track, const int& sector);
     bool findAndAllocateFreeSector(int& track, int& sector);
     std::optional<std::vector<uint8_t>> readFile(std::string filename);
+    std::optional<std::span<const uint8_t>> nextFileBlock(trackSector& position);
+    bool readFileBlocks(const directoryEntry& entry, const std::function<bool(std::span<const uint8_t>)>& block);
+    std::optional<std::pmr::vector<uint8_t>> readFile(std::string_view filename, std::pmr::memory_resource* resource);
     std::optional<std::vector<uint8_t>> readRecord(std::string_view filename, int recordNumber);
+    std::optional<std::pmr::vector<uint8_t>> readRecord(std::string_view filename, int recordNumber, std::pmr::memory_resource* resource);
     bool writeRecord(std::string_view filename, int recordNumber, const std::vector<uint8_t>& recordData);
     bool appendRecord(std::string_view filename, const std::vector<uint8_t>& recordData);
     bool deleteRecord(std::string_view filename, int recordNumber);
     int getRecordCount(std::string_view filename);
     int getRecordSize(std::string_view filename);
     uint16_t getFreeSectorCount();
+    uint16_t getAllocatableSectorCount();
     bool compactDirectory();
     bool verifyBAMIntegrity(bool fix, const std::string& logFile);
     bool reorderDirectory(std::function<bool(const directoryEntry&, const directoryEntry&)> compare);
@@ -54,10 +78,19 @@ public:
     bool movefileFirst(std::string file);
     bool lockfile(std::string file, bool lock);
     std::vector<directoryEntry> directory();
+    std::pmr::vector<directoryEntry> directory(std::pmr::memory_resource* resource);
+    std::vector<trackSector> parseSideSectors(int sideTrack, int sideSector);
+    std::pmr::vector<trackSector> parseSideSectors(int sideTrack, int sideSector, std::pmr::memory_resource* resource);
+    bool createPartition(std::string_view name, int startTrack, int tracks);
+    bool openPartition(std::string_view name);
+    void openRoot();
     static std::string Trim(const char filename[FILE_NAME_SZ]);
 
     int TRACKS;
 
+    // upper bound on the sectors of a chain, a longer chain loops
+    static constexpr int MAX_CHAIN_SECTORS = D81_DISK_SZ / SECTOR_SIZE;
+
     // Constants for D64 format
     static constexpr std::array<int, TRACKS_40> SECTORS_PER_TRACK = {
         21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, // Tracks 1-17
@@ -74,11 +107,78 @@ public:
         0x25600, 0x26700, 0x27800, 0x28900, 0x29A00, 0x2AB00, 0x2BC00, 0x2CD00, 0x2DE00, 0x2EF00
     };
 
-    inline bamTrackEntry* bamtrack(int t)
+    // 1571 disks repeat the tracks of the first side on the second
+    static constexpr std::array<int, TRACKS_70> D71_SECTORS_PER_TRACK = [] {
+        std::array<int, TRACKS_70> sectors{};
+        for (auto t = 0; t < TRACKS_70; ++t) {
+            sectors[t] = SECTORS_PER_TRACK[t % TRACKS_35];
+        }
+        return sectors;
+    }();
+
+    static constexpr std::array<int, TRACKS_70> D71_TRACK_OFFSETS = [] {
+        std::array<int, TRACKS_70> offsets{};
+        for (auto t = 1; t < TRACKS_70; ++t) {
+            offsets[t] = offsets[t - 1] + D71_SECTORS_PER_TRACK[t - 1] * SECTOR_SIZE;
+        }
+        return offsets;
+    }();
+
+    static constexpr std::array<int, TRACKS_80> D81_SECTORS_PER_TRACK = [] {
+        std::array<int, TRACKS_80> sectors{};
+        sectors.fill(D81_TRACK_SECTORS);
+        return sectors;
+    }();
+
+    static constexpr std::array<int, TRACKS_80> D81_TRACK_OFFSETS = [] {
+        std::array<int, TRACKS_80> offsets{};
+        for (auto t = 0; t < TRACKS_80; ++t) {
+            offsets[t] = t * D81_TRACK_SECTORS * SECTOR_SIZE;
+        }
+        return offsets;
+    }();
+
+    /// <summary>
+    /// kind of disk, decides the geometry and where the BAM lives
+    /// </summary>
+    inline diskType type() const
     {
-        return (t < TRACKS_35) ?
-            &bamTrackPtr[(t)] :
-            &bamExtraTrackPtr[((t)-TRACKS_35)];
+        return disktype;
+    }
+
+    /// <summary>
+    /// first sector of the directory in use, its track also holds the header and BAM
+    /// </summary>
+    inline trackSector directoryStart() const
+    {
+        return { static_cast<uint8_t>(dirTrack), static_cast<uint8_t>(dirSector) };
+    }
+
+    /// <summary>
+    /// number of sectors on a track of this disk
+    /// </summary>
+    /// <param name="track">track number</param>
+    /// <returns>sectors or 0 if the track is invalid</returns>
+    inline int sectorCount(int track) const
+    {
+        return track >= 1 && track <= TRACKS ? sectorTable[track - 1] : 0;
+    }
+
+    inline bamTrackRef bamtrack(int t)
+    {
+        if (disktype == diskType::eighty_track) {
+            // the BAM belongs to the open partition, its tracks are split over two sectors
+            auto entry = calcOffset(dirTrack, D81_BAM_SECTOR + t / TRACKS_40) + D81_BAM_ENTRY_OFFSET + (t % TRACKS_40) * 6;
+            return { data[entry], &data[entry + 1], 5 };
+        }
+        if (t < TRACKS_35) {
+            return { bamTrackPtr[t].free, bamTrackPtr[t].bytes.data() };
+        }
+        if (disktype == diskType::seventy_track) {
+            auto bitmap = calcOffset(D71_BAM_TRACK, BAM_SECTOR) + (t - TRACKS_35) * 3;
+            return { data[calcOffset(DIRECTORY_TRACK, BAM_SECTOR) + D71_FREE_COUNT_OFFSET + t - TRACKS_35], &data[bitmap] };
+        }
+        return { bamExtraTrackPtr[t - TRACKS_35].free, bamExtraTrackPtr[t - TRACKS_35].bytes.data() };
     }
     inline sectorPtr getSectorPtr(uint8_t track, uint8_t sector)
     {
@@ -98,33 +198,76 @@ public:
     }
 
 private:
+    friend class d64lib::ConcurrentWriter;
+
     static constexpr int INTERLEAVE = 10;
-    std::array<int, TRACKS_40> lastSectorUsed = { -1 };
+
+    static constexpr std::array<int, TRACKS_40> TRACK_40_SEARCH_ORDER = {
+        18, 17, 19, 16, 20, 15, 21, 14, 22, 13, 23, 12, 24, 11, 25, 10, 26, 9,
+        27, 8, 28, 7, 29, 6, 30, 5, 31, 4, 32, 3, 33, 2, 34, 1, 35, 36, 37, 38, 39, 40
+    };
+
+    // the second side of a 1571 is filled from its BAM track outward as well
+    static constexpr std::array<int, TRACKS_70 - 1> TRACK_70_SEARCH_ORDER = {
+        18, 17, 19, 16, 20, 15, 21, 14, 22, 13, 23, 12, 24, 11, 25, 10, 26, 9,
+        27, 8, 28, 7, 29, 6, 30, 5, 31, 4, 32, 3, 33, 2, 34, 1, 35,
+        52, 54, 51, 55, 50, 56, 49, 57, 48, 58, 47, 59, 46, 60, 45, 61, 44, 62,
+        43, 63, 42, 64, 41, 65, 40, 66, 39, 67, 38, 68, 37, 69, 36, 70
+    };
+
+    std::array<int, TRACKS_80> lastSectorUsed = { -1 };
     bamPtr diskBamPtr;
     bamTrackEntry* bamTrackPtr;
     bamTrackEntry* bamExtraTrackPtr;
     diskType disktype = diskType::thirty_five_track;
 
+    // geometry of the disk type, both point into the constexpr tables above
+    const int* sectorTable = SECTORS_PER_TRACK.data();
+    const int* offsetTable = TRACK_OFFSETS.data();
+
+    // directory in use, on a 1581 this moves into a partition after openPartition
+    int dirTrack = DIRECTORY_TRACK;
+    int dirSector = DIRECTORY_SECTOR;
+    d81HeaderPtr headerPtr = nullptr;
+    int partitionStart = 0;
+    int partitionTracks = 0;            // 0 while the root directory is open
+
+    // sectors taken by the addFile in progress, given back if it fails
+    std::vector<trackSector>* allocations = nullptr;
+
     bool validateD64();
     void initBAM(std::string_view name);
     void initializeBAMFields(std::string_view name);
-    bool writeData(int track, int sector, std::vector<uint8_t> bytes, int byteoffset);
-    std::vector<trackSector> parseSideSectors(int sideTrack, int sideSector);
+    void initializeD81Fields(std::string_view name);
+    char* diskNameField() const;
+    bool writeData(int track, int sector, std::span<const uint8_t> bytes, int byteoffset);
     void init_disk();
     bool findAndAllocateFreeOnTrack(int t, int& sector);
     std::optional<directoryEntryPtr> findEmptyDirectorySlot();
     bool allocateSideSector(int& track, int& sector, sideSectorPtr& side);
     bool allocateDataSector(int& track, int& sector, sectorPtr& sectorPtr);
-    void writeDataToSector(sectorPtr sectorPtr, const std::vector<uint8_t>& fileData, int& offset, int& bytesLeft);
-    std::vector<trackSector> writeFileDataToSectors(int start_track, int start_sector, const std::vector<uint8_t>& fileData);
-    std::optional<std::vector<sideSectorPtr>> createSideSectors(const std::vector<trackSector>& allocatedSectors, uint8_t record_size);
-    bool createDirectoryEntry(std::string_view filename, c64FileType type, int start_track, int start_sector, const std::vector<trackSector>& allocatedSectors, uint8_t record_size);
+    void writeDataToSector(sectorPtr sectorPtr, std::span<const uint8_t> fileData, int& offset, int& bytesLeft);
+    std::vector<trackSector> writeFileDataToSectors(int start_track, int start_sector, std::span<const uint8_t> fileData);
+    std::optional<trackSector> createSideSectors(const std::vector<trackSector>& allocatedSectors, uint8_t record_size);
+    trackSector firstSideSector(trackSector side);
+    std::optional<sideSectorPtr> sideSectorAt(const directoryEntry& entry, int index);
+    int maxSideSectors() const;
+    bool createDirectoryEntry(const petscii_name& filename, c64FileType type, int start_track, int start_sector, const std::vector<trackSector>& allocatedSectors, uint8_t record_size);
     bool findAndAllocateFirstSector(int& start_track, int& start_sector);
     bool allocateNewDirectorySector(int& dir_track, int& dir_sector, directorySectorPtr& dirSectorPtr);
     bool expandRelFile(std::string_view filename, int requiredBytes);
 
+    template <typename Container> void readFileData(directoryEntryPtr fileEntry, Container& fileData);
+    template <typename Container> void readDirectory(Container& files);
+    template <typename Container> void collectSideSectors(int sideTrack, int sideSector, Container& recordMap);
+    template <typename Container> bool readRecordData(std::string_view filename, int recordNumber, Container& recordData);
+
     inline void initBAMPtr()
     {
+        if (disktype == diskType::eighty_track) {
+            headerPtr = reinterpret_cast<d81HeaderPtr>(&data[calcOffset(dirTrack, BAM_SECTOR)]);
+            return;
+        }
         auto index = calcOffset(DIRECTORY_TRACK, BAM_SECTOR);
         diskBamPtr = reinterpret_cast<bamPtr>(&data[index]);
         bamTrackPtr = &(diskBamPtr->bamTrack[0]);
@@ -1,10 +1,18 @@
 // Written by Paul Baxter
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+
 #pragma pack(push, 1)
 
 inline constexpr int TRACKS_35 = 35;
 inline constexpr int TRACKS_40 = 40;
+inline constexpr int TRACKS_70 = 70;
+inline constexpr int TRACKS_80 = 80;
 inline constexpr int SECTOR_SIZE = 256;
 inline constexpr int DISK_NAME_SZ = 16;
 inline constexpr int FILE_NAME_SZ = 16;
@@ -18,9 +26,30 @@ inline constexpr int BAM_SECTOR = 0;
 inline constexpr int FILES_PER_SECTOR = 8;
 inline constexpr int D64_DISK35_SZ = 174848;
 inline constexpr int D64_DISK40_SZ = 196608;
+inline constexpr int D71_DISK_SZ = 349696;
+
+// 1571 double sided disks keep the BAM of the second side on track 53
+inline constexpr int D71_BAM_TRACK = 53;
+inline constexpr int D71_FREE_COUNT_OFFSET = 0xDD;      // free sector counts of tracks 36-70 in 18/0
+inline constexpr uint8_t D71_DOUBLE_SIDED = 0x80;
+
+// 1581 disks have 40 sectors on every track, the header, BAM and directory are on track 40
+inline constexpr int D81_DISK_SZ = 819200;
+inline constexpr int D81_TRACK_SECTORS = 40;
+inline constexpr int D81_DIRECTORY_TRACK = 40;
+inline constexpr int D81_BAM_SECTOR = 1;                // tracks 1-40, tracks 41-80 follow in sector 2
+inline constexpr int D81_DIRECTORY_SECTOR = 3;
+inline constexpr int D81_BAM_ENTRY_OFFSET = 0x10;
+inline constexpr int D81_PARTITION_MIN_TRACKS = 3;     // a partition holding a directory needs 120 sectors
+static constexpr uint8_t D81_DOS_VERSION = 'D';
+static constexpr uint8_t D81_DOS_TYPE = '3';
+static constexpr uint8_t D81_VERSION_COMPLEMENT = 0xBB;
+static constexpr uint8_t D81_IO_BYTE = 0xC0;
 
 inline constexpr int SIDE_SECTOR_ENTRY_SIZE = 6;
 inline constexpr int SIDE_SECTOR_CHAIN_SZ = ((SECTOR_SIZE - 15) / (2));
+inline constexpr int SUPER_SIDE_SECTOR_GROUPS = 126;
+static constexpr uint8_t SUPER_SIDE_SECTOR_ID = 0xFE;
 
 static constexpr uint8_t A0_VALUE = 0xA0;
 static constexpr uint8_t DOS_VERSION = 'A';
@@ -28,7 +57,9 @@ static constexpr uint8_t DOS_TYPE = '2';
 
 enum diskType {
     thirty_five_track,
-    forty_track
+    forty_track,
+    seventy_track,
+    eighty_track
 };
 
 enum d64FileTypes : uint8_t {
@@ -36,7 +67,8 @@ enum d64FileTypes : uint8_t {
     SEQ = 1,
     PRG = 2,
     USR = 3,
-    REL = 4
+    REL = 4,
+    CBM = 5         // 1581 partition
 };
 
 // Track and sector
@@ -72,6 +104,16 @@ public:
 };
 typedef sideSector* sideSectorPtr;
 
+// super side sector of a 1581 .REL file
+// it lists the first side sector of each group of six
+struct superSideSector {
+    trackSector first;                                  // $00 - $01    first side sector
+    uint8_t id;                                         // $02          $FE
+    trackSector groups[SUPER_SIDE_SECTOR_GROUPS];       // $03 - $FE    first side sector of each group
+    uint8_t unused;                                     // $FF
+};
+typedef superSideSector* superSideSectorPtr;
+
 class c64FileType {
 public:
     d64FileTypes type : 4;
@@ -160,7 +202,7 @@ public:
 struct bam {
     trackSector dirStart;                   // $00 - $01
     uint8_t dosVersion;                     // $02          'A' dos version
-    uint8_t unused;                         // $03          unused should be 0
+    uint8_t unused;                         // $03          0, $80 on a double sided 1571 disk
     bamTrackEntry bamTrack[TRACKS_35];      // $04 - $8F    BAM to each track
     char diskName[DISK_NAME_SZ];            // $90 - $9F    disk name padded with A0
     uint8_t a0[2];                          // $A0 - $A1    contains A0
@@ -172,6 +214,68 @@ struct bam {
 };
 typedef struct bam* bamPtr;
 
+// header sector of a 1581 disk or partition
+struct d81Header {
+    trackSector dirStart;                   // $00 - $01    first directory sector
+    uint8_t dosVersion;                     // $02          'D' dos version
+    uint8_t unused;                         // $03          00
+    char diskName[DISK_NAME_SZ];            // $04 - $13    disk name padded with A0
+    uint8_t a0[2];                          // $14 - $15    contains A0
+    uint8_t diskId[2];                      // $16 - $17    disk id
+    uint8_t unused2;                        // $18          contains A0
+    char dos_type[2];                       // $19 - $1A    '3' 'D'
+    uint8_t a0b[2];                         // $1B - $1C    contains A0
+    uint8_t unused3[SECTOR_SIZE - 0x1D];    // $1D - $FF    00
+};
+typedef struct d81Header* d81HeaderPtr;
+
+// one of the two BAM sectors of a 1581 disk or partition
+struct d81Bam {
+    trackSector next;                       // $00 - $01    second BAM sector, 00/FF in the last
+    uint8_t dosVersion;                     // $02          'D'
+    uint8_t versionComplement;              // $03          $BB
+    uint8_t diskId[2];                      // $04 - $05    disk id
+    uint8_t ioByte;                         // $06          verify and crc flags
+    uint8_t autoBoot;                       // $07          auto boot loader flag
+    uint8_t unused[8];                      // $08 - $0F    00
+    struct {
+        uint8_t free;
+        uint8_t bytes[5];
+    } bamTrack[TRACKS_40];                  // $10 - $FF    BAM of 40 tracks
+};
+typedef struct d81Bam* d81BamPtr;
+
+/// <summary>
+/// BAM entry of one track
+/// on the second side of a 1571 disk the free count and the bitmap
+/// are in different sectors, so this refers to both instead of one bamTrackEntry
+/// </summary>
+struct bamTrackRef {
+    uint8_t& free;
+    uint8_t* bytes;
+    int size = 3;           // bytes in the bitmap, 5 on a 1581
+
+    bool test(int sector) const
+    {
+        return (bytes[sector / 8] >> (sector % 8)) & 1;
+    }
+
+    inline void set(int sector)
+    {
+        bytes[sector / 8] |= static_cast<uint8_t>(1 << (sector % 8));
+    }
+
+    inline void reset(int sector)
+    {
+        bytes[sector / 8] &= static_cast<uint8_t>(~(1 << (sector % 8)));
+    }
+
+    inline void clear()
+    {
+        std::fill_n(bytes, size, 0);
+    }
+};
+
 struct directoryEntry {
     c64FileType file_type;              // $00          file type
     trackSector start;                  // $01 - $02    first track  and sector of file entry
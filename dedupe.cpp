@@ -0,0 +1,275 @@
+#include "dedupe.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace d64lib::dedupe {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'D', '6', '4', 'D', 'E', 'D', 'U', 'P' };
+constexpr uint32_t VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.put(static_cast<char>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+}
+
+template <typename T>
+T readValue(std::istream& in)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        auto c = in.get();
+        if (c == std::char_traits<char>::eof()) {
+            throw std::runtime_error("Unexpected end of dedupe index");
+        }
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(c)) << (i * 8);
+    }
+    return static_cast<T>(value);
+}
+
+} // namespace
+
+std::vector<DedupeIndex::IndexedFile> DedupeIndex::scan(const std::string& image, d64& disk)
+{
+    std::vector<IndexedFile> scanned;
+    for (const auto& entry : disk.directory()) {
+        auto fp = hash::fingerprint(disk, entry);
+        scanned.push_back({ FileLocation{ image, entry, fp.size, fp.blocks }, fp.xxh64 });
+    }
+    return scanned;
+}
+
+void DedupeIndex::insert(const std::string& image, const ImageState& state, std::vector<IndexedFile> scanned)
+{
+    removeImage(image);
+    images[image] = state;
+    for (auto& file : scanned) {
+        files.emplace(file.xxh64, std::move(file.location));
+    }
+}
+
+size_t DedupeIndex::addImages(const std::vector<std::string>& paths, unsigned threads)
+{
+    struct Work {
+        std::string image;
+        ImageState state;
+        std::optional<std::vector<IndexedFile>> scanned;
+    };
+
+    // only images that are new or changed on disk get scanned
+    std::vector<Work> work;
+    for (const auto& path : paths) {
+        std::error_code ec;
+        auto fileSize = std::filesystem::file_size(path, ec);
+        auto modified = std::filesystem::last_write_time(path, ec);
+        if (ec) {
+            std::cerr << "Error: " << path << ": " << ec.message() << std::endl;
+            continue;
+        }
+        ImageState state{ fileSize, static_cast<int64_t>(modified.time_since_epoch().count()) };
+        auto it = images.find(path);
+        if (it != images.end() && it->second.fileSize == state.fileSize && it->second.modified == state.modified) {
+            continue;
+        }
+        work.push_back({ path, state, std::nullopt });
+    }
+
+    parallelFor(work.size(), threads, [&](size_t index) {
+        auto& item = work[index];
+        try {
+            d64 disk(item.image);
+            item.scanned = scan(item.image, disk);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << item.image << ": " << e.what() << std::endl;
+        }
+    });
+
+    size_t count = 0;
+    for (auto& item : work) {
+        if (!item.scanned.has_value()) {
+            // an image that can no longer be read should not keep its old files
+            removeImage(item.image);
+            continue;
+        }
+        insert(item.image, item.state, std::move(item.scanned.value()));
+        ++count;
+    }
+    return count;
+}
+
+void DedupeIndex::addDisk(const std::string& image, d64& disk)
+{
+    insert(image, ImageState{}, scan(image, disk));
+}
+
+bool DedupeIndex::removeImage(const std::string& image)
+{
+    if (images.erase(image) == 0) return false;
+    std::erase_if(files, [&](const auto& file) { return file.second.image == image; });
+    return true;
+}
+
+std::vector<DuplicateGroup> DedupeIndex::duplicates() const
+{
+    std::vector<DuplicateGroup> groups;
+    for (auto it = files.begin(); it != files.end();) {
+        auto range = files.equal_range(it->first);
+        it = range.second;
+
+        // a hash match alone is not enough, the sizes have to agree as well
+        std::map<uint32_t, std::vector<FileLocation>> bySize;
+        for (auto file = range.first; file != range.second; ++file) {
+            if (file->second.size == 0) continue;
+            bySize[file->second.size].push_back(file->second);
+        }
+        for (auto& [size, locations] : bySize) {
+            if (locations.size() < 2) continue;
+            DuplicateGroup group;
+            group.xxh64 = range.first->first;
+            group.size = size;
+            group.blocks = locations.front().blocks;
+            group.wastedBlocks = static_cast<uint32_t>(group.blocks * (locations.size() - 1));
+            std::sort(locations.begin(), locations.end(), [](const FileLocation& a, const FileLocation& b) {
+                if (a.image != b.image) return a.image < b.image;
+                return std::memcmp(a.entry.fileName, b.entry.fileName, FILE_NAME_SZ) < 0;
+            });
+            group.files = std::move(locations);
+            groups.push_back(std::move(group));
+        }
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const DuplicateGroup& a, const DuplicateGroup& b) {
+        if (a.wastedBlocks != b.wastedBlocks) return a.wastedBlocks > b.wastedBlocks;
+        return a.xxh64 < b.xxh64;
+    });
+    return groups;
+}
+
+std::vector<FileLocation> DedupeIndex::find(uint64_t xxh64) const
+{
+    std::vector<FileLocation> result;
+    auto range = files.equal_range(xxh64);
+    for (auto it = range.first; it != range.second; ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+/// <summary>
+/// Save the index
+/// images are written first and files refer to them by position
+/// </summary>
+bool DedupeIndex::save(const std::string& filename) const
+{
+    std::ofstream outFile(filename, std::ios::binary);
+    if (!outFile) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+
+    outFile.write(MAGIC, sizeof(MAGIC));
+    writeValue<uint32_t>(outFile, VERSION);
+
+    std::unordered_map<std::string, uint32_t> imageIndex;
+    writeValue<uint32_t>(outFile, static_cast<uint32_t>(images.size()));
+    for (const auto& [image, state] : images) {
+        imageIndex[image] = static_cast<uint32_t>(imageIndex.size());
+        writeValue<uint32_t>(outFile, static_cast<uint32_t>(image.size()));
+        outFile.write(image.data(), image.size());
+        writeValue<uint64_t>(outFile, state.fileSize);
+        writeValue<int64_t>(outFile, state.modified);
+    }
+
+    writeValue<uint32_t>(outFile, static_cast<uint32_t>(files.size()));
+    for (const auto& [xxh64, file] : files) {
+        writeValue<uint32_t>(outFile, imageIndex[file.image]);
+        writeValue<uint64_t>(outFile, xxh64);
+        writeValue<uint32_t>(outFile, file.size);
+        writeValue<uint16_t>(outFile, file.blocks);
+        outFile.write(reinterpret_cast<const char*>(&file.entry), sizeof(directoryEntry));
+    }
+    outFile.close();
+    return static_cast<bool>(outFile);
+}
+
+bool DedupeIndex::load(const std::string& filename)
+{
+    try {
+        std::ifstream inFile(filename, std::ios::binary);
+        if (!inFile) {
+            throw std::ios_base::failure("Error: Could not open dedupe index " + filename + " for reading");
+        }
+
+        inFile.seekg(0, std::ios::end);
+        auto fileSize = static_cast<uint64_t>(inFile.tellg());
+        inFile.seekg(0);
+        // counts read from the file may not ask for more than the bytes left in it
+        auto remaining = [&]() { return fileSize - static_cast<uint64_t>(inFile.tellg()); };
+
+        char magic[sizeof(MAGIC)];
+        inFile.read(magic, sizeof(magic));
+        if (!inFile || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || readValue<uint32_t>(inFile) != VERSION) {
+            throw std::invalid_argument("Not a dedupe index");
+        }
+
+        // every image takes its name length, size and time
+        constexpr uint64_t IMAGE_RECORD_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+        auto imageCount = readValue<uint32_t>(inFile);
+        if (imageCount > remaining() / IMAGE_RECORD_SIZE) {
+            throw std::invalid_argument("Not a dedupe index");
+        }
+        std::vector<std::string> names(imageCount);
+        std::unordered_map<std::string, ImageState> loadedImages;
+        for (auto& name : names) {
+            auto length = readValue<uint32_t>(inFile);
+            if (length > remaining()) {
+                throw std::invalid_argument("Not a dedupe index");
+            }
+            name.resize(length);
+            inFile.read(name.data(), name.size());
+            ImageState state;
+            state.fileSize = readValue<uint64_t>(inFile);
+            state.modified = readValue<int64_t>(inFile);
+            loadedImages[name] = state;
+        }
+
+        std::unordered_multimap<uint64_t, FileLocation> loadedFiles;
+        auto count = readValue<uint32_t>(inFile);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto index = readValue<uint32_t>(inFile);
+            if (index >= names.size()) {
+                throw std::invalid_argument("Invalid image in dedupe index");
+            }
+            auto xxh64 = readValue<uint64_t>(inFile);
+            auto size = readValue<uint32_t>(inFile);
+            auto blocks = readValue<uint16_t>(inFile);
+            std::array<char, sizeof(directoryEntry)> entry;
+            inFile.read(entry.data(), entry.size());
+            if (!inFile) {
+                throw std::runtime_error("Unexpected end of dedupe index");
+            }
+            loadedFiles.emplace(xxh64, FileLocation{ names[index], *reinterpret_cast<const directoryEntry*>(entry.data()), size, blocks });
+        }
+
+        images = std::move(loadedImages);
+        files = std::move(loadedFiles);
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace d64lib::dedupe
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "d64.h"
+#include "hash.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace d64lib::dedupe {
+
+/// <summary>
+/// A file on one image of the corpus
+/// </summary>
+struct FileLocation {
+    std::string image;
+    directoryEntry entry;
+    uint32_t size = 0;          // payload bytes
+    uint16_t blocks = 0;        // sectors in the chain
+};
+
+/// <summary>
+/// Files with the same contents
+/// </summary>
+struct DuplicateGroup {
+    uint64_t xxh64 = 0;
+    uint32_t size = 0;
+    uint16_t blocks = 0;
+    uint32_t wastedBlocks = 0;  // blocks of every copy but one
+    std::vector<FileLocation> files;
+};
+
+/// <summary>
+/// Finds files that appear on more than one place in a corpus of disk images
+/// the state can be saved and loaded so that only new or changed images are scanned again
+/// </summary>
+class DedupeIndex {
+public:
+    /// <summary>
+    /// Scan images and add their files, in parallel
+    /// images already indexed are skipped unless their file changed since
+    /// </summary>
+    /// <param name="images">paths of .d64 files</param>
+    /// <param name="threads">number of worker threads, 0 for one per core</param>
+    /// <returns>number of images that were scanned</returns>
+    size_t addImages(const std::vector<std::string>& images, unsigned threads = 0);
+
+    /// <summary>
+    /// Add the files of a disk that is already in memory
+    /// replaces the files of an image with the same name
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="disk">d64 disk instance</param>
+    void addDisk(const std::string& image, d64& disk);
+
+    /// <summary>
+    /// Remove the files of an image
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <returns>false if the image was not indexed</returns>
+    bool removeImage(const std::string& image);
+
+    /// <summary>
+    /// Get the groups of files with the same contents
+    /// empty files are ignored
+    /// </summary>
+    /// <returns>groups of two or more files, most wasted blocks first</returns>
+    std::vector<DuplicateGroup> duplicates() const;
+
+    /// <summary>
+    /// Get every file with the given contents
+    /// </summary>
+    /// <param name="xxh64">XXH64 of the file contents</param>
+    /// <returns>files in no particular order</returns>
+    std::vector<FileLocation> find(uint64_t xxh64) const;
+
+    size_t imageCount() const { return images.size(); }
+    size_t fileCount() const { return files.size(); }
+
+    /// <summary>
+    /// Save the index
+    /// </summary>
+    /// <param name="filename">file to write</param>
+    /// <returns>true if successful</returns>
+    bool save(const std::string& filename) const;
+
+    /// <summary>
+    /// Load an index written by save, replacing the current state
+    /// </summary>
+    /// <param name="filename">file to read</param>
+    /// <returns>true if successful</returns>
+    bool load(const std::string& filename);
+
+private:
+    struct IndexedFile {
+        FileLocation location;
+        uint64_t xxh64 = 0;
+    };
+
+    struct ImageState {
+        uint64_t fileSize = 0;
+        int64_t modified = 0;
+    };
+
+    static std::vector<IndexedFile> scan(const std::string& image, d64& disk);
+    void insert(const std::string& image, const ImageState& state, std::vector<IndexedFile> scanned);
+
+    std::unordered_multimap<uint64_t, FileLocation> files;
+    std::unordered_map<std::string, ImageState> images;
+};
+
+} // namespace d64lib::dedupe
@@ -0,0 +1,438 @@
+#include "g64.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace d64lib::g64 {
+
+namespace {
+
+constexpr uint8_t SYNC_BYTE = 0xFF;
+constexpr uint8_t HEADER_PADDING = 0x0F;
+
+// 5 bit code of every nibble, no code has more than two zero bits in a row
+constexpr std::array<uint8_t, 16> GCR_NIBBLE = {
+    0x0A, 0x0B, 0x12, 0x13, 0x0E, 0x0F, 0x16, 0x17,
+    0x09, 0x19, 0x1A, 0x1B, 0x0D, 0x1D, 0x1E, 0x15
+};
+
+// 10 bit code of every byte, so a group of 4 bytes takes 4 lookups
+constexpr std::array<uint16_t, 256> GCR_BYTE = [] {
+    std::array<uint16_t, 256> table{};
+    for (auto value = 0; value < 256; ++value) {
+        table[value] = static_cast<uint16_t>((GCR_NIBBLE[value >> 4] << 5) | GCR_NIBBLE[value & 0x0F]);
+    }
+    return table;
+}();
+
+// byte of every 10 bit code, INVALID_CODE where either half is not a GCR code
+constexpr uint16_t INVALID_CODE = 0xFFFF;
+constexpr std::array<uint16_t, 1024> GCR_DECODE = [] {
+    std::array<uint8_t, 32> nibble{};
+    nibble.fill(0xFF);
+    for (auto value = 0; value < 16; ++value) nibble[GCR_NIBBLE[value]] = static_cast<uint8_t>(value);
+
+    std::array<uint16_t, 1024> table{};
+    for (auto code = 0; code < 1024; ++code) {
+        auto high = nibble[code >> 5];
+        auto low = nibble[code & 0x1F];
+        table[code] = high == 0xFF || low == 0xFF ? INVALID_CODE : static_cast<uint16_t>((high << 4) | low);
+    }
+    return table;
+}();
+
+// a sync mark is at least this many one bits in a row
+constexpr int MIN_SYNC_BITS = 10;
+
+uint32_t read32(std::span<const uint8_t> bytes, size_t offset)
+{
+    return static_cast<uint32_t>(bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24));
+}
+
+void put32(std::vector<uint8_t>& bytes, size_t offset, uint32_t value)
+{
+    for (auto i = 0; i < 4; ++i) {
+        bytes[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+/// <summary>
+/// Decode the first bytes.size() bytes of a GCR block
+/// the padding at the end of header and data blocks is often damaged on real disks,
+/// so it is not decoded at all
+/// </summary>
+bool decodePrefix(std::span<const uint8_t> gcr, std::span<uint8_t> bytes)
+{
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        auto bit = 10 * i;
+        auto word = static_cast<uint16_t>((gcr[bit / 8] << 8) | gcr[bit / 8 + 1]);
+        auto value = GCR_DECODE[(word >> (6 - bit % 8)) & 0x3FF];
+        if (value == INVALID_CODE) return false;
+        bytes[i] = static_cast<uint8_t>(value);
+    }
+    return true;
+}
+
+/// <summary>
+/// A track read as a ring of bits, the head passes the end and starts over
+/// </summary>
+class TrackBits {
+public:
+    explicit TrackBits(std::span<const uint8_t> bytes) :
+        bytes(bytes),
+        size(bytes.size() * 8)
+    {
+    }
+
+    bool bit(size_t position) const
+    {
+        position %= size;
+        return (bytes[position >> 3] >> (7 - (position & 7))) & 1;
+    }
+
+    void read(size_t position, std::span<uint8_t> out) const
+    {
+        for (auto& value : out) {
+            auto index = (position % size) >> 3;
+            auto shift = position & 7;
+            auto word = static_cast<uint16_t>((bytes[index] << 8) | bytes[(index + 1) % bytes.size()]);
+            value = static_cast<uint8_t>(word >> (8 - shift));
+            position += 8;
+        }
+    }
+
+    /// <summary>
+    /// Bit positions where a block starts, right after each sync mark
+    /// one revolution is scanned, starting after a zero bit so no sync is cut in half
+    /// </summary>
+    std::vector<size_t> syncEnds() const
+    {
+        std::vector<size_t> ends;
+        size_t start = 0;
+        while (start < size && bit(start)) ++start;
+        if (start == size) return ends;
+
+        auto ones = 0;
+        for (auto position = start + 1; position <= start + size; ++position) {
+            if (bit(position)) {
+                ++ones;
+                continue;
+            }
+            if (ones >= MIN_SYNC_BITS) ends.push_back(position % size);
+            ones = 0;
+        }
+        return ends;
+    }
+
+private:
+    std::span<const uint8_t> bytes;
+    size_t size;
+};
+
+/// <summary>
+/// Decode the sectors of one track into the disk
+/// </summary>
+/// <param name="bits">track bitstream</param>
+/// <param name="track">track number</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <param name="errors">error codes of the sectors of this track</param>
+/// <param name="ids">disk id of each sector header</param>
+void decodeTrack(const TrackBits& bits, int track, d64& disk, std::span<uint8_t> errors, std::span<std::array<uint8_t, 2>> ids)
+{
+    auto syncs = bits.syncEnds();
+    if (syncs.empty()) return;
+    std::fill(errors.begin(), errors.end(), HEADER_NOT_FOUND);
+
+    std::array<uint8_t, HEADER_GCR_SIZE> headerGcr;
+    std::array<uint8_t, 6> header;
+    std::array<uint8_t, DATA_GCR_SIZE> dataGcr;
+    std::array<uint8_t, SECTOR_SIZE + 2> data;
+    for (size_t i = 0; i < syncs.size(); ++i) {
+        bits.read(syncs[i], headerGcr);
+        if (!decodePrefix(headerGcr, header) || header[0] != HEADER_BLOCK_ID) continue;
+        auto sector = static_cast<size_t>(header[2]);
+        if (header[3] != track || sector >= errors.size() || errors[sector] == SECTOR_OK) continue;
+        if (header[1] != (header[2] ^ header[3] ^ header[4] ^ header[5])) {
+            errors[sector] = HEADER_CHECKSUM_ERROR;
+            continue;
+        }
+        ids[sector] = { header[5], header[4] };
+
+        // the data block is the next one after the header
+        bits.read(syncs[(i + 1) % syncs.size()], dataGcr);
+        if (!decodePrefix(dataGcr, data) || data[0] != DATA_BLOCK_ID) {
+            errors[sector] = DATA_NOT_FOUND;
+            continue;
+        }
+        uint8_t checksum = 0;
+        for (auto j = 1; j <= SECTOR_SIZE; ++j) checksum ^= data[j];
+        disk.writeSector(track, static_cast<int>(sector), std::span<const uint8_t>(data).subspan(1, SECTOR_SIZE));
+        errors[sector] = checksum == data[SECTOR_SIZE + 1] ? SECTOR_OK : DATA_CHECKSUM_ERROR;
+    }
+}
+
+} // namespace
+
+void encodeGcr(std::span<const uint8_t> bytes, std::span<uint8_t> gcr)
+{
+    if (bytes.size() % 4 != 0 || gcr.size() < bytes.size() / 4 * 5) {
+        throw std::invalid_argument("GCR input must be a multiple of 4 bytes");
+    }
+    for (size_t in = 0, out = 0; in < bytes.size(); in += 4, out += 5) {
+        uint64_t group = (static_cast<uint64_t>(GCR_BYTE[bytes[in]]) << 30) |
+            (static_cast<uint64_t>(GCR_BYTE[bytes[in + 1]]) << 20) |
+            (static_cast<uint64_t>(GCR_BYTE[bytes[in + 2]]) << 10) |
+            GCR_BYTE[bytes[in + 3]];
+        for (auto i = 0; i < 5; ++i) {
+            gcr[out + i] = static_cast<uint8_t>(group >> (32 - 8 * i));
+        }
+    }
+}
+
+bool decodeGcr(std::span<const uint8_t> gcr, std::span<uint8_t> bytes)
+{
+    if (gcr.size() % 5 != 0 || bytes.size() < gcr.size() / 5 * 4) {
+        throw std::invalid_argument("GCR input must be a multiple of 5 bytes");
+    }
+    for (size_t in = 0, out = 0; in < gcr.size(); in += 5, out += 4) {
+        uint64_t group = 0;
+        for (auto i = 0; i < 5; ++i) group = (group << 8) | gcr[in + i];
+        for (auto i = 0; i < 4; ++i) {
+            auto value = GCR_DECODE[(group >> (30 - 10 * i)) & 0x3FF];
+            if (value == INVALID_CODE) return false;
+            bytes[out + i] = static_cast<uint8_t>(value);
+        }
+    }
+    return true;
+}
+
+Exporter::Exporter(const d64& disk) :
+    disk(disk),
+    tracks(disk.TRACKS)
+{
+    if (tracks > TRACKS_40) {
+        throw std::invalid_argument("G64 holds a single sided disk");
+    }
+    std::array<uint8_t, SECTOR_SIZE> bamSector;
+    disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, bamSector);
+    diskId = { bamSector[offsetof(bam, diskId)], bamSector[offsetof(bam, diskId) + 1] };
+}
+
+std::span<const uint8_t> Exporter::track(int track)
+{
+    if (track < 1 || track > tracks) {
+        throw std::invalid_argument("Invalid track");
+    }
+    std::call_once(encoded[track - 1], [&] { encodeTrack(track); });
+    return cache[track - 1];
+}
+
+void Exporter::encodeTrack(int track)
+{
+    auto sectors = d64::SECTORS_PER_TRACK[track - 1];
+    auto length = trackLength(track);
+
+    // the space left on the track is spread over the gaps after each sector
+    auto gap = (length - sectors * SECTOR_GCR_SIZE) / sectors;
+
+    std::vector<uint8_t> gcr(length, GAP_BYTE);
+    std::array<uint8_t, 8> header;
+    std::array<uint8_t, SECTOR_SIZE + 4> data;
+    size_t position = 0;
+    for (auto sector = 0; sector < sectors; ++sector) {
+        std::fill_n(gcr.begin() + position, SYNC_SIZE, SYNC_BYTE);
+        position += SYNC_SIZE;
+
+        // the drive stores the second id character first
+        header = { HEADER_BLOCK_ID,
+            static_cast<uint8_t>(sector ^ track ^ diskId[1] ^ diskId[0]),
+            static_cast<uint8_t>(sector), static_cast<uint8_t>(track),
+            diskId[1], diskId[0], HEADER_PADDING, HEADER_PADDING };
+        encodeGcr(header, std::span<uint8_t>(gcr).subspan(position, HEADER_GCR_SIZE));
+        position += HEADER_GCR_SIZE + HEADER_GAP_SIZE;
+
+        std::fill_n(gcr.begin() + position, SYNC_SIZE, SYNC_BYTE);
+        position += SYNC_SIZE;
+
+        data[0] = DATA_BLOCK_ID;
+        disk.readSector(track, sector, std::span<uint8_t>(data).subspan(1, SECTOR_SIZE));
+        uint8_t checksum = 0;
+        for (auto i = 1; i <= SECTOR_SIZE; ++i) checksum ^= data[i];
+        data[SECTOR_SIZE + 1] = checksum;
+        data[SECTOR_SIZE + 2] = 0;
+        data[SECTOR_SIZE + 3] = 0;
+        encodeGcr(data, std::span<uint8_t>(gcr).subspan(position, DATA_GCR_SIZE));
+        position += DATA_GCR_SIZE + gap;
+    }
+    cache[track - 1] = std::move(gcr);
+}
+
+std::vector<uint8_t> Exporter::image()
+{
+    auto offsetTable = HEADER_SIZE;
+    auto speedTable = offsetTable + HALF_TRACKS * 4;
+    auto trackData = speedTable + HALF_TRACKS * 4;
+    auto trackSlot = 2 + MAX_TRACK_SIZE;
+
+    std::vector<uint8_t> bytes(trackData + tracks * trackSlot, 0);
+    std::copy(std::begin(SIGNATURE), std::end(SIGNATURE), bytes.begin());
+    bytes[9] = HALF_TRACKS;
+    bytes[10] = MAX_TRACK_SIZE & 0xFF;
+    bytes[11] = MAX_TRACK_SIZE >> 8;
+
+    // only full tracks are written, half tracks keep a zero offset
+    for (auto t = 1; t <= tracks; ++t) {
+        auto halfTrack = static_cast<size_t>(2 * (t - 1));
+        auto offset = trackData + (t - 1) * trackSlot;
+        auto gcr = track(t);
+        put32(bytes, offsetTable + halfTrack * 4, static_cast<uint32_t>(offset));
+        put32(bytes, speedTable + halfTrack * 4, static_cast<uint32_t>(speedZone(t)));
+        bytes[offset] = static_cast<uint8_t>(gcr.size() & 0xFF);
+        bytes[offset + 1] = static_cast<uint8_t>(gcr.size() >> 8);
+        std::copy(gcr.begin(), gcr.end(), bytes.begin() + offset + 2);
+    }
+    return bytes;
+}
+
+bool Exporter::save(const std::string& filename)
+{
+    std::ofstream outFile(filename, std::ios::binary);
+    if (!outFile) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+    auto bytes = image();
+    outFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(outFile);
+}
+
+std::vector<Conversion> convertBatch(const std::vector<std::string>& images, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<Conversion> results(images.size());
+    parallelFor(images.size(), threads, [&](size_t index) {
+        auto& conversion = results[index];
+        conversion.image = images[index];
+        try {
+            d64 disk(images[index]);
+            auto g64 = std::filesystem::path(outputDirectory) / std::filesystem::path(images[index]).stem();
+            g64 += ".g64";
+            Exporter(disk).save(g64.string());
+            conversion.g64 = g64.string();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << images[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+size_t ImportResult::badSectors() const
+{
+    return static_cast<size_t>(std::count_if(errors.begin(), errors.end(), [](auto code) { return code != SECTOR_OK; }));
+}
+
+ImportResult importImage(std::span<const uint8_t> bytes, d64& disk, unsigned threads)
+{
+    if (bytes.size() < HEADER_SIZE || !std::equal(std::begin(SIGNATURE), std::end(SIGNATURE), bytes.begin())) {
+        throw std::invalid_argument("Not a G64 image");
+    }
+    size_t halfTracks = bytes[9];
+    if (HEADER_SIZE + halfTracks * 8 > bytes.size()) {
+        throw std::invalid_argument("Truncated G64 track table");
+    }
+
+    auto tracks = disk.TRACKS;
+    if (tracks > TRACKS_40) {
+        throw std::invalid_argument("G64 holds a single sided disk");
+    }
+    ImportResult result;
+    result.errors.assign(d64::TRACK_OFFSETS[tracks - 1] / SECTOR_SIZE + d64::SECTORS_PER_TRACK[tracks - 1], NO_SYNC);
+    std::vector<std::array<uint8_t, 2>> ids(result.errors.size());
+
+    // every track writes its own sectors, so they can be decoded at the same time
+    parallelFor(static_cast<size_t>(tracks), threads, [&](size_t index) {
+        auto halfTrack = 2 * index;
+        if (halfTrack >= halfTracks) return;
+        size_t offset = read32(bytes, HEADER_SIZE + halfTrack * 4);
+        if (offset == 0 || offset + 2 > bytes.size()) return;
+        size_t length = bytes[offset] | (bytes[offset + 1] << 8);
+        length = std::min(length, bytes.size() - offset - 2);
+        if (length == 0) return;
+
+        auto first = static_cast<size_t>(d64::TRACK_OFFSETS[index] / SECTOR_SIZE);
+        auto sectors = static_cast<size_t>(d64::SECTORS_PER_TRACK[index]);
+        decodeTrack(TrackBits(bytes.subspan(offset + 2, length)), static_cast<int>(index) + 1, disk,
+            std::span<uint8_t>(result.errors).subspan(first, sectors),
+            std::span<std::array<uint8_t, 2>>(ids).subspan(first, sectors));
+    });
+
+    // sectors formatted with another id than the BAM were written by a different disk
+    auto bamIndex = static_cast<size_t>(d64::TRACK_OFFSETS[DIRECTORY_TRACK - 1] / SECTOR_SIZE + BAM_SECTOR);
+    if (result.errors[bamIndex] == SECTOR_OK) {
+        std::array<uint8_t, SECTOR_SIZE> bamSector;
+        disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, bamSector);
+        std::array<uint8_t, 2> id = { bamSector[offsetof(bam, diskId)], bamSector[offsetof(bam, diskId) + 1] };
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (result.errors[i] == SECTOR_OK && ids[i] != id) result.errors[i] = ID_MISMATCH;
+        }
+    }
+    return result;
+}
+
+std::optional<ImportResult> importFile(const std::string& filename, d64& disk, unsigned threads)
+{
+    MappedFile mapped(filename);
+    if (!mapped.valid()) return std::nullopt;
+    try {
+        return importImage(mapped.bytes(), disk, threads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+bool saveWithErrors(d64& disk, const std::vector<uint8_t>& errors, const std::string& filename)
+{
+    disk.save(filename);
+    if (std::all_of(errors.begin(), errors.end(), [](auto code) { return code == SECTOR_OK; })) {
+        return true;
+    }
+    std::ofstream outFile(filename, std::ios::binary | std::ios::app);
+    if (!outFile) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+    outFile.write(reinterpret_cast<const char*>(errors.data()), errors.size());
+    return static_cast<bool>(outFile);
+}
+
+std::vector<Import> importBatch(const std::vector<std::string>& files, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<Import> results(files.size());
+    parallelFor(files.size(), threads, [&](size_t index) {
+        auto& result = results[index];
+        result.g64 = files[index];
+        try {
+            // the files already keep every worker busy, so each one decodes its tracks in turn
+            d64 disk;
+            auto decoded = importFile(files[index], disk, 1);
+            if (!decoded.has_value()) return;
+
+            auto image = std::filesystem::path(outputDirectory) / std::filesystem::path(files[index]).stem();
+            image += ".d64";
+            saveWithErrors(disk, decoded->errors, image.string());
+            result.image = image.string();
+            result.badSectors = decoded->badSectors();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << files[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+} // namespace d64lib::g64
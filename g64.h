@@ -0,0 +1,182 @@
+#pragma once
+
+#include "d64.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace d64lib::g64 {
+
+inline constexpr char SIGNATURE[8] = { 'G', 'C', 'R', '-', '1', '5', '4', '1' };
+inline constexpr int HALF_TRACKS = 84;
+inline constexpr uint16_t MAX_TRACK_SIZE = 7928;
+inline constexpr size_t HEADER_SIZE = 12;
+
+// one sync mark, the header block, the header gap, another sync mark and the data block
+inline constexpr int SYNC_SIZE = 5;
+inline constexpr int HEADER_GCR_SIZE = 10;
+inline constexpr int HEADER_GAP_SIZE = 9;
+inline constexpr int DATA_GCR_SIZE = 325;
+inline constexpr int SECTOR_GCR_SIZE = 2 * SYNC_SIZE + HEADER_GCR_SIZE + HEADER_GAP_SIZE + DATA_GCR_SIZE;
+
+inline constexpr uint8_t HEADER_BLOCK_ID = 0x08;
+inline constexpr uint8_t DATA_BLOCK_ID = 0x07;
+inline constexpr uint8_t GAP_BYTE = 0x55;
+
+/// <summary>
+/// Speed zone of a track, 3 for the outer tracks down to 0 for the inner ones
+/// </summary>
+constexpr int speedZone(int track)
+{
+    return track < 18 ? 3 : track < 25 ? 2 : track < 31 ? 1 : 0;
+}
+
+/// <summary>
+/// Bytes a 1541 writes on one revolution of a track
+/// </summary>
+constexpr int trackLength(int track)
+{
+    constexpr std::array<int, 4> lengths = { 6250, 6666, 7142, 7692 };
+    return lengths[speedZone(track)];
+}
+
+/// <summary>
+/// Encode bytes to GCR, every 4 bytes become 5
+/// </summary>
+/// <param name="bytes">bytes to encode, a multiple of 4</param>
+/// <param name="gcr">output of bytes.size() * 5 / 4 bytes</param>
+void encodeGcr(std::span<const uint8_t> bytes, std::span<uint8_t> gcr);
+
+/// <summary>
+/// Decode GCR to bytes, every 5 bytes become 4
+/// </summary>
+/// <param name="gcr">GCR bytes, a multiple of 5</param>
+/// <param name="bytes">output of gcr.size() * 4 / 5 bytes</param>
+/// <returns>false if a 5 bit code is not a valid GCR code</returns>
+bool decodeGcr(std::span<const uint8_t> gcr, std::span<uint8_t> bytes);
+
+/// <summary>
+/// Builds the GCR tracks of a disk on demand
+/// each track is encoded on first use and then kept, any thread may ask for any track
+/// </summary>
+class Exporter {
+public:
+    /// <summary>
+    /// The disk must outlive the exporter and must not change while it is used
+    /// </summary>
+    /// <param name="disk">d64 disk instance to read</param>
+    explicit Exporter(const d64& disk);
+
+    /// <summary>
+    /// GCR bitstream of one track
+    /// </summary>
+    /// <param name="track">track number starting at 1</param>
+    /// <returns>trackLength(track) bytes</returns>
+    std::span<const uint8_t> track(int track);
+
+    /// <summary>
+    /// Complete .g64 image
+    /// </summary>
+    std::vector<uint8_t> image();
+
+    /// <summary>
+    /// Write the .g64 image to a file
+    /// </summary>
+    /// <param name="filename">file to write</param>
+    /// <returns>true if successful</returns>
+    bool save(const std::string& filename);
+
+private:
+    void encodeTrack(int track);
+
+    const d64& disk;
+    int tracks;
+    std::array<uint8_t, 2> diskId;
+    std::array<std::once_flag, TRACKS_40> encoded;
+    std::array<std::vector<uint8_t>, TRACKS_40> cache;
+};
+
+struct Conversion {
+    std::string image;
+    std::string g64;            // empty if the image could not be read
+};
+
+/// <summary>
+/// Convert many disk images to .g64 in parallel
+/// each image becomes a .g64 with the same base name
+/// </summary>
+/// <param name="images">paths of .d64 files</param>
+/// <param name="outputDirectory">directory for the .g64 files</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per image in the same order as images</returns>
+std::vector<Conversion> convertBatch(const std::vector<std::string>& images, const std::string& outputDirectory, unsigned threads = 0);
+
+// codes of the per-sector error table that follows the sectors in a .d64
+inline constexpr uint8_t SECTOR_OK = 0x01;
+inline constexpr uint8_t HEADER_NOT_FOUND = 0x02;
+inline constexpr uint8_t NO_SYNC = 0x03;
+inline constexpr uint8_t DATA_NOT_FOUND = 0x04;
+inline constexpr uint8_t DATA_CHECKSUM_ERROR = 0x05;
+inline constexpr uint8_t HEADER_CHECKSUM_ERROR = 0x09;
+inline constexpr uint8_t ID_MISMATCH = 0x0B;
+
+struct ImportResult {
+    std::vector<uint8_t> errors;    // one code per sector in image order
+
+    /// <summary>
+    /// Number of sectors that did not decode cleanly
+    /// </summary>
+    size_t badSectors() const;
+};
+
+/// <summary>
+/// Decode a .g64 image into a disk, the tracks in parallel
+/// sectors that cannot be read keep what the disk held before
+/// throws std::invalid_argument if the bytes are not a .g64 image
+/// </summary>
+/// <param name="bytes">contents of the .g64 file</param>
+/// <param name="disk">d64 disk instance to write to, its track count decides how many tracks are read</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>error code of every sector</returns>
+ImportResult importImage(std::span<const uint8_t> bytes, d64& disk, unsigned threads = 0);
+
+/// <summary>
+/// Memory map and decode a .g64 file
+/// </summary>
+/// <param name="filename">file to read</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>error code of every sector or nullopt if the file could not be read</returns>
+std::optional<ImportResult> importFile(const std::string& filename, d64& disk, unsigned threads = 0);
+
+/// <summary>
+/// Save a disk with its error table appended
+/// the table is left out when every sector is fine
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="errors">error code of every sector</param>
+/// <param name="filename">file to write</param>
+/// <returns>true if successful</returns>
+bool saveWithErrors(d64& disk, const std::vector<uint8_t>& errors, const std::string& filename);
+
+struct Import {
+    std::string g64;
+    std::string image;          // empty if the .g64 could not be read
+    size_t badSectors = 0;
+};
+
+/// <summary>
+/// Convert many .g64 files to .d64 images with error tables
+/// each file becomes a .d64 with the same base name
+/// </summary>
+/// <param name="files">paths of .g64 files</param>
+/// <param name="outputDirectory">directory for the .d64 files</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per file in the same order as files</returns>
+std::vector<Import> importBatch(const std::vector<std::string>& files, const std::string& outputDirectory, unsigned threads = 0);
+
+} // namespace d64lib::g64
@@ -1,11 +1,13 @@
 #include "geos.h"
 #include <cstring>
+#include <stdexcept>
 #include <algorithm>
 #include <ranges>
+#include <span>
 
 namespace d64lib::geos {
 
-static std::string extractString(const std::vector<uint8_t>& sectorData, size_t offset, size_t maxLength) {
+static std::string extractString(std::span<const uint8_t> sectorData, size_t offset, size_t maxLength) {
     if (offset >= sectorData.size()) return "";
     
     auto start = sectorData.begin() + offset;
@@ -21,11 +23,11 @@ static std::string extractString(const std::vector<uint8_t>& sectorData, size_t
 /// <param name="disk">d64 disk instance</param>
 /// <returns>true if the GEOS format string is found</returns>
 bool isGeosDisk(d64& disk) {
-    auto bamSector = disk.readSector(DIRECTORY_TRACK, 0);
-    if (!bamSector.has_value()) return false;
-    
-    const auto& data = bamSector.value();
-    if (data.size() < 0xBD) return false;
+    // GEOS keeps its signature in the 1541 BAM, on other drives 18/0 holds data
+    if (disk.TRACKS > TRACKS_40) return false;
+
+    std::array<uint8_t, SECTOR_SIZE> data;
+    if (!disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, data)) return false;
     
     std::string sig = extractString(data, 0xAD, 16);
     return sig.starts_with("GEOS format");
@@ -38,17 +40,19 @@ bool isGeosDisk(d64& disk) {
 /// <param name="name">name of the the disk</param>
 /// <returns>true on success</returns>
 bool formatGeosDisk(d64& disk, std::string_view name) {
+    if (disk.TRACKS > TRACKS_40) {
+        throw std::invalid_argument("GEOS format needs a single sided 1541 disk");
+    }
     disk.formatDisk(name);
     
-    auto bamSector = disk.readSector(DIRECTORY_TRACK, 0);
-    if (!bamSector.has_value()) return false;
+    std::array<uint8_t, SECTOR_SIZE> data;
+    if (!disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, data)) return false;
     
-    auto data = bamSector.value();
-    std::string sig = "GEOS format V1.0";
+    constexpr std::string_view sig = "GEOS format V1.0";
     std::copy(sig.begin(), sig.end(), data.begin() + 0xAD);
     data[0xAD + sig.length()] = 0;
     
-    return disk.writeSector(DIRECTORY_TRACK, 0, data);
+    return disk.writeSector(DIRECTORY_TRACK, BAM_SECTOR, std::span<const uint8_t>(data));
 }
 
 /// <summary>
@@ -110,45 +114,40 @@ std::optional<std::vector<uint8_t>> readSequentialFile(d64& disk, std::string_vi
 }
 
 /// <summary>
-/// Read a specific Record from a VLIR file chain
+/// Append a VLIR record to a container
 /// </summary>
 /// <param name="disk">d64 disk instance</param>
 /// <param name="filename">name of the file</param>
 /// <param name="recordId">0-based record index (up to 127)</param>
-/// <returns>Optional byte array of the record payload</returns>
-std::optional<std::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view filename, int recordId) {
-    if (recordId < 0 || recordId > 127) return std::nullopt;
+/// <param name="result">container to append the record payload to</param>
+/// <returns>true if the record exists</returns>
+template <typename Container>
+static bool readVlirRecordData(d64& disk, std::string_view filename, int recordId, Container& result) {
+    if (recordId < 0 || recordId > 127) return false;
     
     auto fileEntry = disk.findFile(filename);
-    if (!fileEntry.has_value()) return std::nullopt;
+    if (!fileEntry.has_value()) return false;
     
     uint8_t indexTrack = fileEntry.value()->start.track;
     uint8_t indexSector = fileEntry.value()->start.sector;
     
-    if (indexTrack == 0) return std::nullopt;
+    if (indexTrack == 0) return false;
     
-    auto indexSectorOpt = disk.readSector(indexTrack, indexSector);
-    if (!indexSectorOpt.has_value()) return std::nullopt;
-    
-    const auto& indexBlock = indexSectorOpt.value();
-    if (indexBlock.size() < 256) return std::nullopt;
+    std::array<uint8_t, SECTOR_SIZE> indexBlock;
+    if (!disk.readSector(indexTrack, indexSector, indexBlock)) return false;
     
     int ptrOffset = 2 + (recordId * 2);
     uint8_t recordTrack = indexBlock[ptrOffset];
     uint8_t recordSector = indexBlock[ptrOffset + 1];
     
-    if (recordTrack == 0x00) return std::nullopt; 
+    if (recordTrack == 0x00) return false; 
     
-    std::vector<uint8_t> result;
     uint8_t currentTrack = recordTrack;
     uint8_t currentSector = recordSector;
+    std::array<uint8_t, SECTOR_SIZE> sectorData;
     
     while (currentTrack != 0x00) {
-        auto sectorOpt = disk.readSector(currentTrack, currentSector);
-        if (!sectorOpt.has_value()) break;
-        
-        const auto& sectorData = sectorOpt.value();
-        if (sectorData.size() < 2) break;
+        if (!disk.readSector(currentTrack, currentSector, sectorData)) break;
         
         uint8_t nextTrack = sectorData[0];
         uint8_t nextSector = sectorData[1];
@@ -165,6 +164,34 @@ std::optional<std::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view f
         currentSector = nextSector;
     }
     
+    return true;
+}
+
+/// <summary>
+/// Read a specific Record from a VLIR file chain
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the file</param>
+/// <param name="recordId">0-based record index (up to 127)</param>
+/// <returns>Optional byte array of the record payload</returns>
+std::optional<std::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view filename, int recordId) {
+    std::vector<uint8_t> result;
+    if (!readVlirRecordData(disk, filename, recordId, result)) return std::nullopt;
+    return result;
+}
+
+/// <summary>
+/// Read a specific Record from a VLIR file chain
+/// allocating the result from a memory resource
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the file</param>
+/// <param name="recordId">0-based record index (up to 127)</param>
+/// <param name="resource">memory resource for the result</param>
+/// <returns>Optional byte array of the record payload</returns>
+std::optional<std::pmr::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view filename, int recordId, std::pmr::memory_resource* resource) {
+    std::pmr::vector<uint8_t> result(resource);
+    if (!readVlirRecordData(disk, filename, recordId, result)) return std::nullopt;
     return result;
 }
 
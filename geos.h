@@ -7,6 +7,7 @@
 #include <optional>
 #include <cstdint>
 #include <array>
+#include <memory_resource>
 
 namespace d64lib::geos {
 
@@ -57,11 +58,12 @@ struct InfoBlock {
 /// Check if a disk is formatted for GEOS
 /// </summary>
 /// <param name="disk">d64 disk instance</param>
-/// <returns>true if the GEOS format string is found</returns>
+/// <returns>true if the GEOS format string is found, false for disks other than 1541</returns>
 bool isGeosDisk(d64& disk);
 
 /// <summary>
 /// Format a disk and initialize the GEOS format string
+/// throws std::invalid_argument if the disk is not a 1541 disk
 /// </summary>
 /// <param name="disk">d64 disk instance</param>
 /// <param name="name">name of the the disk</param>
@@ -85,6 +87,17 @@ std::optional<InfoBlock> readInfoBlock(d64& disk, std::string_view filename);
 /// <returns>Optional byte array of the record payload</returns>
 std::optional<std::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view filename, int recordId);
 
+/// <summary>
+/// Read a specific Record from a VLIR file chain
+/// allocating the result from a memory resource
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the file</param>
+/// <param name="recordId">0-based record index (up to 127)</param>
+/// <param name="resource">memory resource for the result</param>
+/// <returns>Optional byte array of the record payload</returns>
+std::optional<std::pmr::vector<uint8_t>> readVlirRecord(d64& disk, std::string_view filename, int recordId, std::pmr::memory_resource* resource);
+
 /// <summary>
 /// Read a Sequential GEOS file
 /// </summary>
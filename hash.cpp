@@ -0,0 +1,406 @@
+#include "hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <string>
+
+namespace d64lib::hash {
+
+namespace {
+
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t read64(const uint8_t* p)
+{
+    uint64_t value = 0;
+    for (auto i = 7; i >= 0; --i) value = (value << 8) | p[i];
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = std::rotl(acc, 31);
+    return acc * PRIME64_1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t lane)
+{
+    acc ^= round64(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+inline void storeBigEndian(uint8_t* p, uint32_t value)
+{
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+inline uint32_t loadBigEndian(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+/// <summary>
+/// Feed bytes to a 64 byte block hash, buffering a partial block
+/// </summary>
+template <typename Transform>
+void updateBlocks(std::span<const uint8_t> bytes, std::array<uint8_t, 64>& buffer, size_t& buffered, uint64_t& total, Transform&& transform)
+{
+    total += bytes.size();
+    if (buffered > 0) {
+        auto take = std::min(bytes.size(), buffer.size() - buffered);
+        std::memcpy(buffer.data() + buffered, bytes.data(), take);
+        buffered += take;
+        bytes = bytes.subspan(take);
+        if (buffered < buffer.size()) return;
+        transform(buffer.data());
+        buffered = 0;
+    }
+    while (bytes.size() >= buffer.size()) {
+        transform(bytes.data());
+        bytes = bytes.subspan(buffer.size());
+    }
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    buffered = bytes.size();
+}
+
+/// <summary>
+/// Append the Merkle-Damgard padding and length shared by SHA-1 and SHA-256
+/// </summary>
+template <typename Transform>
+void finishBlocks(std::array<uint8_t, 64>& buffer, size_t buffered, uint64_t total, Transform&& transform)
+{
+    uint64_t bits = total * 8;
+    buffer[buffered++] = 0x80;
+    if (buffered > 56) {
+        std::fill(buffer.begin() + buffered, buffer.end(), 0);
+        transform(buffer.data());
+        buffered = 0;
+    }
+    std::fill(buffer.begin() + buffered, buffer.begin() + 56, 0);
+    for (auto i = 0; i < 8; ++i) {
+        buffer[63 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    transform(buffer.data());
+}
+
+constexpr std::array<uint32_t, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+} // namespace
+
+Xxh64::Xxh64(uint64_t seed) :
+    seed(seed),
+    lanes{ seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1 }
+{
+}
+
+void Xxh64::consumeStripe(const uint8_t* stripe)
+{
+    // the lanes do not depend on each other so they run side by side
+    lanes[0] = round64(lanes[0], read64(stripe));
+    lanes[1] = round64(lanes[1], read64(stripe + 8));
+    lanes[2] = round64(lanes[2], read64(stripe + 16));
+    lanes[3] = round64(lanes[3], read64(stripe + 24));
+}
+
+void Xxh64::update(std::span<const uint8_t> bytes)
+{
+    total += bytes.size();
+    if (buffered > 0) {
+        auto take = std::min(bytes.size(), buffer.size() - buffered);
+        std::memcpy(buffer.data() + buffered, bytes.data(), take);
+        buffered += take;
+        bytes = bytes.subspan(take);
+        if (buffered < buffer.size()) return;
+        consumeStripe(buffer.data());
+        buffered = 0;
+    }
+    while (bytes.size() >= buffer.size()) {
+        consumeStripe(bytes.data());
+        bytes = bytes.subspan(buffer.size());
+    }
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    buffered = bytes.size();
+}
+
+uint64_t Xxh64::digest() const
+{
+    uint64_t h;
+    if (total >= buffer.size()) {
+        h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+        for (auto lane : lanes) {
+            h = mergeRound(h, lane);
+        }
+    }
+    else {
+        h = seed + PRIME64_5;
+    }
+    h += total;
+
+    const uint8_t* p = buffer.data();
+    size_t left = buffered;
+    for (; left >= 8; left -= 8, p += 8) {
+        h ^= round64(0, read64(p));
+        h = std::rotl(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (left >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        h = std::rotl(h, 23) * PRIME64_2 + PRIME64_3;
+        left -= 4;
+        p += 4;
+    }
+    for (; left > 0; --left, ++p) {
+        h ^= *p * PRIME64_5;
+        h = std::rotl(h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t xxh64(std::span<const uint8_t> bytes, uint64_t seed)
+{
+    Xxh64 hasher(seed);
+    hasher.update(bytes);
+    return hasher.digest();
+}
+
+Sha1::Sha1() :
+    state{ 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 }
+{
+}
+
+void Sha1::transform(const uint8_t* block)
+{
+    std::array<uint32_t, 80> w;
+    for (auto i = 0; i < 16; ++i) w[i] = loadBigEndian(block + i * 4);
+    for (auto i = 16; i < 80; ++i) w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    auto [a, b, c, d, e] = state;
+    for (auto i = 0; i < 80; ++i) {
+        uint32_t f, k;
+        if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+        auto temp = std::rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = std::rotl(b, 30);
+        b = a;
+        a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void Sha1::update(std::span<const uint8_t> bytes)
+{
+    updateBlocks(bytes, buffer, buffered, total, [this](const uint8_t* block) { transform(block); });
+}
+
+std::array<uint8_t, 20> Sha1::digest()
+{
+    finishBlocks(buffer, buffered, total, [this](const uint8_t* block) { transform(block); });
+    std::array<uint8_t, 20> result;
+    for (auto i = 0; i < 5; ++i) storeBigEndian(result.data() + i * 4, state[i]);
+    return result;
+}
+
+Sha256::Sha256() :
+    state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+{
+}
+
+void Sha256::transform(const uint8_t* block)
+{
+    std::array<uint32_t, 64> w;
+    for (auto i = 0; i < 16; ++i) w[i] = loadBigEndian(block + i * 4);
+    for (auto i = 16; i < 64; ++i) {
+        auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state;
+    for (auto i = 0; i < 64; ++i) {
+        auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        auto ch = (e & f) ^ (~e & g);
+        auto temp1 = h + s1 + ch + SHA256_K[i] + w[i];
+        auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        auto maj = (a & b) ^ (a & c) ^ (b & c);
+        auto temp2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void Sha256::update(std::span<const uint8_t> bytes)
+{
+    updateBlocks(bytes, buffer, buffered, total, [this](const uint8_t* block) { transform(block); });
+}
+
+std::array<uint8_t, 32> Sha256::digest()
+{
+    finishBlocks(buffer, buffered, total, [this](const uint8_t* block) { transform(block); });
+    std::array<uint8_t, 32> result;
+    for (auto i = 0; i < 8; ++i) storeBigEndian(result.data() + i * 4, state[i]);
+    return result;
+}
+
+Fingerprint fingerprint(d64& disk, const directoryEntry& entry, unsigned algorithms)
+{
+    Fingerprint result;
+    result.algorithms = algorithms | XXH64;
+
+    Xxh64 xxh;
+    std::optional<Sha1> sha1;
+    std::optional<Sha256> sha256;
+    if (algorithms & SHA1) sha1.emplace();
+    if (algorithms & SHA256) sha256.emplace();
+
+    disk.readFileBlocks(entry, [&](std::span<const uint8_t> block) {
+        xxh.update(block);
+        if (sha1) sha1->update(block);
+        if (sha256) sha256->update(block);
+        result.size += static_cast<uint32_t>(block.size());
+        ++result.blocks;
+        return true;
+    });
+
+    result.xxh64 = xxh.digest();
+    if (sha1) result.sha1 = sha1->digest();
+    if (sha256) result.sha256 = sha256->digest();
+    return result;
+}
+
+std::optional<Fingerprint> fingerprint(d64& disk, std::string_view filename, unsigned algorithms)
+{
+    auto entry = disk.findFile(filename);
+    if (!entry.has_value()) return std::nullopt;
+    return fingerprint(disk, *entry.value(), algorithms);
+}
+
+std::vector<FileFingerprint> fingerprintAll(d64& disk, unsigned algorithms)
+{
+    std::vector<FileFingerprint> result;
+    for (const auto& entry : disk.directory()) {
+        result.push_back({ entry, fingerprint(disk, entry, algorithms) });
+    }
+    return result;
+}
+
+/// <summary>
+/// Key of a file for the cache
+/// the directory entry and every link of the chain, read without touching the payloads
+/// </summary>
+uint64_t FingerprintCache::key(d64& disk, const directoryEntry& entry)
+{
+    Xxh64 hasher;
+    hasher.update(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&entry), sizeof(directoryEntry)));
+
+    trackSector position = entry.start;
+    for (auto count = 0; position.track != 0 && count < d64::MAX_CHAIN_SECTORS; ++count) {
+        auto link = disk.getTrackSectorPtr(position.track, position.sector);
+        hasher.update(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(link), sizeof(trackSector)));
+        position = *link;
+    }
+    return hasher.digest();
+}
+
+Fingerprint FingerprintCache::get(d64& disk, const directoryEntry& entry, unsigned algorithms)
+{
+    return get(disk, entry, algorithms, key(disk, entry));
+}
+
+Fingerprint FingerprintCache::get(d64& disk, const directoryEntry& entry, unsigned algorithms, uint64_t k)
+{
+    auto it = entries.find(k);
+    if (it != entries.end() && (it->second.algorithms & algorithms) == algorithms) {
+        ++hitCount;
+        return it->second;
+    }
+    ++missCount;
+    auto result = fingerprint(disk, entry, algorithms);
+    entries[k] = result;
+    return result;
+}
+
+std::vector<FileFingerprint> FingerprintCache::getAll(d64& disk, unsigned algorithms)
+{
+    std::unordered_map<uint64_t, Fingerprint> current;
+    std::vector<FileFingerprint> result;
+    for (const auto& entry : disk.directory()) {
+        auto k = key(disk, entry);
+        auto fp = get(disk, entry, algorithms, k);
+        current[k] = fp;
+        result.push_back({ entry, fp });
+    }
+    entries = std::move(current);
+    return result;
+}
+
+void FingerprintCache::clear()
+{
+    entries.clear();
+    hitCount = 0;
+    missCount = 0;
+}
+
+std::string toHex(std::span<const uint8_t> digest)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(digest.size() * 2);
+    for (auto b : digest) {
+        result += hex[b >> 4];
+        result += hex[b & 0x0F];
+    }
+    return result;
+}
+
+} // namespace d64lib::hash
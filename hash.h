@@ -0,0 +1,174 @@
+#pragma once
+
+#include "d64.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace d64lib::hash {
+
+/// <summary>
+/// Hash algorithms, combine as flags
+/// </summary>
+enum Algorithm : unsigned {
+    XXH64 = 1,
+    SHA1 = 2,
+    SHA256 = 4
+};
+
+/// <summary>
+/// Streaming XXH64
+/// four independent lanes are mixed per 32 byte stripe
+/// </summary>
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed = 0);
+    void update(std::span<const uint8_t> bytes);
+    uint64_t digest() const;
+
+private:
+    void consumeStripe(const uint8_t* stripe);
+
+    uint64_t seed;
+    std::array<uint64_t, 4> lanes;
+    std::array<uint8_t, 32> buffer{};
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+/// <summary>
+/// One shot XXH64
+/// </summary>
+uint64_t xxh64(std::span<const uint8_t> bytes, uint64_t seed = 0);
+
+/// <summary>
+/// Streaming SHA-1
+/// </summary>
+class Sha1 {
+public:
+    Sha1();
+    void update(std::span<const uint8_t> bytes);
+    std::array<uint8_t, 20> digest();
+
+private:
+    void transform(const uint8_t* block);
+
+    std::array<uint32_t, 5> state;
+    std::array<uint8_t, 64> buffer{};
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+/// <summary>
+/// Streaming SHA-256
+/// </summary>
+class Sha256 {
+public:
+    Sha256();
+    void update(std::span<const uint8_t> bytes);
+    std::array<uint8_t, 32> digest();
+
+private:
+    void transform(const uint8_t* block);
+
+    std::array<uint32_t, 8> state;
+    std::array<uint8_t, 64> buffer{};
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+/// <summary>
+/// Fingerprint of the contents of a file
+/// </summary>
+struct Fingerprint {
+    uint64_t xxh64 = 0;
+    std::optional<std::array<uint8_t, 20>> sha1;
+    std::optional<std::array<uint8_t, 32>> sha256;
+    uint32_t size = 0;          // payload bytes
+    uint16_t blocks = 0;        // sectors in the chain
+    unsigned algorithms = 0;
+
+    bool operator==(const Fingerprint& other) const = default;
+};
+
+struct FileFingerprint {
+    directoryEntry entry;
+    Fingerprint fingerprint;
+};
+
+/// <summary>
+/// Fingerprint a file by streaming its sector payloads
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="entry">directory entry of the file</param>
+/// <param name="algorithms">Algorithm flags, XXH64 is always computed</param>
+/// <returns>fingerprint of the file</returns>
+Fingerprint fingerprint(d64& disk, const directoryEntry& entry, unsigned algorithms = XXH64);
+
+/// <summary>
+/// Fingerprint a file by name
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the file</param>
+/// <param name="algorithms">Algorithm flags, XXH64 is always computed</param>
+/// <returns>fingerprint or nullopt if the file was not found</returns>
+std::optional<Fingerprint> fingerprint(d64& disk, std::string_view filename, unsigned algorithms = XXH64);
+
+/// <summary>
+/// Fingerprint every file on a disk
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="algorithms">Algorithm flags, XXH64 is always computed</param>
+/// <returns>fingerprints in directory order</returns>
+std::vector<FileFingerprint> fingerprintAll(d64& disk, unsigned algorithms = XXH64);
+
+/// <summary>
+/// Remembers the fingerprints of the files of one image
+/// a file is only hashed again when its directory entry or its sector chain changed
+/// sectors rewritten in place behind the same chain are not noticed, call clear() after such edits
+/// </summary>
+class FingerprintCache {
+public:
+    /// <summary>
+    /// Get the fingerprint of a file
+    /// </summary>
+    /// <param name="disk">d64 disk instance</param>
+    /// <param name="entry">directory entry of the file</param>
+    /// <param name="algorithms">Algorithm flags, XXH64 is always computed</param>
+    /// <returns>cached or new fingerprint</returns>
+    Fingerprint get(d64& disk, const directoryEntry& entry, unsigned algorithms = XXH64);
+
+    /// <summary>
+    /// Get the fingerprints of every file on the disk
+    /// entries of files that are gone are dropped
+    /// </summary>
+    /// <param name="disk">d64 disk instance</param>
+    /// <param name="algorithms">Algorithm flags, XXH64 is always computed</param>
+    /// <returns>fingerprints in directory order</returns>
+    std::vector<FileFingerprint> getAll(d64& disk, unsigned algorithms = XXH64);
+
+    void clear();
+    size_t size() const { return entries.size(); }
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+
+private:
+    static uint64_t key(d64& disk, const directoryEntry& entry);
+    Fingerprint get(d64& disk, const directoryEntry& entry, unsigned algorithms, uint64_t k);
+
+    std::unordered_map<uint64_t, Fingerprint> entries;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+};
+
+/// <summary>
+/// Format a digest as lowercase hex
+/// </summary>
+std::string toHex(std::span<const uint8_t> digest);
+
+} // namespace d64lib::hash
@@ -0,0 +1,239 @@
+#include "lnx.h"
+#include "parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace d64lib::lnx {
+
+namespace {
+
+constexpr uint8_t CR = 0x0D;
+
+/// <summary>
+/// Numbers are written in decimal with spaces in front, text may follow
+/// </summary>
+uint32_t parseNumber(std::span<const uint8_t> raw)
+{
+    auto text = std::string_view(reinterpret_cast<const char*>(raw.data()), raw.size());
+    auto first = text.find_first_not_of(' ');
+    if (first == std::string_view::npos) {
+        throw std::invalid_argument("Bad number in LNX directory");
+    }
+    text.remove_prefix(first);
+    uint32_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc()) {
+        throw std::invalid_argument("Bad number in LNX directory");
+    }
+    return value;
+}
+
+/// <summary>
+/// Reads the CR terminated fields of the archive directory
+/// </summary>
+class FieldReader {
+public:
+    FieldReader(std::span<const uint8_t> bytes, size_t position) :
+        bytes(bytes),
+        position(position)
+    {
+    }
+
+    std::span<const uint8_t> field()
+    {
+        auto start = position;
+        while (position < bytes.size() && bytes[position] != CR) ++position;
+        if (position >= bytes.size()) {
+            throw std::invalid_argument("Truncated LNX directory");
+        }
+        return bytes.subspan(start, position++ - start);
+    }
+
+    uint32_t number() { return parseNumber(field()); }
+
+private:
+    std::span<const uint8_t> bytes;
+    size_t position;
+};
+
+/// <summary>
+/// Skip the BASIC stub in front of the directory
+/// the stub is a regular program, so its lines are followed until the end link
+/// </summary>
+size_t skipStub(std::span<const uint8_t> bytes)
+{
+    size_t position = 2;
+    while (position + 4 <= bytes.size()) {
+        if (bytes[position] == 0 && bytes[position + 1] == 0) {
+            return position + 2;
+        }
+        position += 4;
+        while (position < bytes.size() && bytes[position] != 0) ++position;
+        ++position;
+    }
+    throw std::invalid_argument("Not a LNX archive");
+}
+
+/// <summary>
+/// Side sectors in a relative file of the given total size
+/// each side sector lists up to SIDE_SECTOR_CHAIN_SZ data blocks
+/// </summary>
+uint32_t sideSectorCount(uint32_t blocks)
+{
+    return (blocks + SIDE_SECTOR_CHAIN_SZ) / (SIDE_SECTOR_CHAIN_SZ + 1);
+}
+
+} // namespace
+
+Archive::Archive(std::span<const uint8_t> bytes) :
+    bytes(bytes)
+{
+    parse();
+}
+
+Archive::Archive(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes) :
+    owner(std::move(owner)),
+    bytes(bytes)
+{
+    parse();
+}
+
+std::optional<Archive> Archive::open(const std::string& filename)
+{
+    auto mapped = std::make_shared<const MappedFile>(filename);
+    if (!mapped->valid()) return std::nullopt;
+    try {
+        auto bytes = mapped->bytes();
+        return Archive(std::move(mapped), bytes);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+void Archive::parse()
+{
+    if (bytes.size() < 4) {
+        throw std::invalid_argument("Not a LNX archive");
+    }
+    auto position = skipStub(bytes);
+    if (position >= bytes.size() || bytes[position] != CR) {
+        throw std::invalid_argument("Not a LNX archive");
+    }
+
+    // the signature line starts with the size of the stub and directory in blocks
+    FieldReader reader(bytes, position + 1);
+    auto signature = reader.field();
+    auto text = std::string_view(reinterpret_cast<const char*>(signature.data()), signature.size());
+    if (text.find("LYNX") == std::string_view::npos) {
+        throw std::invalid_argument("Not a LNX archive");
+    }
+    headerBlocks = parseNumber(signature);
+    auto fileCount = reader.number();
+
+    uint32_t offset = headerBlocks * BLOCK_SIZE;
+    for (uint32_t index = 0; index < fileCount; ++index) {
+        auto raw = reader.field();
+        auto length = std::min<size_t>(raw.size(), FILE_NAME_SZ);
+        while (length > 0 && raw[length - 1] == A0_VALUE) --length;
+
+        Entry entry;
+        entry.name = petscii_name(std::string_view(reinterpret_cast<const char*>(raw.data()), length));
+        entry.blocks = reader.number();
+        auto type = reader.field();
+        switch (type.empty() ? 'P' : type[0]) {
+        case 'D': entry.fileType = d64FileTypes::DEL; break;
+        case 'S': entry.fileType = d64FileTypes::SEQ; break;
+        case 'U': entry.fileType = d64FileTypes::USR; break;
+        case 'R': entry.fileType = d64FileTypes::REL; break;
+        default: entry.fileType = d64FileTypes::PRG; break;
+        }
+        entry.lastBlockSize = static_cast<uint8_t>(reader.number());
+        if (entry.fileType == d64FileTypes::REL) {
+            entry.recordSize = static_cast<uint8_t>(reader.number());
+        }
+
+        // the side sectors of a relative file are stored in front of its data
+        auto dataBlocks = entry.blocks;
+        entry.offset = offset;
+        if (entry.fileType == d64FileTypes::REL) {
+            auto side = sideSectorCount(entry.blocks);
+            dataBlocks -= side;
+            entry.offset += side * BLOCK_SIZE;
+        }
+        entry.length = dataBlocks == 0 ? 0 :
+            (dataBlocks - 1) * BLOCK_SIZE + std::max(entry.lastBlockSize, uint8_t(1)) - 1;
+        offset += entry.blocks * BLOCK_SIZE;
+        files.push_back(entry);
+    }
+}
+
+std::span<const uint8_t> Archive::data(const Entry& entry) const
+{
+    // the last file is often cut off after its last used byte
+    if (entry.offset >= bytes.size()) return {};
+    return bytes.subspan(entry.offset, std::min<size_t>(entry.length, bytes.size() - entry.offset));
+}
+
+ImportResult importArchive(const Archive& archive, d64& disk)
+{
+    ImportResult result;
+    for (const auto& entry : archive.entries()) {
+        if (entry.fileType == d64FileTypes::REL && entry.recordSize == 0) {
+            result.skipped.push_back({ entry.name, "relative file without a record size" });
+            continue;
+        }
+        if (disk.findFile(entry.name).has_value()) {
+            result.skipped.push_back({ entry.name, "a file with this name is already on the disk" });
+            continue;
+        }
+
+        try {
+            if (!disk.addFile(entry.name.view(), c64FileType(entry.fileType), archive.data(entry), entry.recordSize)) {
+                result.skipped.push_back({ entry.name, "directory full" });
+                continue;
+            }
+        }
+        catch (const std::exception& e) {
+            result.skipped.push_back({ entry.name, e.what() });
+            continue;
+        }
+        result.imported.push_back(entry.name);
+    }
+    return result;
+}
+
+std::vector<Conversion> convertBatch(const std::vector<std::string>& archives, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<Conversion> results(archives.size());
+    parallelFor(archives.size(), threads, [&](size_t index) {
+        auto& conversion = results[index];
+        conversion.archive = archives[index];
+        try {
+            auto archive = Archive::open(archives[index]);
+            if (!archive.has_value()) {
+                std::cerr << "Error: " << archives[index] << ": not a LNX archive" << std::endl;
+                return;
+            }
+
+            d64 disk;
+            conversion.result = importArchive(archive.value(), disk);
+
+            auto image = std::filesystem::path(outputDirectory) / std::filesystem::path(archives[index]).stem();
+            image += ".d64";
+            disk.save(image.string());
+            conversion.image = image.string();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << archives[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+} // namespace d64lib::lnx
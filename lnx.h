@@ -0,0 +1,111 @@
+#pragma once
+
+#include "d64.h"
+#include "mapped_file.h"
+#include "petscii_name.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace d64lib::lnx {
+
+inline constexpr size_t BLOCK_SIZE = SECTOR_SIZE - 2;
+
+/// <summary>
+/// A file in the archive directory
+/// </summary>
+struct Entry {
+    petscii_name name;
+    d64FileTypes fileType = d64FileTypes::PRG;
+    uint32_t blocks = 0;        // blocks on disk, side sectors of a relative file included
+    uint8_t lastBlockSize = 0;  // bytes used in the last block plus one
+    uint8_t recordSize = 0;     // relative files only
+    uint32_t offset = 0;        // position of the first data block in the container
+    uint32_t length = 0;        // data bytes, side sectors left out
+};
+
+/// <summary>
+/// Read only view of a .lnx archive
+/// </summary>
+class Archive {
+public:
+    /// <summary>
+    /// Parse archive bytes that stay alive elsewhere
+    /// throws std::invalid_argument if the bytes are not a Lynx archive
+    /// </summary>
+    /// <param name="bytes">bytes of the archive</param>
+    explicit Archive(std::span<const uint8_t> bytes);
+
+    /// <summary>
+    /// Memory map and parse a .lnx file
+    /// </summary>
+    /// <param name="filename">file to open</param>
+    /// <returns>archive or nullopt if the file could not be read or is not a Lynx archive</returns>
+    static std::optional<Archive> open(const std::string& filename);
+
+    /// <summary>
+    /// Blocks taken by the BASIC stub and the directory
+    /// </summary>
+    uint32_t directoryBlocks() const { return headerBlocks; }
+
+    /// <summary>
+    /// Files in the archive in directory order
+    /// </summary>
+    const std::vector<Entry>& entries() const { return files; }
+
+    /// <summary>
+    /// Data of a file, a view into the archive
+    /// </summary>
+    /// <param name="entry">entry of this archive</param>
+    /// <returns>data bytes</returns>
+    std::span<const uint8_t> data(const Entry& entry) const;
+
+private:
+    Archive(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes);
+    void parse();
+
+    std::shared_ptr<const MappedFile> owner;
+    std::span<const uint8_t> bytes;
+    uint32_t headerBlocks = 0;
+    std::vector<Entry> files;
+};
+
+struct Skipped {
+    petscii_name name;
+    std::string reason;
+};
+
+struct ImportResult {
+    std::vector<petscii_name> imported;
+    std::vector<Skipped> skipped;
+};
+
+/// <summary>
+/// Write every file of an archive to a disk
+/// files that do not fit are skipped and the rest still go on the disk
+/// </summary>
+/// <param name="archive">archive to read</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <returns>files imported and files skipped with the reason</returns>
+ImportResult importArchive(const Archive& archive, d64& disk);
+
+struct Conversion {
+    std::string archive;
+    std::string image;          // empty if the archive could not be read
+    ImportResult result;
+};
+
+/// <summary>
+/// Convert many archives to disk images in parallel
+/// each archive becomes a .d64 with the same base name
+/// </summary>
+/// <param name="archives">paths of .lnx files</param>
+/// <param name="outputDirectory">directory for the .d64 files</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per archive in the same order as archives</returns>
+std::vector<Conversion> convertBatch(const std::vector<std::string>& archives, const std::string& outputDirectory, unsigned threads = 0);
+
+} // namespace d64lib::lnx
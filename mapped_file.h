@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace d64lib {
+
+/// <summary>
+/// A read only memory mapping of a whole file
+/// </summary>
+class MappedFile {
+public:
+    /// <summary>
+    /// Map a file
+    /// </summary>
+    /// <param name="filename">file to map</param>
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const uint8_t> bytes() const { return { data, size }; }
+
+    /// <summary>
+    /// Check if the file was mapped, an empty or missing file is not
+    /// </summary>
+    bool valid() const { return data != nullptr; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+} // namespace d64lib
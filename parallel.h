@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace d64lib {
+
+/// <summary>
+/// Run fn(index) for every index in [0, count) on a set of worker threads
+/// indices are handed out one at a time so uneven work balances out
+/// the first exception thrown by fn is rethrown once all workers finished
+/// </summary>
+/// <param name="count">number of indices</param>
+/// <param name="threads">number of threads, 0 for one per core</param>
+/// <param name="fn">work for one index</param>
+template <typename Fn>
+void parallelFor(size_t count, unsigned threads, Fn&& fn)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+
+    std::atomic<size_t> nextIndex = 0;
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    auto worker = [&]() {
+        for (auto index = nextIndex++; index < count; index = nextIndex++) {
+            try {
+                fn(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(errorLock);
+                if (!error) error = std::current_exception();
+            }
+        }
+    };
+
+    if (threads <= 1) {
+        worker();
+    }
+    else {
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace d64lib
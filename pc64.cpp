@@ -0,0 +1,240 @@
+#include "pc64.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+namespace d64lib::pc64 {
+
+namespace {
+
+constexpr size_t NAME_OFFSET = 8;
+constexpr size_t RECORD_SIZE_OFFSET = 25;
+
+constexpr char extensionLetter(d64FileTypes type)
+{
+    switch (type) {
+    case d64FileTypes::DEL: return 'd';
+    case d64FileTypes::SEQ: return 's';
+    case d64FileTypes::USR: return 'u';
+    case d64FileTypes::REL: return 'r';
+    default: return 'p';
+    }
+}
+
+} // namespace
+
+std::optional<d64FileTypes> typeFromExtension(std::string_view extension)
+{
+    if (!extension.empty() && extension[0] == '.') extension.remove_prefix(1);
+    if (extension.size() != 3 ||
+        !std::isdigit(static_cast<unsigned char>(extension[1])) ||
+        !std::isdigit(static_cast<unsigned char>(extension[2]))) {
+        return std::nullopt;
+    }
+    switch (std::tolower(static_cast<unsigned char>(extension[0]))) {
+    case 'd': return d64FileTypes::DEL;
+    case 's': return d64FileTypes::SEQ;
+    case 'p': return d64FileTypes::PRG;
+    case 'u': return d64FileTypes::USR;
+    case 'r': return d64FileTypes::REL;
+    default: return std::nullopt;
+    }
+}
+
+std::array<uint8_t, HEADER_SIZE> makeHeader(const petscii_name& name, uint8_t recordSize)
+{
+    // the name is padded with zeros here, not with $A0 as on disk
+    std::array<uint8_t, HEADER_SIZE> header{};
+    std::memcpy(header.data(), SIGNATURE, sizeof(SIGNATURE));
+    auto view = name.view();
+    std::memcpy(header.data() + NAME_OFFSET, view.data(), view.size());
+    header[RECORD_SIZE_OFFSET] = recordSize;
+    return header;
+}
+
+Container::Container(std::span<const uint8_t> bytes, d64FileTypes type) :
+    bytes(bytes),
+    fileType(type)
+{
+    parse();
+}
+
+Container::Container(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes, d64FileTypes type) :
+    owner(std::move(owner)),
+    bytes(bytes),
+    fileType(type)
+{
+    parse();
+}
+
+std::optional<Container> Container::open(const std::string& filename)
+{
+    auto type = typeFromExtension(std::filesystem::path(filename).extension().string());
+    if (!type.has_value()) return std::nullopt;
+
+    auto mapped = std::make_shared<const MappedFile>(filename);
+    if (!mapped->valid()) return std::nullopt;
+    try {
+        auto bytes = mapped->bytes();
+        return Container(std::move(mapped), bytes, type.value());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+void Container::parse()
+{
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), SIGNATURE, sizeof(SIGNATURE)) != 0) {
+        throw std::invalid_argument("Not a PC64 file");
+    }
+    auto raw = bytes.subspan(NAME_OFFSET, FILE_NAME_SZ);
+    auto length = raw.size();
+    while (length > 0 && (raw[length - 1] == 0x00 || raw[length - 1] == 0xA0)) {
+        --length;
+    }
+    fileName = petscii_name(std::string_view(reinterpret_cast<const char*>(raw.data()), length));
+    recordLength = bytes[RECORD_SIZE_OFFSET];
+    if (fileType == d64FileTypes::REL && recordLength == 0) {
+        throw std::invalid_argument("Relative file without a record size");
+    }
+}
+
+bool importFile(const Container& container, d64& disk)
+{
+    if (disk.findFile(container.name()).has_value()) return false;
+
+    auto data = container.data();
+    auto recordSize = container.type() == d64FileTypes::REL ? container.recordSize() : 0;
+    return disk.addFile(container.name().view(), c64FileType(container.type()), data, recordSize);
+}
+
+bool exportFile(d64& disk, const directoryEntry& entry, const std::string& filename)
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+
+    auto recordSize = entry.file_type.type == d64FileTypes::REL ? entry.recordLength : 0;
+    auto header = makeHeader(petscii_name::fromRaw(entry.fileName), recordSize);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    disk.readFileBlocks(entry, [&](std::span<const uint8_t> block) {
+        out.write(reinterpret_cast<const char*>(block.data()), block.size());
+        return static_cast<bool>(out);
+    });
+    return static_cast<bool>(out);
+}
+
+std::string hostName(const petscii_name& name, d64FileTypes type, int number)
+{
+    std::string host;
+    for (auto ch : name.view()) {
+        auto c = static_cast<unsigned char>(ch);
+        host += c < 0x80 && std::isalnum(c) ? static_cast<char>(std::tolower(c)) : '_';
+    }
+    if (host.empty()) host = "file";
+
+    // two digits, negative numbers wrap around like the positive ones
+    auto digits = std::to_string((number % 100 + 100) % 100);
+    if (digits.size() < 2) digits.insert(digits.begin(), '0');
+    return host + '.' + extensionLetter(type) + digits;
+}
+
+std::vector<std::string> exportDisk(d64& disk, const std::string& directory)
+{
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::string> written;
+    std::set<std::string> used;
+    for (const auto& entry : disk.directory()) {
+        auto name = petscii_name::fromRaw(entry.fileName);
+        auto type = entry.file_type.type;
+
+        // names that only differ in characters the host cannot keep get the next number
+        std::string host;
+        for (auto number = 0; number < 100; ++number) {
+            host = hostName(name, type, number);
+            if (used.insert(host).second) break;
+            host.clear();
+        }
+        if (host.empty()) {
+            std::cerr << "Error: " << directory << ": no free name for " << name.view() << std::endl;
+            continue;
+        }
+
+        auto path = (std::filesystem::path(directory) / host).string();
+        if (exportFile(disk, entry, path)) {
+            written.push_back(path);
+        }
+    }
+    return written;
+}
+
+ImportResult importFiles(const std::vector<std::string>& files, d64& disk)
+{
+    ImportResult result;
+    for (const auto& file : files) {
+        auto container = Container::open(file);
+        if (!container.has_value()) {
+            result.failed.push_back({ file, "not a PC64 file" });
+            continue;
+        }
+        if (disk.findFile(container->name()).has_value()) {
+            result.failed.push_back({ file, "a file with this name is already on the disk" });
+            continue;
+        }
+        try {
+            if (!importFile(container.value(), disk)) {
+                result.failed.push_back({ file, "disk or directory full" });
+                continue;
+            }
+        }
+        catch (const std::exception& e) {
+            result.failed.push_back({ file, e.what() });
+            continue;
+        }
+        result.imported.push_back(file);
+    }
+    return result;
+}
+
+ImportResult importDirectory(const std::string& directory, d64& disk)
+{
+    std::vector<std::string> files;
+    for (const auto& item : std::filesystem::directory_iterator(directory)) {
+        if (item.is_regular_file() && typeFromExtension(item.path().extension().string()).has_value()) {
+            files.push_back(item.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return importFiles(files, disk);
+}
+
+std::vector<DiskExport> exportImages(const std::vector<std::string>& images, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<DiskExport> results(images.size());
+    parallelFor(images.size(), threads, [&](size_t index) {
+        auto& result = results[index];
+        result.image = images[index];
+        try {
+            d64 disk(images[index]);
+            auto directory = std::filesystem::path(outputDirectory) / std::filesystem::path(images[index]).stem();
+            result.files = exportDisk(disk, directory.string());
+            result.directory = directory.string();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << images[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+} // namespace d64lib::pc64
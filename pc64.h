@@ -0,0 +1,153 @@
+#pragma once
+
+#include "d64.h"
+#include "mapped_file.h"
+#include "petscii_name.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace d64lib::pc64 {
+
+inline constexpr size_t HEADER_SIZE = 26;
+inline constexpr char SIGNATURE[8] = { 'C', '6', '4', 'F', 'i', 'l', 'e', 0 };
+
+/// <summary>
+/// Get the file type of a PC64 extension like .P00 or .r12
+/// </summary>
+/// <param name="extension">extension with or without the dot</param>
+/// <returns>file type or nullopt if it is not a PC64 extension</returns>
+std::optional<d64FileTypes> typeFromExtension(std::string_view extension);
+
+/// <summary>
+/// Build the header of a PC64 file
+/// </summary>
+/// <param name="name">original file name</param>
+/// <param name="recordSize">record size of a REL file, 0 otherwise</param>
+/// <returns>header bytes</returns>
+std::array<uint8_t, HEADER_SIZE> makeHeader(const petscii_name& name, uint8_t recordSize = 0);
+
+/// <summary>
+/// Read only view of one .P00 / .S00 / .U00 / .R00 / .D00 file
+/// </summary>
+class Container {
+public:
+    /// <summary>
+    /// Parse container bytes that stay alive elsewhere
+    /// throws std::invalid_argument if the bytes are not a PC64 file
+    /// </summary>
+    /// <param name="bytes">bytes of the file</param>
+    /// <param name="type">file type, it comes from the extension</param>
+    Container(std::span<const uint8_t> bytes, d64FileTypes type);
+
+    /// <summary>
+    /// Memory map and parse a PC64 file
+    /// </summary>
+    /// <param name="filename">file to open</param>
+    /// <returns>container or nullopt if the file could not be read or is not a PC64 file</returns>
+    static std::optional<Container> open(const std::string& filename);
+
+    const petscii_name& name() const { return fileName; }
+    d64FileTypes type() const { return fileType; }
+    uint8_t recordSize() const { return recordLength; }
+
+    /// <summary>
+    /// Contents of the C64 file, a view into the container
+    /// </summary>
+    std::span<const uint8_t> data() const { return bytes.subspan(HEADER_SIZE); }
+
+private:
+    Container(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes, d64FileTypes type);
+    void parse();
+
+    std::shared_ptr<const MappedFile> owner;
+    std::span<const uint8_t> bytes;
+    d64FileTypes fileType;
+    petscii_name fileName;
+    uint8_t recordLength = 0;
+};
+
+/// <summary>
+/// Write a PC64 file to a disk
+/// throws std::runtime_error if the disk is full, nothing is left allocated
+/// </summary>
+/// <param name="container">file to write</param>
+/// <param name="disk">d64 disk instance</param>
+/// <returns>true if successful</returns>
+bool importFile(const Container& container, d64& disk);
+
+/// <summary>
+/// Write a file of a disk as a PC64 file, streaming it from its sector chain
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="entry">directory entry of the file</param>
+/// <param name="filename">file to write</param>
+/// <returns>true if successful</returns>
+bool exportFile(d64& disk, const directoryEntry& entry, const std::string& filename);
+
+/// <summary>
+/// Host file name for a C64 file
+/// letters and digits are kept, everything else becomes an underscore
+/// </summary>
+/// <param name="name">C64 file name</param>
+/// <param name="type">file type</param>
+/// <param name="number">number in the extension, raised when names collide</param>
+/// <returns>name like game_1.p00</returns>
+std::string hostName(const petscii_name& name, d64FileTypes type, int number = 0);
+
+/// <summary>
+/// Export every file of a disk as a PC64 set
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="directory">directory for the files, created if needed</param>
+/// <returns>paths of the files written in directory order</returns>
+std::vector<std::string> exportDisk(d64& disk, const std::string& directory);
+
+struct Failure {
+    std::string file;
+    std::string reason;
+};
+
+struct ImportResult {
+    std::vector<std::string> imported;
+    std::vector<Failure> failed;
+};
+
+/// <summary>
+/// Write a set of PC64 files to a disk
+/// </summary>
+/// <param name="files">paths of PC64 files</param>
+/// <param name="disk">d64 disk instance</param>
+/// <returns>files imported and files that failed with the reason</returns>
+ImportResult importFiles(const std::vector<std::string>& files, d64& disk);
+
+/// <summary>
+/// Write every PC64 file of a directory to a disk, in file name order
+/// </summary>
+/// <param name="directory">directory to read</param>
+/// <param name="disk">d64 disk instance</param>
+/// <returns>files imported and files that failed with the reason</returns>
+ImportResult importDirectory(const std::string& directory, d64& disk);
+
+struct DiskExport {
+    std::string image;
+    std::string directory;      // empty if the image could not be read
+    std::vector<std::string> files;
+};
+
+/// <summary>
+/// Export many disk images to PC64 sets in parallel
+/// each image gets a directory with its base name
+/// </summary>
+/// <param name="images">paths of .d64 files</param>
+/// <param name="outputDirectory">directory for the sets</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per image in the same order as images</returns>
+std::vector<DiskExport> exportImages(const std::vector<std::string>& images, const std::string& outputDirectory, unsigned threads = 0);
+
+} // namespace d64lib::pc64
@@ -0,0 +1,306 @@
+#include "petscii.h"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define D64_PETSCII_SSE2 1
+#endif
+
+namespace d64lib::petscii {
+
+namespace {
+
+// a run of characters that transcode by adding a constant
+struct Range {
+    int8_t lo;
+    int8_t hi;
+    int8_t delta;
+};
+
+constexpr std::array<Range, 2> TO_ASCII_UPPER = { {
+    { 0x00, 0x5B, 0 },
+    { 0x5D, 0x5D, 0 },
+} };
+
+constexpr std::array<Range, 6> TO_ASCII_LOWER = { {
+    { 0x00, 0x40, 0 },
+    { 0x5B, 0x5B, 0 },
+    { 0x5D, 0x5D, 0 },
+    { 0x41, 0x5A, 0x20 },
+    { 0x61, 0x7A, -0x20 },
+    { -0x3F, -0x26, -0x80 },      // $C1 - $DA
+} };
+
+constexpr std::array<Range, 3> FROM_ASCII_UPPER = { {
+    { 0x00, 0x5B, 0 },
+    { 0x5D, 0x5D, 0 },
+    { 0x61, 0x7A, -0x20 },
+} };
+
+constexpr std::array<Range, 5> FROM_ASCII_LOWER = { {
+    { 0x00, 0x40, 0 },
+    { 0x5B, 0x5B, 0 },
+    { 0x5D, 0x5D, 0 },
+    { 0x41, 0x5A, -0x80 },
+    { 0x61, 0x7A, -0x20 },
+} };
+
+constexpr std::array<char, 256> makeAsciiOut(Charset charset)
+{
+    std::array<char, 256> table{};
+    for (auto c = 0; c < 256; ++c) {
+        auto u = toUnicode(static_cast<uint8_t>(c), charset);
+        table[c] = u < 0x80 ? static_cast<char>(u) : '?';
+    }
+    return table;
+}
+
+constexpr std::array<char, 256> PETSCII_TO_ASCII_UPPER = makeAsciiOut(Charset::Uppercase);
+constexpr std::array<char, 256> PETSCII_TO_ASCII_LOWER = makeAsciiOut(Charset::Lowercase);
+
+constexpr size_t BLOCK = 16;
+
+/// <summary>
+/// Transcode whole 16 byte blocks while every byte falls in one of the ranges
+/// </summary>
+/// <returns>number of bytes transcoded, a multiple of 16</returns>
+template <size_t N>
+size_t transcodeBlocks(const uint8_t* in, size_t size, uint8_t* out, const std::array<Range, N>& ranges)
+{
+    size_t done = 0;
+#if defined(D64_PETSCII_SSE2)
+    while (done + BLOCK <= size) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        auto handled = _mm_setzero_si128();
+        auto delta = _mm_setzero_si128();
+        for (const auto& range : ranges) {
+            auto above = _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(range.lo - 1)));
+            auto below = _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(range.hi + 1)));
+            auto mask = _mm_and_si128(above, below);
+            handled = _mm_or_si128(handled, mask);
+            delta = _mm_or_si128(delta, _mm_and_si128(mask, _mm_set1_epi8(range.delta)));
+        }
+        if (_mm_movemask_epi8(handled) != 0xFFFF) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), _mm_add_epi8(v, delta));
+        done += BLOCK;
+    }
+#endif
+    return done;
+}
+
+template <size_t N>
+size_t transcodeBytes(const uint8_t* in, size_t size, uint8_t* out, const std::array<Range, N>& ranges, auto&& scalar)
+{
+    size_t done = 0;
+    while (done < size) {
+        done += transcodeBlocks(in + done, size - done, out + done, ranges);
+
+        // at most one block that needs the full table
+        auto end = std::min(size, done + BLOCK);
+        for (; done < end; ++done) {
+            out[done] = scalar(in[done]);
+        }
+    }
+    return size;
+}
+
+void appendCodePoint(char32_t u, std::string& utf8)
+{
+    if (u < 0x80) {
+        utf8 += static_cast<char>(u);
+    }
+    else if (u < 0x800) {
+        utf8 += static_cast<char>(0xC0 | (u >> 6));
+        utf8 += static_cast<char>(0x80 | (u & 0x3F));
+    }
+    else if (u < 0x10000) {
+        utf8 += static_cast<char>(0xE0 | (u >> 12));
+        utf8 += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+        utf8 += static_cast<char>(0x80 | (u & 0x3F));
+    }
+    else {
+        utf8 += static_cast<char>(0xF0 | (u >> 18));
+        utf8 += static_cast<char>(0x80 | ((u >> 12) & 0x3F));
+        utf8 += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+        utf8 += static_cast<char>(0x80 | (u & 0x3F));
+    }
+}
+
+/// <summary>
+/// Decode one UTF-8 sequence
+/// </summary>
+/// <returns>code point or UNMAPPED for a malformed sequence</returns>
+char32_t decodeCodePoint(std::string_view utf8, size_t& pos)
+{
+    auto lead = static_cast<uint8_t>(utf8[pos++]);
+    int extra = 0;
+    char32_t u = 0;
+    if (lead < 0x80) return lead;
+    if ((lead & 0xE0) == 0xC0) { extra = 1; u = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { extra = 2; u = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { extra = 3; u = lead & 0x07; }
+    else return UNMAPPED;
+
+    for (auto i = 0; i < extra; ++i) {
+        if (pos >= utf8.size() || (static_cast<uint8_t>(utf8[pos]) & 0xC0) != 0x80) return UNMAPPED;
+        u = (u << 6) | (static_cast<uint8_t>(utf8[pos++]) & 0x3F);
+    }
+    return u;
+}
+
+} // namespace
+
+size_t toAscii(std::span<const uint8_t> petscii, std::span<char> ascii, Charset charset)
+{
+    auto size = std::min(petscii.size(), ascii.size());
+    auto out = reinterpret_cast<uint8_t*>(ascii.data());
+    if (charset == Charset::Uppercase) {
+        return transcodeBytes(petscii.data(), size, out, TO_ASCII_UPPER,
+            [](uint8_t c) { return static_cast<uint8_t>(PETSCII_TO_ASCII_UPPER[c]); });
+    }
+    return transcodeBytes(petscii.data(), size, out, TO_ASCII_LOWER,
+        [](uint8_t c) { return static_cast<uint8_t>(PETSCII_TO_ASCII_LOWER[c]); });
+}
+
+size_t fromAscii(std::string_view ascii, std::span<uint8_t> petscii, Charset charset)
+{
+    auto size = std::min(ascii.size(), petscii.size());
+    auto in = reinterpret_cast<const uint8_t*>(ascii.data());
+    const auto& table = charset == Charset::Uppercase ? ASCII_TO_UPPERCASE : ASCII_TO_LOWERCASE;
+    auto scalar = [&](uint8_t c) { return c < 0x80 ? table[c] : UNMAPPED_PETSCII; };
+    if (charset == Charset::Uppercase) {
+        return transcodeBytes(in, size, petscii.data(), FROM_ASCII_UPPER, scalar);
+    }
+    return transcodeBytes(in, size, petscii.data(), FROM_ASCII_LOWER, scalar);
+}
+
+void appendUtf8(std::span<const uint8_t> petscii, std::string& utf8, Charset charset)
+{
+    const auto& table = charset == Charset::Uppercase ? UPPERCASE_TO_UNICODE : LOWERCASE_TO_UNICODE;
+    utf8.reserve(utf8.size() + petscii.size());
+
+    size_t pos = 0;
+    while (pos < petscii.size()) {
+        // a block that stays ASCII goes straight into the string, the string only grows by one block at a time
+        if (petscii.size() - pos >= BLOCK) {
+            auto start = utf8.size();
+            utf8.resize(start + BLOCK);
+            auto out = reinterpret_cast<uint8_t*>(utf8.data() + start);
+            size_t done = charset == Charset::Uppercase ?
+                transcodeBlocks(petscii.data() + pos, BLOCK, out, TO_ASCII_UPPER) :
+                transcodeBlocks(petscii.data() + pos, BLOCK, out, TO_ASCII_LOWER);
+            utf8.resize(start + done);
+            pos += done;
+            if (done == BLOCK) continue;
+        }
+
+        auto end = std::min(petscii.size(), pos + BLOCK);
+        for (; pos < end; ++pos) {
+            appendCodePoint(table[petscii[pos]], utf8);
+        }
+    }
+}
+
+std::string toUtf8(std::span<const uint8_t> petscii, Charset charset)
+{
+    std::string utf8;
+    appendUtf8(petscii, utf8, charset);
+    return utf8;
+}
+
+std::string toUtf8(std::string_view petscii, Charset charset)
+{
+    return toUtf8(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(petscii.data()), petscii.size()), charset);
+}
+
+std::string toUtf8(const petscii_name& name, Charset charset)
+{
+    return toUtf8(name.view(), charset);
+}
+
+std::vector<std::string> toUtf8(std::span<const petscii_name> names, Charset charset)
+{
+    std::vector<std::string> result;
+    result.reserve(names.size());
+    for (const auto& name : names) {
+        result.push_back(toUtf8(name, charset));
+    }
+    return result;
+}
+
+std::vector<uint8_t> fromUtf8(std::string_view utf8, Charset charset)
+{
+    std::vector<uint8_t> petscii;
+    petscii.reserve(utf8.size());
+
+    size_t pos = 0;
+    while (pos < utf8.size()) {
+        // transcode the ASCII run in one go
+        auto run = std::find_if(utf8.begin() + pos, utf8.end(), [](char c) { return static_cast<uint8_t>(c) >= 0x80; }) - (utf8.begin() + pos);
+        if (run > 0) {
+            auto start = petscii.size();
+            petscii.resize(start + run);
+            fromAscii(utf8.substr(pos, run), std::span<uint8_t>(petscii).subspan(start), charset);
+            pos += run;
+            continue;
+        }
+        petscii.push_back(fromUnicode(decodeCodePoint(utf8, pos), charset));
+    }
+    return petscii;
+}
+
+SeqTextReader::SeqTextReader(d64& disk, const directoryEntry& entry, Charset charset) :
+    disk(disk),
+    charset(charset),
+    position(entry.start)
+{
+}
+
+std::optional<std::string_view> SeqTextReader::next()
+{
+    line.clear();
+    while (true) {
+        if (block.empty()) {
+            if (blocksRead++ >= d64::MAX_CHAIN_SECTORS) {
+                throw std::runtime_error("Sector chain loops");
+            }
+            auto payload = disk.nextFileBlock(position);
+            if (!payload.has_value()) {
+                // a last line without a carriage return
+                if (!pending) return std::nullopt;
+                pending = false;
+                return line;
+            }
+            block = payload.value();
+            continue;
+        }
+
+        auto end = std::find(block.begin(), block.end(), CARRIAGE_RETURN);
+        auto length = static_cast<size_t>(end - block.begin());
+        appendUtf8(block.first(length), line, charset);
+        if (end != block.end()) {
+            block = block.subspan(length + 1);
+            pending = false;
+            return line;
+        }
+
+        // the line carries over into the next sector
+        block = {};
+        pending = true;
+    }
+}
+
+bool readSeqLines(d64& disk, std::string_view filename, const std::function<bool(std::string_view)>& line, Charset charset)
+{
+    auto entry = disk.findFile(filename);
+    if (!entry.has_value()) return false;
+
+    SeqTextReader reader(disk, *entry.value(), charset);
+    while (auto text = reader.next()) {
+        if (!line(text.value())) break;
+    }
+    return true;
+}
+
+} // namespace d64lib::petscii
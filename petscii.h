@@ -0,0 +1,308 @@
+#pragma once
+
+#include "d64.h"
+#include <string>
+#include <vector>
+#include <string_view>
+#include <span>
+#include <cstdint>
+#include <array>
+#include <optional>
+#include <functional>
+
+namespace d64lib::petscii {
+
+/// <summary>
+/// The two character sets of the C64
+/// Uppercase is the power-on uppercase/graphics set
+/// Lowercase is the shifted lowercase/uppercase set
+/// </summary>
+enum class Charset : uint8_t {
+    Uppercase = 0,
+    Lowercase = 1
+};
+
+inline constexpr char32_t UNMAPPED = U'\uFFFD';
+inline constexpr uint8_t UNMAPPED_PETSCII = '?';
+
+namespace detail {
+
+// $A0 - $BF in the uppercase/graphics set
+inline constexpr std::array<char32_t, 32> UPPER_BLOCK_A0 = {
+    U'\u00A0', U'\u258C', U'\u2584', U'\u2594', U'\u2581', U'\u258F', U'\u2592', U'\u2595',
+    U'\U0001FB8F', U'\u25E4', U'\U0001FB87', U'\u251C', U'\u2597', U'\u2514', U'\u2510', U'\u2582',
+    U'\u250C', U'\u2534', U'\u252C', U'\u2524', U'\u258E', U'\u258D', U'\U0001FB88', U'\U0001FB82',
+    U'\U0001FB83', U'\u2583', U'\U0001FB7F', U'\u2596', U'\u259D', U'\u2518', U'\u2598', U'\u259A'
+};
+
+// $C0 - $DF in the uppercase/graphics set
+inline constexpr std::array<char32_t, 32> UPPER_BLOCK_C0 = {
+    U'\u2500', U'\u2660', U'\U0001FB72', U'\U0001FB78', U'\U0001FB77', U'\U0001FB76', U'\U0001FB7A', U'\U0001FB71',
+    U'\U0001FB74', U'\u256E', U'\u2570', U'\u256F', U'\U0001FB7C', U'\u2572', U'\u2571', U'\U0001FB7D',
+    U'\U0001FB7E', U'\u25CF', U'\U0001FB7B', U'\u2665', U'\U0001FB70', U'\u256D', U'\u2573', U'\u25CB',
+    U'\u2663', U'\U0001FB75', U'\u2666', U'\u253C', U'\U0001FB8C', U'\U0001FB73', U'\u03C0', U'\u25E5'
+};
+
+constexpr std::array<char32_t, 256> makeTable(Charset charset)
+{
+    std::array<char32_t, 256> table{};
+    for (auto c = 0; c < 256; ++c) {
+        char32_t u = UNMAPPED;
+        if (c < 0x20) {
+            u = static_cast<char32_t>(c);                       // control codes
+        }
+        else if (c < 0x40) {
+            u = static_cast<char32_t>(c);                       // digits and punctuation match ASCII
+        }
+        else if (c == 0x40) {
+            u = U'@';
+        }
+        else if (c <= 0x5A) {
+            u = static_cast<char32_t>(charset == Charset::Uppercase ? c : c + 0x20);
+        }
+        else if (c == 0x5B) {
+            u = U'[';
+        }
+        else if (c == 0x5C) {
+            u = U'\u00A3';                                      // pound
+        }
+        else if (c == 0x5D) {
+            u = U']';
+        }
+        else if (c == 0x5E) {
+            u = U'\u2191';                                      // up arrow
+        }
+        else if (c == 0x5F) {
+            u = U'\u2190';                                      // left arrow
+        }
+        else if (c < 0x80) {
+            continue;                                           // $60 - $7F repeat $C0 - $DF, filled below
+        }
+        else if (c < 0xA0) {
+            u = static_cast<char32_t>(c);                       // C1 control codes
+        }
+        else if (c < 0xC0) {
+            u = UPPER_BLOCK_A0[c - 0xA0];
+        }
+        else if (c < 0xE0) {
+            u = UPPER_BLOCK_C0[c - 0xC0];
+        }
+        else if (c < 0xFF) {
+            u = UPPER_BLOCK_A0[c - 0xE0];                       // $E0 - $FE repeat $A0 - $BE
+        }
+        else {
+            u = U'\u03C0';                                      // $FF is pi
+        }
+
+        if (charset == Charset::Lowercase) {
+            if (c >= 0xC1 && c <= 0xDA) {
+                u = static_cast<char32_t>(c - 0x80);            // uppercase letters
+            }
+            else if (c == 0xDE || c == 0xFF) {
+                u = U'\U0001FB96';                              // checkerboard replaces pi
+            }
+            else if (c == 0xDF) {
+                u = U'\U0001FB98';
+            }
+            else if (c == 0xA9 || c == 0xE9) {
+                u = U'\U0001FB99';
+            }
+            else if (c == 0xBA || c == 0xFA) {
+                u = U'\u2713';                                  // check mark
+            }
+        }
+        table[c] = u;
+    }
+
+    // $60 - $7F mirror $C0 - $DF which are only filled in by now
+    for (auto c = 0x60; c < 0x80; ++c) {
+        table[c] = table[c + 0x60];
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 128> makeAsciiTable(Charset charset)
+{
+    std::array<uint8_t, 128> table{};
+    for (auto c = 0; c < 128; ++c) {
+        uint8_t p = UNMAPPED_PETSCII;
+        if (c < 0x20) {
+            p = static_cast<uint8_t>(c);
+        }
+        else if (c <= 0x5B || c == 0x5D) {
+            p = static_cast<uint8_t>(c);
+        }
+        else if (c >= 'a' && c <= 'z') {
+            p = static_cast<uint8_t>(c - 0x20);
+        }
+        if (charset == Charset::Lowercase && c >= 'A' && c <= 'Z') {
+            p = static_cast<uint8_t>(c + 0x80);
+        }
+        table[c] = p;
+    }
+    return table;
+}
+
+} // namespace detail
+
+/// <summary>
+/// PETSCII to Unicode for the uppercase/graphics set
+/// </summary>
+inline constexpr std::array<char32_t, 256> UPPERCASE_TO_UNICODE = detail::makeTable(Charset::Uppercase);
+
+/// <summary>
+/// PETSCII to Unicode for the lowercase/uppercase set
+/// </summary>
+inline constexpr std::array<char32_t, 256> LOWERCASE_TO_UNICODE = detail::makeTable(Charset::Lowercase);
+
+/// <summary>
+/// ASCII to PETSCII for each set
+/// lowercase letters fold to uppercase in the uppercase set
+/// </summary>
+inline constexpr std::array<uint8_t, 128> ASCII_TO_UPPERCASE = detail::makeAsciiTable(Charset::Uppercase);
+inline constexpr std::array<uint8_t, 128> ASCII_TO_LOWERCASE = detail::makeAsciiTable(Charset::Lowercase);
+
+/// <summary>
+/// Convert a PETSCII character to Unicode
+/// </summary>
+/// <param name="c">PETSCII character</param>
+/// <param name="charset">character set</param>
+/// <returns>Unicode code point</returns>
+constexpr char32_t toUnicode(uint8_t c, Charset charset = Charset::Uppercase)
+{
+    return charset == Charset::Uppercase ? UPPERCASE_TO_UNICODE[c] : LOWERCASE_TO_UNICODE[c];
+}
+
+/// <summary>
+/// Convert a Unicode code point to PETSCII
+/// </summary>
+/// <param name="u">Unicode code point</param>
+/// <param name="charset">character set</param>
+/// <returns>PETSCII character or UNMAPPED_PETSCII</returns>
+constexpr uint8_t fromUnicode(char32_t u, Charset charset = Charset::Uppercase)
+{
+    if (u < 0x80) {
+        return charset == Charset::Uppercase ? ASCII_TO_UPPERCASE[u] : ASCII_TO_LOWERCASE[u];
+    }
+    const auto& table = charset == Charset::Uppercase ? UPPERCASE_TO_UNICODE : LOWERCASE_TO_UNICODE;
+    for (auto c = 0x80; c < 0x100; ++c) {
+        if (table[c] == u) return static_cast<uint8_t>(c);
+    }
+    for (auto c = 0x5C; c < 0x80; ++c) {
+        if (table[c] == u) return static_cast<uint8_t>(c);
+    }
+    return UNMAPPED_PETSCII;
+}
+
+/// <summary>
+/// Transcode PETSCII to ASCII one byte per character
+/// characters without an ASCII equivalent become '?'
+/// </summary>
+/// <param name="petscii">PETSCII bytes</param>
+/// <param name="ascii">output, at least petscii.size() bytes</param>
+/// <param name="charset">character set</param>
+/// <returns>number of bytes written</returns>
+size_t toAscii(std::span<const uint8_t> petscii, std::span<char> ascii, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode ASCII to PETSCII one byte per character
+/// </summary>
+/// <param name="ascii">ASCII text</param>
+/// <param name="petscii">output, at least ascii.size() bytes</param>
+/// <param name="charset">character set</param>
+/// <returns>number of bytes written</returns>
+size_t fromAscii(std::string_view ascii, std::span<uint8_t> petscii, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode PETSCII to UTF-8 appending to a string
+/// </summary>
+/// <param name="petscii">PETSCII bytes</param>
+/// <param name="utf8">string to append to</param>
+/// <param name="charset">character set</param>
+void appendUtf8(std::span<const uint8_t> petscii, std::string& utf8, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode PETSCII to UTF-8
+/// </summary>
+/// <param name="petscii">PETSCII bytes</param>
+/// <param name="charset">character set</param>
+/// <returns>UTF-8 text</returns>
+std::string toUtf8(std::span<const uint8_t> petscii, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode a PETSCII string such as the result of d64::Trim or d64::diskname
+/// </summary>
+/// <param name="petscii">PETSCII text</param>
+/// <param name="charset">character set</param>
+/// <returns>UTF-8 text</returns>
+std::string toUtf8(std::string_view petscii, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode a disk or file name without its padding
+/// </summary>
+/// <param name="name">PETSCII name</param>
+/// <param name="charset">character set</param>
+/// <returns>UTF-8 text</returns>
+std::string toUtf8(const petscii_name& name, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode many names at once
+/// </summary>
+/// <param name="names">PETSCII names</param>
+/// <param name="charset">character set</param>
+/// <returns>UTF-8 names in the same order</returns>
+std::vector<std::string> toUtf8(std::span<const petscii_name> names, Charset charset = Charset::Uppercase);
+
+/// <summary>
+/// Transcode UTF-8 to PETSCII
+/// code points with no PETSCII equivalent become '?'
+/// </summary>
+/// <param name="utf8">UTF-8 text</param>
+/// <param name="charset">character set</param>
+/// <returns>PETSCII bytes</returns>
+std::vector<uint8_t> fromUtf8(std::string_view utf8, Charset charset = Charset::Uppercase);
+
+inline constexpr uint8_t CARRIAGE_RETURN = 0x0D;
+
+/// <summary>
+/// Reads a SEQ file as lines of text
+/// lines end at a carriage return and are transcoded to UTF-8 as the
+/// sector chain is walked, so only the current line is held in memory
+/// </summary>
+class SeqTextReader {
+public:
+    /// <summary>
+    /// Start reading a file
+    /// </summary>
+    /// <param name="disk">d64 disk instance, must outlive the reader</param>
+    /// <param name="entry">directory entry of the file</param>
+    /// <param name="charset">character set of the text</param>
+    SeqTextReader(d64& disk, const directoryEntry& entry, Charset charset = Charset::Uppercase);
+
+    /// <summary>
+    /// Read the next line
+    /// </summary>
+    /// <returns>line without the carriage return, valid until the next call, or nullopt at the end of the file</returns>
+    std::optional<std::string_view> next();
+
+private:
+    d64& disk;
+    Charset charset;
+    trackSector position;
+    std::span<const uint8_t> block;
+    int blocksRead = 0;
+    bool pending = false;
+    std::string line;
+};
+
+/// <summary>
+/// Read every line of a SEQ file
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="filename">name of the file</param>
+/// <param name="line">called for each line, return false to stop</param>
+/// <param name="charset">character set of the text</param>
+/// <returns>false if the file was not found</returns>
+bool readSeqLines(d64& disk, std::string_view filename, const std::function<bool(std::string_view)>& line, Charset charset = Charset::Uppercase);
+
+} // namespace d64lib::petscii
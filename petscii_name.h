@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define D64_PETSCII_NAME_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define D64_PETSCII_NAME_NEON 1
+#endif
+
+#include "d64_types.h"
+
+/// <summary>
+/// A file or disk name as stored on disk
+/// FILE_NAME_SZ PETSCII bytes padded with A0
+/// the name ends at the first A0 so a padded name compares
+/// equal to the name trimmed from a directory entry
+/// </summary>
+class petscii_name {
+public:
+    static constexpr size_t capacity = FILE_NAME_SZ;
+
+    /// <summary>
+    /// empty name, all padding
+    /// </summary>
+    constexpr petscii_name()
+    {
+        bytes.fill(static_cast<char>(A0_VALUE));
+    }
+
+    /// <summary>
+    /// construct from a name
+    /// truncated to FILE_NAME_SZ and padded with A0
+    /// </summary>
+    /// <param name="name">name to store</param>
+    explicit constexpr petscii_name(std::string_view name)
+    {
+        size_t i = 0;
+        for (; i < capacity && i < name.size() && name[i] != static_cast<char>(A0_VALUE); ++i) {
+            bytes[i] = name[i];
+        }
+        for (; i < capacity; ++i) {
+            bytes[i] = static_cast<char>(A0_VALUE);
+        }
+    }
+
+    /// <summary>
+    /// construct from the raw name of a directory entry or the BAM
+    /// anything after the first A0 is replaced by padding
+    /// </summary>
+    /// <param name="raw">FILE_NAME_SZ raw bytes</param>
+    /// <returns>normalized name</returns>
+    static constexpr petscii_name fromRaw(const char* raw)
+    {
+        return petscii_name(std::string_view(raw, capacity));
+    }
+
+    /// <summary>
+    /// number of characters before the padding
+    /// </summary>
+    constexpr size_t size() const
+    {
+        size_t len = 0;
+        while (len < capacity && bytes[len] != static_cast<char>(A0_VALUE)) ++len;
+        return len;
+    }
+
+    constexpr bool empty() const { return bytes[0] == static_cast<char>(A0_VALUE); }
+
+    /// <summary>
+    /// the name without padding
+    /// </summary>
+    constexpr std::string_view view() const { return std::string_view(bytes.data(), size()); }
+
+    /// <summary>
+    /// the padded FILE_NAME_SZ bytes
+    /// </summary>
+    constexpr const std::array<char, FILE_NAME_SZ>& padded() const { return bytes; }
+
+    /// <summary>
+    /// copy the padded name to a directory entry or BAM name field
+    /// </summary>
+    /// <param name="dest">FILE_NAME_SZ bytes to write</param>
+    void copyTo(char* dest) const
+    {
+        std::memcpy(dest, bytes.data(), capacity);
+    }
+
+    /// <summary>
+    /// compare against a raw name without normalizing it first
+    /// only valid when the raw name is padded with A0 after its end
+    /// </summary>
+    bool equalsPadded(const char* raw) const
+    {
+#if defined(D64_PETSCII_NAME_SSE2)
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data()));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+#elif defined(D64_PETSCII_NAME_NEON)
+        auto a = vld1q_u8(reinterpret_cast<const uint8_t*>(bytes.data()));
+        auto b = vld1q_u8(reinterpret_cast<const uint8_t*>(raw));
+        return vminvq_u8(vceqq_u8(a, b)) == 0xFF;
+#else
+        return std::memcmp(bytes.data(), raw, capacity) == 0;
+#endif
+    }
+
+    constexpr bool operator==(const petscii_name& other) const
+    {
+        if (std::is_constant_evaluated()) {
+            return bytes == other.bytes;
+        }
+        return equalsPadded(other.bytes.data());
+    }
+
+    /// <summary>
+    /// hash of the padded name
+    /// the name is folded as two 64 bit words
+    /// </summary>
+    constexpr size_t hash() const
+    {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+        for (auto i = 0; i < 8; ++i) {
+            lo |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (i * 8);
+            hi |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i + 8])) << (i * 8);
+        }
+        uint64_t h = lo * 0x9E3779B97F4A7C15ull;
+        h ^= (hi + 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2));
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+private:
+    std::array<char, FILE_NAME_SZ> bytes{};
+};
+
+static_assert(sizeof(petscii_name) == FILE_NAME_SZ);
+
+template <>
+struct std::hash<petscii_name> {
+    size_t operator()(const petscii_name& name) const noexcept { return name.hash(); }
+};
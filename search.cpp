@@ -0,0 +1,191 @@
+#include "search.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define D64_SEARCH_SSE2 1
+#endif
+
+namespace d64lib::search {
+
+namespace {
+
+/// <summary>
+/// Find every match of a pattern
+/// 16 positions at a time are tested on the first and last byte of the pattern
+/// and only those that pass both are compared in full
+/// </summary>
+template <typename Found>
+void findAll(std::span<const uint8_t> bytes, std::span<const uint8_t> pattern, size_t from, Found&& found)
+{
+    auto length = pattern.size();
+    if (bytes.size() < length) return;
+    auto last = bytes.size() - length;
+    auto i = from;
+
+#if defined(D64_SEARCH_SSE2)
+    auto first = _mm_set1_epi8(static_cast<char>(pattern.front()));
+    auto lastByte = _mm_set1_epi8(static_cast<char>(pattern.back()));
+    for (; i + 16 + length - 1 <= bytes.size(); i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i + length - 1));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, lastByte))));
+        while (mask != 0) {
+            auto bit = static_cast<size_t>(std::countr_zero(mask));
+            if (length <= 2 || std::memcmp(bytes.data() + i + bit + 1, pattern.data() + 1, length - 2) == 0) {
+                found(i + bit);
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last; ++i) {
+        if (bytes[i] == pattern.front() && std::memcmp(bytes.data() + i, pattern.data(), length) == 0) {
+            found(i);
+        }
+    }
+}
+
+} // namespace
+
+void foldCase(std::span<uint8_t> bytes)
+{
+    size_t i = 0;
+#if defined(D64_SEARCH_SSE2)
+    // shift each letter range down to -128 so one signed compare tests it
+    const auto lowerBias = _mm_set1_epi8(static_cast<char>(0x80 - 0x61));
+    const auto shiftedBias = _mm_set1_epi8(static_cast<char>(0x80 - 0xC1));
+    const auto limit = _mm_set1_epi8(static_cast<char>(0x80 + 26));
+    const auto lowerDelta = _mm_set1_epi8(0x20);
+    const auto shiftedDelta = _mm_set1_epi8(static_cast<char>(0x80));
+    for (; i + 16 <= bytes.size(); i += 16) {
+        auto p = reinterpret_cast<__m128i*>(bytes.data() + i);
+        auto x = _mm_loadu_si128(p);
+        auto lower = _mm_cmplt_epi8(_mm_add_epi8(x, lowerBias), limit);
+        auto shifted = _mm_cmplt_epi8(_mm_add_epi8(x, shiftedBias), limit);
+        auto delta = _mm_or_si128(_mm_and_si128(lower, lowerDelta), _mm_and_si128(shifted, shiftedDelta));
+        _mm_storeu_si128(p, _mm_sub_epi8(x, delta));
+    }
+#endif
+    for (; i < bytes.size(); ++i) {
+        bytes[i] = foldCase(bytes[i]);
+    }
+}
+
+PatternSet::PatternSet(std::vector<std::vector<uint8_t>> patterns, bool ignoreCase) :
+    patterns(std::move(patterns)),
+    fold(ignoreCase)
+{
+    for (auto& pattern : this->patterns) {
+        if (pattern.empty()) {
+            throw std::invalid_argument("Search pattern cannot be empty");
+        }
+        if (fold) foldCase(pattern);
+        longest = std::max(longest, pattern.size());
+    }
+}
+
+PatternSet PatternSet::fromText(const std::vector<std::string>& text, bool ignoreCase, petscii::Charset charset)
+{
+    std::vector<std::vector<uint8_t>> patterns;
+    for (const auto& t : text) {
+        std::vector<uint8_t> pattern(t.size());
+        pattern.resize(petscii::fromAscii(t, pattern, charset));
+        patterns.push_back(std::move(pattern));
+    }
+    return PatternSet(std::move(patterns), ignoreCase);
+}
+
+StreamMatcher::StreamMatcher(const PatternSet& patterns) :
+    patterns(patterns)
+{
+}
+
+void StreamMatcher::feed(std::span<const uint8_t> block, std::vector<Match>& matches)
+{
+    auto carry = window.size();
+    window.insert(window.end(), block.begin(), block.end());
+    if (patterns.ignoreCase()) {
+        foldCase(std::span<uint8_t>(window).subspan(carry));
+    }
+
+    // matches that lie entirely in the carried bytes were reported with the previous block
+    for (size_t index = 0; index < patterns.size(); ++index) {
+        const auto& pattern = patterns[index];
+        auto from = carry >= pattern.size() ? carry - pattern.size() + 1 : 0;
+        findAll(window, pattern, from, [&](size_t position) {
+            matches.push_back({ index, static_cast<uint32_t>(windowOffset + position) });
+        });
+    }
+
+    auto keep = std::min(window.size(), patterns.maxLength() - 1);
+    auto drop = window.size() - keep;
+    window.erase(window.begin(), window.begin() + drop);
+    windowOffset += static_cast<uint32_t>(drop);
+}
+
+void StreamMatcher::reset()
+{
+    window.clear();
+    windowOffset = 0;
+}
+
+std::vector<Match> searchFile(d64& disk, const directoryEntry& entry, const PatternSet& patterns)
+{
+    std::vector<Match> matches;
+    StreamMatcher matcher(patterns);
+    disk.readFileBlocks(entry, [&](std::span<const uint8_t> block) {
+        matcher.feed(block, matches);
+        return true;
+    });
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        if (a.offset != b.offset) return a.offset < b.offset;
+        return a.pattern < b.pattern;
+    });
+    return matches;
+}
+
+std::vector<Hit> searchDisk(d64& disk, const std::string& image, const PatternSet& patterns)
+{
+    std::vector<Hit> hits;
+    for (const auto& entry : disk.directory()) {
+        try {
+            for (const auto& match : searchFile(disk, entry, patterns)) {
+                hits.push_back({ image, entry, match.pattern, match.offset });
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error searching " << image << ": " << e.what() << std::endl;
+        }
+    }
+    return hits;
+}
+
+std::vector<Hit> searchCorpus(const std::vector<std::string>& images, const PatternSet& patterns, unsigned threads)
+{
+    std::vector<std::vector<Hit>> results(images.size());
+    parallelFor(images.size(), threads, [&](size_t index) {
+        try {
+            d64 disk(images[index]);
+            results[index] = searchDisk(disk, images[index], patterns);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << images[index] << ": " << e.what() << std::endl;
+        }
+    });
+
+    std::vector<Hit> hits;
+    for (auto& result : results) {
+        std::move(result.begin(), result.end(), std::back_inserter(hits));
+    }
+    return hits;
+}
+
+} // namespace d64lib::search
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "d64.h"
+#include "petscii.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace d64lib::search {
+
+/// <summary>
+/// Fold a PETSCII byte to uppercase
+/// letters show up as $41-$5A, $61-$7A and $C1-$DA depending on how they were typed
+/// </summary>
+constexpr uint8_t foldCase(uint8_t c)
+{
+    if (c >= 0x61 && c <= 0x7A) return static_cast<uint8_t>(c - 0x20);
+    if (c >= 0xC1 && c <= 0xDA) return static_cast<uint8_t>(c - 0x80);
+    return c;
+}
+
+/// <summary>
+/// Fold a run of PETSCII bytes to uppercase
+/// </summary>
+/// <param name="bytes">bytes to fold in place</param>
+void foldCase(std::span<uint8_t> bytes);
+
+/// <summary>
+/// The byte strings to search for
+/// </summary>
+class PatternSet {
+public:
+    /// <summary>
+    /// Create a pattern set from PETSCII byte strings
+    /// </summary>
+    /// <param name="patterns">patterns, none of them empty</param>
+    /// <param name="ignoreCase">true to match letters regardless of case</param>
+    explicit PatternSet(std::vector<std::vector<uint8_t>> patterns, bool ignoreCase = false);
+
+    /// <summary>
+    /// Create a pattern set from text
+    /// </summary>
+    /// <param name="text">patterns as ASCII, none of them empty</param>
+    /// <param name="ignoreCase">true to match letters regardless of case</param>
+    /// <param name="charset">character set the files were written in</param>
+    /// <returns>pattern set</returns>
+    static PatternSet fromText(const std::vector<std::string>& text, bool ignoreCase = false, petscii::Charset charset = petscii::Charset::Uppercase);
+
+    size_t size() const { return patterns.size(); }
+    size_t maxLength() const { return longest; }
+    bool ignoreCase() const { return fold; }
+    const std::vector<uint8_t>& operator[](size_t index) const { return patterns[index]; }
+
+private:
+    std::vector<std::vector<uint8_t>> patterns;
+    size_t longest = 0;
+    bool fold = false;
+};
+
+struct Match {
+    size_t pattern = 0;         // index into the pattern set
+    uint32_t offset = 0;        // position in the file payload
+};
+
+/// <summary>
+/// Finds patterns in a stream of blocks
+/// the end of each block is kept until the next one arrives so matches may span blocks
+/// </summary>
+class StreamMatcher {
+public:
+    explicit StreamMatcher(const PatternSet& patterns);
+
+    /// <summary>
+    /// Search the next block of the stream
+    /// </summary>
+    /// <param name="block">next bytes of the stream</param>
+    /// <param name="matches">matches that end in this block are appended</param>
+    void feed(std::span<const uint8_t> block, std::vector<Match>& matches);
+
+    /// <summary>
+    /// Start a new stream
+    /// </summary>
+    void reset();
+
+private:
+    const PatternSet& patterns;
+    std::vector<uint8_t> window;
+    uint32_t windowOffset = 0;
+};
+
+/// <summary>
+/// Search the payload of a file
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="entry">directory entry of the file</param>
+/// <param name="patterns">patterns to look for</param>
+/// <returns>matches ordered by offset</returns>
+std::vector<Match> searchFile(d64& disk, const directoryEntry& entry, const PatternSet& patterns);
+
+struct Hit {
+    std::string image;
+    directoryEntry entry;
+    size_t pattern = 0;
+    uint32_t offset = 0;
+};
+
+/// <summary>
+/// Search every file on a disk
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <param name="image">name of the image for the hits</param>
+/// <param name="patterns">patterns to look for</param>
+/// <returns>hits in directory order</returns>
+std::vector<Hit> searchDisk(d64& disk, const std::string& image, const PatternSet& patterns);
+
+/// <summary>
+/// Search every file on many disk images in parallel
+/// </summary>
+/// <param name="images">paths of .d64 files</param>
+/// <param name="patterns">patterns to look for</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>hits in the order of images</returns>
+std::vector<Hit> searchCorpus(const std::vector<std::string>& images, const PatternSet& patterns, unsigned threads = 0);
+
+} // namespace d64lib::search
@@ -0,0 +1,102 @@
+#include "shared_disk.h"
+
+namespace d64lib {
+
+SharedDisk::SharedDisk(d64 disk) :
+    disk(std::move(disk))
+{
+}
+
+SharedDisk::SharedDisk(const std::string& filename) :
+    disk(filename)
+{
+}
+
+std::optional<directoryEntry> SharedDisk::findFile(std::string_view filename) const
+{
+    auto lock = readLock();
+    auto entry = disk.findFile(filename);
+    if (!entry.has_value()) return std::nullopt;
+    return *entry.value();
+}
+
+std::vector<directoryEntry> SharedDisk::directory() const
+{
+    auto lock = readLock();
+    return disk.directory();
+}
+
+std::optional<std::vector<uint8_t>> SharedDisk::readFile(std::string_view filename) const
+{
+    auto lock = readLock();
+    if (!disk.findFile(filename).has_value()) return std::nullopt;
+    return disk.readFile(std::string(filename));
+}
+
+std::optional<std::vector<uint8_t>> SharedDisk::readRecord(std::string_view filename, int recordNumber) const
+{
+    auto lock = readLock();
+    return disk.readRecord(filename, recordNumber);
+}
+
+std::optional<std::vector<uint8_t>> SharedDisk::readSector(int track, int sector) const
+{
+    auto lock = readLock();
+    return disk.readSector(track, sector);
+}
+
+uint16_t SharedDisk::getFreeSectorCount() const
+{
+    auto lock = readLock();
+    return disk.getFreeSectorCount();
+}
+
+std::string SharedDisk::diskname() const
+{
+    auto lock = readLock();
+    return disk.diskname();
+}
+
+bool SharedDisk::save(const std::string& filename) const
+{
+    auto lock = readLock();
+    return disk.save(filename);
+}
+
+bool SharedDisk::addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize)
+{
+    auto lock = writeLock();
+    return disk.addFile(filename, type, fileData, recordSize);
+}
+
+bool SharedDisk::removeFile(std::string_view filename)
+{
+    auto lock = writeLock();
+    return disk.removeFile(filename);
+}
+
+bool SharedDisk::renameFile(std::string_view oldfilename, std::string_view newfilename)
+{
+    auto lock = writeLock();
+    return disk.renameFile(oldfilename, newfilename);
+}
+
+bool SharedDisk::writeRecord(std::string_view filename, int recordNumber, const std::vector<uint8_t>& recordData)
+{
+    auto lock = writeLock();
+    return disk.writeRecord(filename, recordNumber, recordData);
+}
+
+bool SharedDisk::writeSector(int track, int sector, std::span<const uint8_t> bytes)
+{
+    auto lock = writeLock();
+    return disk.writeSector(track, sector, bytes);
+}
+
+bool SharedDisk::compactDirectory()
+{
+    auto lock = writeLock();
+    return disk.compactDirectory();
+}
+
+} // namespace d64lib
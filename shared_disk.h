@@ -0,0 +1,101 @@
+#pragma once
+
+#include "d64.h"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace d64lib {
+
+/// <summary>
+/// A disk image shared by many threads
+/// reads run at the same time under a shared lock, changes take the lock alone
+/// a waiting change holds back new reads, so a steady stream of reads can not starve it
+/// results are copies, nothing points into the image once the lock is released
+/// </summary>
+class SharedDisk {
+public:
+    /// <summary>
+    /// Take over a disk
+    /// </summary>
+    /// <param name="disk">d64 disk instance</param>
+    explicit SharedDisk(d64 disk);
+
+    /// <summary>
+    /// Load a disk image
+    /// throws std::invalid_argument if the image can not be loaded
+    /// </summary>
+    /// <param name="filename">image to load</param>
+    explicit SharedDisk(const std::string& filename);
+
+    SharedDisk(const SharedDisk&) = delete;
+    SharedDisk& operator=(const SharedDisk&) = delete;
+
+    // reads, any number at once
+    std::optional<directoryEntry> findFile(std::string_view filename) const;
+    std::vector<directoryEntry> directory() const;
+    std::optional<std::vector<uint8_t>> readFile(std::string_view filename) const;
+    std::optional<std::vector<uint8_t>> readRecord(std::string_view filename, int recordNumber) const;
+    std::optional<std::vector<uint8_t>> readSector(int track, int sector) const;
+    uint16_t getFreeSectorCount() const;
+    std::string diskname() const;
+    bool save(const std::string& filename) const;
+
+    // changes, one at a time and never during a read
+    bool addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize = 0);
+    bool removeFile(std::string_view filename);
+    bool renameFile(std::string_view oldfilename, std::string_view newfilename);
+    bool writeRecord(std::string_view filename, int recordNumber, const std::vector<uint8_t>& recordData);
+    bool writeSector(int track, int sector, std::span<const uint8_t> bytes);
+    bool compactDirectory();
+
+    /// <summary>
+    /// Run several reads against one state of the disk
+    /// fn must not change the disk or keep pointers into it
+    /// </summary>
+    /// <param name="fn">called with the disk, its result is returned</param>
+    template <typename Fn>
+    auto withRead(Fn&& fn) const
+    {
+        auto lock = readLock();
+        return fn(disk);
+    }
+
+    /// <summary>
+    /// Run a change of several steps without other threads seeing the steps in between
+    /// </summary>
+    /// <param name="fn">called with the disk, its result is returned</param>
+    template <typename Fn>
+    auto withWrite(Fn&& fn)
+    {
+        auto lock = writeLock();
+        return fn(disk);
+    }
+
+private:
+    std::shared_lock<std::shared_mutex> readLock() const
+    {
+        std::lock_guard<std::mutex> wait(gate);
+        return std::shared_lock<std::shared_mutex>(mutex);
+    }
+
+    std::pair<std::unique_lock<std::mutex>, std::unique_lock<std::shared_mutex>> writeLock()
+    {
+        std::unique_lock<std::mutex> wait(gate);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return { std::move(wait), std::move(lock) };
+    }
+
+    // the d64 read functions are not const, the shared lock keeps them safe
+    mutable d64 disk;
+    mutable std::shared_mutex mutex;
+    mutable std::mutex gate;        // held by a writer from the moment it waits
+};
+
+} // namespace d64lib
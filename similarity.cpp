@@ -0,0 +1,204 @@
+#include "similarity.h"
+#include "hash.h"
+#include "parallel.h"
+#include <algorithm>
+#include <bitset>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace d64lib::similarity {
+
+namespace {
+
+constexpr uint64_t splitmix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+struct Permutations {
+    std::array<uint64_t, SIGNATURE_SIZE> multiply{};
+    std::array<uint64_t, SIGNATURE_SIZE> add{};
+};
+
+/// <summary>
+/// One multiply-add per signature slot stands in for a random permutation of the sector hashes
+/// the constants are fixed so signatures can be compared between runs
+/// </summary>
+constexpr Permutations makePermutations()
+{
+    Permutations p;
+    uint64_t state = 0x4436344C4942ull;
+    for (size_t i = 0; i < SIGNATURE_SIZE; ++i) {
+        p.multiply[i] = splitmix64(state) | 1;
+        p.add[i] = splitmix64(state);
+    }
+    return p;
+}
+
+constexpr Permutations PERMUTATIONS = makePermutations();
+
+} // namespace
+
+double Signature::similarity(const Signature& other) const
+{
+    if (sectors == 0 || other.sectors == 0) return 0.0;
+    size_t same = 0;
+    for (size_t i = 0; i < SIGNATURE_SIZE; ++i) {
+        same += values[i] == other.values[i];
+    }
+    return static_cast<double>(same) / SIGNATURE_SIZE;
+}
+
+bool isEmptySector(std::span<const uint8_t> bytes)
+{
+    if (bytes.empty() || (bytes[0] != 0x01 && bytes[0] != 0x4B)) return false;
+    return std::all_of(bytes.begin() + 1, bytes.end(), [](uint8_t b) { return b == 0x01; });
+}
+
+Signature signature(const d64& disk)
+{
+    Signature sig;
+    sig.values.fill(std::numeric_limits<uint32_t>::max());
+
+    // the BAM and the directory chain say more about the files than about their contents
+    std::array<std::bitset<D81_TRACK_SECTORS>, TRACKS_80 + 1> skip{};
+    auto start = disk.directoryStart();
+    skip[start.track].set(BAM_SECTOR);
+    if (disk.type() == diskType::eighty_track) {
+        // the header is followed by the two BAM sectors
+        skip[start.track].set(D81_BAM_SECTOR);
+        skip[start.track].set(D81_BAM_SECTOR + 1);
+    }
+    if (disk.type() == diskType::seventy_track) {
+        skip[D71_BAM_TRACK].set(BAM_SECTOR);
+    }
+    std::array<uint8_t, SECTOR_SIZE> sector;
+    for (int track = start.track, s = start.sector; track > 0 && track <= TRACKS_80 && s < D81_TRACK_SECTORS && !skip[track].test(s);) {
+        skip[track].set(s);
+        if (!disk.readSector(track, s, sector)) break;
+        track = sector[0];
+        s = sector[1];
+    }
+
+    for (auto track = 1; disk.trackSize(track) > 0; ++track) {
+        auto sectors = disk.trackSize(track) / SECTOR_SIZE;
+        for (auto s = 0; s < sectors; ++s) {
+            if (skip[track].test(s) || !disk.readSector(track, s, sector) || isEmptySector(sector)) continue;
+
+            // the slot loop has no dependencies between slots so it vectorizes
+            auto h = hash::xxh64(sector);
+            for (size_t i = 0; i < SIGNATURE_SIZE; ++i) {
+                auto v = static_cast<uint32_t>((h * PERMUTATIONS.multiply[i] + PERMUTATIONS.add[i]) >> 32);
+                sig.values[i] = std::min(sig.values[i], v);
+            }
+            ++sig.sectors;
+        }
+    }
+    return sig;
+}
+
+uint64_t SimilarityIndex::bandKey(const Signature& sig, size_t band)
+{
+    auto rows = std::span<const uint32_t>(sig.values).subspan(band * ROWS, ROWS);
+    return hash::xxh64(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(rows.data()), rows.size_bytes()), band);
+}
+
+size_t SimilarityIndex::addImages(const std::vector<std::string>& images, unsigned threads)
+{
+    std::vector<std::optional<Signature>> results(images.size());
+    parallelFor(images.size(), threads, [&](size_t index) {
+        try {
+            d64 disk(images[index]);
+            results[index] = signature(disk);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << images[index] << ": " << e.what() << std::endl;
+        }
+    });
+
+    size_t count = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (!results[i].has_value()) continue;
+        add(images[i], results[i].value());
+        ++count;
+    }
+    return count;
+}
+
+void SimilarityIndex::add(const std::string& image, const Signature& sig)
+{
+    uint32_t id;
+    auto it = ids.find(image);
+    if (it != ids.end()) {
+        // take the old signature out of its buckets first
+        id = it->second;
+        if (signatures[id].sectors > 0) {
+            for (size_t band = 0; band < BANDS; ++band) {
+                auto& bucket = buckets[band][bandKey(signatures[id], band)];
+                std::erase(bucket, id);
+            }
+        }
+        signatures[id] = sig;
+    }
+    else {
+        id = static_cast<uint32_t>(names.size());
+        names.push_back(image);
+        signatures.push_back(sig);
+        ids[image] = id;
+    }
+
+    // an image without sectors is like every other empty image, bucketing it would only add noise
+    if (sig.sectors == 0) return;
+    for (size_t band = 0; band < BANDS; ++band) {
+        buckets[band][bandKey(sig, band)].push_back(id);
+    }
+}
+
+std::optional<Signature> SimilarityIndex::signatureOf(const std::string& image) const
+{
+    auto it = ids.find(image);
+    if (it == ids.end()) return std::nullopt;
+    return signatures[it->second];
+}
+
+std::vector<Match> SimilarityIndex::query(const Signature& sig, double minSimilarity) const
+{
+    std::vector<Match> matches;
+    if (sig.sectors == 0) return matches;
+
+    std::vector<uint32_t> candidates;
+    for (size_t band = 0; band < BANDS; ++band) {
+        auto it = buckets[band].find(bandKey(sig, band));
+        if (it == buckets[band].end()) continue;
+        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (auto id : candidates) {
+        auto similarity = sig.similarity(signatures[id]);
+        if (similarity >= minSimilarity) {
+            matches.push_back({ names[id], similarity });
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        if (a.similarity != b.similarity) return a.similarity > b.similarity;
+        return a.image < b.image;
+    });
+    return matches;
+}
+
+std::vector<Match> SimilarityIndex::query(const std::string& image, double minSimilarity) const
+{
+    auto sig = signatureOf(image);
+    if (!sig.has_value()) return {};
+    auto matches = query(sig.value(), minSimilarity);
+    std::erase_if(matches, [&](const Match& match) { return match.image == image; });
+    return matches;
+}
+
+} // namespace d64lib::similarity
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "d64.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace d64lib::similarity {
+
+inline constexpr size_t SIGNATURE_SIZE = 128;
+inline constexpr size_t BANDS = 16;
+inline constexpr size_t ROWS = SIGNATURE_SIZE / BANDS;
+
+static_assert(BANDS * ROWS == SIGNATURE_SIZE);
+
+/// <summary>
+/// MinHash signature of the sectors of a disk image
+/// </summary>
+struct Signature {
+    std::array<uint32_t, SIGNATURE_SIZE> values{};
+    uint32_t sectors = 0;       // sectors that went into the signature
+
+    /// <summary>
+    /// Estimate the Jaccard similarity of the sector sets of two images
+    /// </summary>
+    /// <param name="other">signature of the other image</param>
+    /// <returns>0.0 - 1.0, 0.0 if either image had no sectors</returns>
+    double similarity(const Signature& other) const;
+};
+
+/// <summary>
+/// Check if a sector was never written
+/// formatting fills sectors with $01, a 1541 writes $4B as the first byte
+/// </summary>
+/// <param name="bytes">contents of the sector</param>
+/// <returns>true if the sector is empty</returns>
+bool isEmptySector(std::span<const uint8_t> bytes);
+
+/// <summary>
+/// Compute the signature of a disk
+/// the BAM, the directory sectors and empty sectors are left out
+/// </summary>
+/// <param name="disk">d64 disk instance</param>
+/// <returns>signature of the disk</returns>
+Signature signature(const d64& disk);
+
+struct Match {
+    std::string image;
+    double similarity = 0.0;
+};
+
+/// <summary>
+/// Finds disk images with mostly the same sectors, like cracked or patched versions of a release
+/// signatures are split into bands and bucketed, so a query only compares against
+/// images that share at least one band with it
+/// </summary>
+class SimilarityIndex {
+public:
+    /// <summary>
+    /// Load images and add their signatures, in parallel
+    /// </summary>
+    /// <param name="images">paths of .d64 files</param>
+    /// <param name="threads">number of worker threads, 0 for one per core</param>
+    /// <returns>number of images that were added</returns>
+    size_t addImages(const std::vector<std::string>& images, unsigned threads = 0);
+
+    /// <summary>
+    /// Add the signature of an image, replacing one with the same name
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="sig">signature of the image</param>
+    void add(const std::string& image, const Signature& sig);
+
+    /// <summary>
+    /// Get the signature of an image
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <returns>signature or nullopt if the image is not indexed</returns>
+    std::optional<Signature> signatureOf(const std::string& image) const;
+
+    /// <summary>
+    /// Find images similar to a signature
+    /// </summary>
+    /// <param name="sig">signature to compare against</param>
+    /// <param name="minSimilarity">lowest estimated similarity to report</param>
+    /// <returns>matches, most similar first</returns>
+    std::vector<Match> query(const Signature& sig, double minSimilarity = 0.9) const;
+
+    /// <summary>
+    /// Find images similar to an indexed image, leaving out the image itself
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="minSimilarity">lowest estimated similarity to report</param>
+    /// <returns>matches, most similar first</returns>
+    std::vector<Match> query(const std::string& image, double minSimilarity = 0.9) const;
+
+    size_t size() const { return names.size(); }
+
+private:
+    static uint64_t bandKey(const Signature& sig, size_t band);
+
+    std::vector<std::string> names;
+    std::vector<Signature> signatures;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::array<std::unordered_map<uint64_t, std::vector<uint32_t>>, BANDS> buckets;
+};
+
+} // namespace d64lib::similarity
@@ -0,0 +1,93 @@
+#include "snapshot_disk.h"
+
+namespace d64lib {
+
+SnapshotDisk::SnapshotDisk(d64 disk) :
+    current(std::make_shared<Version>(Version{ std::move(disk), 0 }))
+{
+}
+
+SnapshotDisk::SnapshotDisk(const std::string& filename) :
+    current(std::make_shared<Version>(Version{ d64(filename), 0 }))
+{
+}
+
+SnapshotDisk::Snapshot SnapshotDisk::snapshot() const
+{
+    return Snapshot(current.load());
+}
+
+bool SnapshotDisk::addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize)
+{
+    return change([&](d64& disk) { return disk.addFile(filename, type, fileData, recordSize); });
+}
+
+bool SnapshotDisk::removeFile(std::string_view filename)
+{
+    return change([&](d64& disk) { return disk.removeFile(filename); });
+}
+
+bool SnapshotDisk::renameFile(std::string_view oldfilename, std::string_view newfilename)
+{
+    return change([&](d64& disk) { return disk.renameFile(oldfilename, newfilename); });
+}
+
+bool SnapshotDisk::writeRecord(std::string_view filename, int recordNumber, const std::vector<uint8_t>& recordData)
+{
+    return change([&](d64& disk) { return disk.writeRecord(filename, recordNumber, recordData); });
+}
+
+bool SnapshotDisk::writeSector(int track, int sector, std::span<const uint8_t> bytes)
+{
+    return change([&](d64& disk) { return disk.writeSector(track, sector, bytes); });
+}
+
+bool SnapshotDisk::compactDirectory()
+{
+    return change([](d64& disk) { return disk.compactDirectory(); });
+}
+
+std::optional<directoryEntry> SnapshotDisk::Snapshot::findFile(std::string_view filename) const
+{
+    auto entry = pinned->disk.findFile(filename);
+    if (!entry.has_value()) return std::nullopt;
+    return *entry.value();
+}
+
+std::vector<directoryEntry> SnapshotDisk::Snapshot::directory() const
+{
+    return pinned->disk.directory();
+}
+
+std::optional<std::vector<uint8_t>> SnapshotDisk::Snapshot::readFile(std::string_view filename) const
+{
+    if (!pinned->disk.findFile(filename).has_value()) return std::nullopt;
+    return pinned->disk.readFile(std::string(filename));
+}
+
+std::optional<std::vector<uint8_t>> SnapshotDisk::Snapshot::readRecord(std::string_view filename, int recordNumber) const
+{
+    return pinned->disk.readRecord(filename, recordNumber);
+}
+
+std::optional<std::vector<uint8_t>> SnapshotDisk::Snapshot::readSector(int track, int sector) const
+{
+    return pinned->disk.readSector(track, sector);
+}
+
+uint16_t SnapshotDisk::Snapshot::getFreeSectorCount() const
+{
+    return pinned->disk.getFreeSectorCount();
+}
+
+std::string SnapshotDisk::Snapshot::diskname() const
+{
+    return pinned->disk.diskname();
+}
+
+bool SnapshotDisk::Snapshot::save(const std::string& filename) const
+{
+    return pinned->disk.save(filename);
+}
+
+} // namespace d64lib
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "d64.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace d64lib {
+
+/// <summary>
+/// A disk image read by many threads while one thread changes it
+/// readers pin a version that never changes, the writer works on a copy and publishes it in one step
+/// a version is freed when the last snapshot of it is released
+/// </summary>
+class SnapshotDisk {
+    struct Version {
+        d64 disk;
+        uint64_t number = 0;
+    };
+
+public:
+    /// <summary>
+    /// One published version of the disk, reads never wait for the writer
+    /// </summary>
+    class Snapshot {
+    public:
+        std::optional<directoryEntry> findFile(std::string_view filename) const;
+        std::vector<directoryEntry> directory() const;
+        std::optional<std::vector<uint8_t>> readFile(std::string_view filename) const;
+        std::optional<std::vector<uint8_t>> readRecord(std::string_view filename, int recordNumber) const;
+        std::optional<std::vector<uint8_t>> readSector(int track, int sector) const;
+        uint16_t getFreeSectorCount() const;
+        std::string diskname() const;
+        bool save(const std::string& filename) const;
+
+        /// <summary>
+        /// Number of changes published before this version, 0 for the disk as it was handed over
+        /// </summary>
+        uint64_t version() const { return pinned->number; }
+
+    private:
+        friend class SnapshotDisk;
+        explicit Snapshot(std::shared_ptr<Version> pinned) : pinned(std::move(pinned)) {}
+
+        // the d64 read functions are not const, a published version is only ever read
+        std::shared_ptr<Version> pinned;
+    };
+
+    /// <summary>
+    /// Take over a disk
+    /// </summary>
+    /// <param name="disk">d64 disk instance</param>
+    explicit SnapshotDisk(d64 disk);
+
+    /// <summary>
+    /// Load a disk image
+    /// throws std::invalid_argument if the image can not be loaded
+    /// </summary>
+    /// <param name="filename">image to load</param>
+    explicit SnapshotDisk(const std::string& filename);
+
+    SnapshotDisk(const SnapshotDisk&) = delete;
+    SnapshotDisk& operator=(const SnapshotDisk&) = delete;
+
+    /// <summary>
+    /// Pin the latest version, it stays readable for as long as the snapshot is kept
+    /// </summary>
+    Snapshot snapshot() const;
+
+    // changes, one at a time, published only when they succeed
+    bool addFile(std::string_view filename, c64FileType type, std::span<const uint8_t> fileData, int recordSize = 0);
+    bool removeFile(std::string_view filename);
+    bool renameFile(std::string_view oldfilename, std::string_view newfilename);
+    bool writeRecord(std::string_view filename, int recordNumber, const std::vector<uint8_t>& recordData);
+    bool writeSector(int track, int sector, std::span<const uint8_t> bytes);
+    bool compactDirectory();
+
+    /// <summary>
+    /// Run a change of several steps, readers see either none or all of it
+    /// nothing is published if fn throws
+    /// </summary>
+    /// <param name="fn">called with a private copy of the disk, its result is returned</param>
+    template <typename Fn>
+    auto withWrite(Fn&& fn)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        auto next = std::make_shared<Version>(*current.load());
+        ++next->number;
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, d64&>>) {
+            fn(next->disk);
+            current.store(std::move(next));
+        }
+        else {
+            auto result = fn(next->disk);
+            current.store(std::move(next));
+            return result;
+        }
+    }
+
+private:
+    template <typename Fn>
+    bool change(Fn&& fn)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        auto next = std::make_shared<Version>(*current.load());
+        if (!fn(next->disk)) return false;
+        ++next->number;
+        current.store(std::move(next));
+        return true;
+    }
+
+    std::atomic<std::shared_ptr<Version>> current;
+    std::mutex writer;
+};
+
+} // namespace d64lib
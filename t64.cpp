@@ -0,0 +1,185 @@
+#include "t64.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace d64lib::t64 {
+
+namespace {
+
+uint16_t read16(std::span<const uint8_t> bytes, size_t offset)
+{
+    return static_cast<uint16_t>(bytes[offset] | (bytes[offset + 1] << 8));
+}
+
+uint32_t read32(std::span<const uint8_t> bytes, size_t offset)
+{
+    return static_cast<uint32_t>(read16(bytes, offset)) | (static_cast<uint32_t>(read16(bytes, offset + 2)) << 16);
+}
+
+/// <summary>
+/// Tape names are padded with spaces instead of $A0
+/// </summary>
+petscii_name tapeString(std::span<const uint8_t> raw)
+{
+    auto length = raw.size();
+    while (length > 0 && (raw[length - 1] == 0x20 || raw[length - 1] == 0x00 || raw[length - 1] == 0xA0)) {
+        --length;
+    }
+    return petscii_name(std::string_view(reinterpret_cast<const char*>(raw.data()), length));
+}
+
+} // namespace
+
+Archive::Archive(std::span<const uint8_t> bytes) :
+    bytes(bytes)
+{
+    parse();
+}
+
+Archive::Archive(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes) :
+    owner(std::move(owner)),
+    bytes(bytes)
+{
+    parse();
+}
+
+std::optional<Archive> Archive::open(const std::string& filename)
+{
+    auto mapped = std::make_shared<const MappedFile>(filename);
+    if (!mapped->valid()) return std::nullopt;
+    try {
+        auto bytes = mapped->bytes();
+        return Archive(std::move(mapped), bytes);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+void Archive::parse()
+{
+    // the signature text differs between tools but always starts with C64
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), "C64", 3) != 0) {
+        throw std::invalid_argument("Not a T64 tape image");
+    }
+    containerVersion = read16(bytes, 0x20);
+    name = tapeString(bytes.subspan(0x28, TAPE_NAME_SIZE));
+
+    // the entry counts are often wrong, so trust only what fits in the file
+    size_t slots = std::min<size_t>(read16(bytes, 0x22), (bytes.size() - HEADER_SIZE) / ENTRY_SIZE);
+    for (size_t slot = 0; slot < slots; ++slot) {
+        auto raw = bytes.subspan(HEADER_SIZE + slot * ENTRY_SIZE, ENTRY_SIZE);
+        if (raw[0] == 0) continue;
+
+        Entry entry;
+        entry.entryType = raw[0];
+        auto type = raw[1] & 0x07;
+        entry.fileType = (raw[1] & 0x80) && type >= d64FileTypes::SEQ && type <= d64FileTypes::REL ?
+            static_cast<d64FileTypes>(type) : d64FileTypes::PRG;
+        entry.startAddress = read16(raw, 2);
+        entry.endAddress = read16(raw, 4);
+        entry.offset = read32(raw, 8);
+        entry.name = tapeString(raw.subspan(0x10, FILE_NAME_SZ));
+        files.push_back(entry);
+    }
+
+    // many converters wrote a bogus end address, so each file is cut off
+    // where the next one starts or where the container ends
+    std::vector<uint32_t> offsets;
+    for (const auto& entry : files) offsets.push_back(entry.offset);
+    std::sort(offsets.begin(), offsets.end());
+    for (auto& entry : files) {
+        if (entry.offset >= bytes.size()) continue;
+        auto next = std::upper_bound(offsets.begin(), offsets.end(), entry.offset);
+        uint32_t limit = next != offsets.end() ? *next : static_cast<uint32_t>(bytes.size());
+        limit = std::min(limit, static_cast<uint32_t>(bytes.size()));
+        uint32_t nominal = entry.endAddress > entry.startAddress ?
+            static_cast<uint32_t>(entry.endAddress - entry.startAddress) :
+            0x10000u - entry.startAddress;
+        entry.length = std::min(nominal, limit - entry.offset);
+    }
+}
+
+std::span<const uint8_t> Archive::data(const Entry& entry) const
+{
+    if (entry.offset >= bytes.size()) return {};
+    return bytes.subspan(entry.offset, std::min<size_t>(entry.length, bytes.size() - entry.offset));
+}
+
+ImportResult importArchive(const Archive& archive, d64& disk)
+{
+    ImportResult result;
+    std::vector<uint8_t> buffer;
+    size_t index = 0;
+    for (const auto& entry : archive.entries()) {
+        ++index;
+        auto name = entry.name.empty() ? petscii_name("FILE " + std::to_string(index)) : entry.name;
+
+        if (entry.fileType == d64FileTypes::REL) {
+            result.skipped.push_back({ name, "relative files have no record size on tape" });
+            continue;
+        }
+        if (disk.findFile(name).has_value()) {
+            result.skipped.push_back({ name, "a file with this name is already on the disk" });
+            continue;
+        }
+
+        // the disk copy starts with the load address the tape keeps in its directory
+        auto data = archive.data(entry);
+        buffer.clear();
+        buffer.push_back(static_cast<uint8_t>(entry.startAddress & 0xFF));
+        buffer.push_back(static_cast<uint8_t>(entry.startAddress >> 8));
+        buffer.insert(buffer.end(), data.begin(), data.end());
+
+        try {
+            if (!disk.addFile(name.view(), c64FileType(entry.fileType), std::span<const uint8_t>(buffer))) {
+                result.skipped.push_back({ name, "directory full" });
+                continue;
+            }
+        }
+        catch (const std::exception& e) {
+            result.skipped.push_back({ name, e.what() });
+            continue;
+        }
+        result.imported.push_back(name);
+    }
+    return result;
+}
+
+std::vector<Conversion> convertBatch(const std::vector<std::string>& archives, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<Conversion> results(archives.size());
+    parallelFor(archives.size(), threads, [&](size_t index) {
+        auto& conversion = results[index];
+        conversion.archive = archives[index];
+        try {
+            auto archive = Archive::open(archives[index]);
+            if (!archive.has_value()) {
+                std::cerr << "Error: " << archives[index] << ": not a T64 tape image" << std::endl;
+                return;
+            }
+
+            d64 disk;
+            if (!archive->tapeName().empty()) {
+                disk.rename_disk(archive->tapeName());
+            }
+            conversion.result = importArchive(archive.value(), disk);
+
+            auto image = std::filesystem::path(outputDirectory) / std::filesystem::path(archives[index]).stem();
+            image += ".d64";
+            disk.save(image.string());
+            conversion.image = image.string();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << archives[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+} // namespace d64lib::t64
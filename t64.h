@@ -0,0 +1,112 @@
+#pragma once
+
+#include "d64.h"
+#include "mapped_file.h"
+#include "petscii_name.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace d64lib::t64 {
+
+inline constexpr size_t HEADER_SIZE = 0x40;
+inline constexpr size_t ENTRY_SIZE = 0x20;
+inline constexpr size_t TAPE_NAME_SIZE = 24;
+
+/// <summary>
+/// A file in the tape directory
+/// </summary>
+struct Entry {
+    uint8_t entryType = 0;      // 0 free, 1 normal tape file, 3 memory snapshot
+    d64FileTypes fileType = d64FileTypes::PRG;
+    uint16_t startAddress = 0;
+    uint16_t endAddress = 0;
+    uint32_t offset = 0;        // position of the data in the container
+    uint32_t length = 0;        // data bytes after the load address, corrected
+    petscii_name name;
+};
+
+/// <summary>
+/// Read only view of a .t64 tape container
+/// </summary>
+class Archive {
+public:
+    /// <summary>
+    /// Parse container bytes that stay alive elsewhere
+    /// throws std::invalid_argument if the bytes are not a tape container
+    /// </summary>
+    /// <param name="bytes">bytes of the container</param>
+    explicit Archive(std::span<const uint8_t> bytes);
+
+    /// <summary>
+    /// Memory map and parse a .t64 file
+    /// </summary>
+    /// <param name="filename">file to open</param>
+    /// <returns>archive or nullopt if the file could not be read or is not a tape container</returns>
+    static std::optional<Archive> open(const std::string& filename);
+
+    const petscii_name& tapeName() const { return name; }
+    uint16_t version() const { return containerVersion; }
+
+    /// <summary>
+    /// Files in the container, free slots left out
+    /// </summary>
+    const std::vector<Entry>& entries() const { return files; }
+
+    /// <summary>
+    /// Data of a file without its load address, a view into the container
+    /// </summary>
+    /// <param name="entry">entry of this archive</param>
+    /// <returns>data bytes</returns>
+    std::span<const uint8_t> data(const Entry& entry) const;
+
+private:
+    Archive(std::shared_ptr<const MappedFile> owner, std::span<const uint8_t> bytes);
+    void parse();
+
+    std::shared_ptr<const MappedFile> owner;
+    std::span<const uint8_t> bytes;
+    uint16_t containerVersion = 0;
+    petscii_name name;
+    std::vector<Entry> files;
+};
+
+struct Skipped {
+    petscii_name name;
+    std::string reason;
+};
+
+struct ImportResult {
+    std::vector<petscii_name> imported;
+    std::vector<Skipped> skipped;
+};
+
+/// <summary>
+/// Write every file of a tape to a disk
+/// files that do not fit are skipped and the rest still go on the disk
+/// </summary>
+/// <param name="archive">tape to read</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <returns>files imported and files skipped with the reason</returns>
+ImportResult importArchive(const Archive& archive, d64& disk);
+
+struct Conversion {
+    std::string archive;
+    std::string image;          // empty if the archive could not be read
+    ImportResult result;
+};
+
+/// <summary>
+/// Convert many tapes to disk images in parallel
+/// each tape becomes a .d64 with the same base name, named after the tape
+/// </summary>
+/// <param name="archives">paths of .t64 files</param>
+/// <param name="outputDirectory">directory for the .d64 files</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per tape in the same order as archives</returns>
+std::vector<Conversion> convertBatch(const std::vector<std::string>& archives, const std::string& outputDirectory, unsigned threads = 0);
+
+} // namespace d64lib::t64
@@ -0,0 +1,377 @@
+#include "trigram.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "search.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace d64lib::trigram {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'D', '6', '4', 'T', 'R', 'G', 'M', 0 };
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t DOCUMENT_SIZE = 24;
+constexpr size_t TRIGRAM_SIZE = 16;
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+}
+
+template <typename T>
+void putAt(std::vector<uint8_t>& out, size_t offset, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out[offset + i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+    }
+}
+
+template <typename T>
+T get(std::span<const uint8_t> bytes, uint64_t offset)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<uint64_t>(bytes[offset + i]) << (i * 8);
+    }
+    return static_cast<T>(value);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+} // namespace
+
+std::vector<uint32_t> trigrams(std::span<const uint8_t> name)
+{
+    std::vector<uint8_t> padded = { ' ', ' ' };
+    padded.insert(padded.end(), name.begin(), name.end());
+    padded.push_back(' ');
+    search::foldCase(padded);
+
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+        result.push_back((static_cast<uint32_t>(padded[i]) << 16) | (static_cast<uint32_t>(padded[i + 1]) << 8) | padded[i + 2]);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+uint32_t TrigramIndexBuilder::imageId(const std::string& image)
+{
+    if (images.empty() || images.back() != image) {
+        images.push_back(image);
+    }
+    return static_cast<uint32_t>(images.size() - 1);
+}
+
+void TrigramIndexBuilder::add(const std::string& image, Kind kind, const petscii_name& name)
+{
+    if (name.empty()) return;
+    documents.push_back({ imageId(image), kind, name });
+    if (kind == Kind::File) {
+        nameFilters.add(image, name);
+    }
+}
+
+void TrigramIndexBuilder::addDisk(const std::string& image, d64& disk)
+{
+    add(image, Kind::Disk, petscii_name(disk.diskname()));
+    for (const auto& entry : disk.directory()) {
+        add(image, Kind::File, petscii_name::fromRaw(entry.fileName));
+    }
+}
+
+size_t TrigramIndexBuilder::addImages(const std::vector<std::string>& paths, unsigned threads)
+{
+    // only the directories are read in parallel, documents are numbered afterwards in image order
+    std::vector<std::optional<std::vector<std::pair<Kind, petscii_name>>>> names(paths.size());
+    parallelFor(paths.size(), threads, [&](size_t index) {
+        try {
+            d64 disk(paths[index]);
+            std::vector<std::pair<Kind, petscii_name>> found;
+            found.emplace_back(Kind::Disk, petscii_name(disk.diskname()));
+            for (const auto& entry : disk.directory()) {
+                found.emplace_back(Kind::File, petscii_name::fromRaw(entry.fileName));
+            }
+            names[index] = std::move(found);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << paths[index] << ": " << e.what() << std::endl;
+        }
+    });
+
+    size_t count = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!names[i].has_value()) continue;
+        for (const auto& [kind, name] : names[i].value()) {
+            add(paths[i], kind, name);
+        }
+        ++count;
+    }
+    return count;
+}
+
+std::vector<uint8_t> TrigramIndexBuilder::build() const
+{
+    // documents are added in order so every posting list comes out sorted
+    std::unordered_map<uint32_t, std::vector<uint32_t>> lists;
+    std::vector<uint8_t> counts(documents.size());
+    for (uint32_t id = 0; id < documents.size(); ++id) {
+        auto view = documents[id].name.view();
+        auto grams = trigrams(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(view.data()), view.size()));
+        counts[id] = static_cast<uint8_t>(grams.size());
+        for (auto gram : grams) {
+            lists[gram].push_back(id);
+        }
+    }
+    std::vector<uint32_t> keys;
+    keys.reserve(lists.size());
+    for (const auto& [gram, ids] : lists) keys.push_back(gram);
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint8_t> out(HEADER_SIZE);
+    std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+    putAt<uint32_t>(out, 8, VERSION);
+    putAt<uint32_t>(out, 12, static_cast<uint32_t>(images.size()));
+    putAt<uint32_t>(out, 16, static_cast<uint32_t>(documents.size()));
+    putAt<uint32_t>(out, 20, static_cast<uint32_t>(keys.size()));
+
+    putAt<uint64_t>(out, 24, out.size());
+    uint32_t stringOffset = 0;
+    for (const auto& image : images) {
+        put<uint32_t>(out, stringOffset);
+        stringOffset += static_cast<uint32_t>(image.size());
+    }
+    put<uint32_t>(out, stringOffset);
+    for (const auto& image : images) {
+        out.insert(out.end(), image.begin(), image.end());
+    }
+    while (out.size() % 8 != 0) out.push_back(0);
+
+    putAt<uint64_t>(out, 32, out.size());
+    for (uint32_t id = 0; id < documents.size(); ++id) {
+        const auto& document = documents[id];
+        put<uint32_t>(out, document.image);
+        out.push_back(static_cast<uint8_t>(document.kind));
+        out.push_back(counts[id]);
+        put<uint16_t>(out, 0);
+        auto start = out.size();
+        out.resize(start + FILE_NAME_SZ);
+        document.name.copyTo(reinterpret_cast<char*>(out.data() + start));
+    }
+
+    putAt<uint64_t>(out, 40, out.size());
+    auto table = out.size();
+    out.resize(table + keys.size() * TRIGRAM_SIZE);
+
+    auto postingStart = out.size();
+    putAt<uint64_t>(out, 48, postingStart);
+    for (size_t k = 0; k < keys.size(); ++k) {
+        const auto& ids = lists[keys[k]];
+        auto start = out.size();
+        uint32_t previous = 0;
+        for (auto id : ids) {
+            putVarint(out, id - previous);
+            previous = id;
+        }
+        auto record = table + k * TRIGRAM_SIZE;
+        putAt<uint32_t>(out, record, keys[k]);
+        putAt<uint32_t>(out, record + 4, static_cast<uint32_t>(ids.size()));
+        putAt<uint32_t>(out, record + 8, static_cast<uint32_t>(start - postingStart));
+        putAt<uint32_t>(out, record + 12, static_cast<uint32_t>(out.size() - start));
+    }
+    putAt<uint64_t>(out, 56, out.size());
+    return out;
+}
+
+bool TrigramIndexBuilder::save(const std::string& filename) const
+{
+    std::ofstream outFile(filename, std::ios::binary);
+    if (!outFile) {
+        throw std::runtime_error("Error: Could not open file for writing");
+    }
+    auto bytes = build();
+    outFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    outFile.close();
+    return static_cast<bool>(outFile);
+}
+
+TrigramIndex::TrigramIndex(std::span<const uint8_t> bytes) :
+    TrigramIndex(nullptr, bytes)
+{
+}
+
+TrigramIndex::TrigramIndex(std::vector<uint8_t> bytes)
+{
+    auto owned = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+    this->bytes = *owned;
+    owner = std::move(owned);
+    parse();
+}
+
+TrigramIndex::TrigramIndex(std::shared_ptr<const void> owner, std::span<const uint8_t> bytes) :
+    owner(std::move(owner)),
+    bytes(bytes)
+{
+    parse();
+}
+
+std::optional<TrigramIndex> TrigramIndex::open(const std::string& filename)
+{
+    auto mapped = std::make_shared<MappedFile>(filename);
+    if (!mapped->valid()) return std::nullopt;
+    try {
+        auto bytes = mapped->bytes();
+        return TrigramIndex(std::move(mapped), bytes);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+void TrigramIndex::parse()
+{
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0 || get<uint32_t>(bytes, 8) != VERSION) {
+        throw std::invalid_argument("Not a trigram index");
+    }
+    imageEntries = get<uint32_t>(bytes, 12);
+    documents = get<uint32_t>(bytes, 16);
+    trigramEntries = get<uint32_t>(bytes, 20);
+    imageOffset = get<uint64_t>(bytes, 24);
+    documentOffset = get<uint64_t>(bytes, 32);
+    trigramOffset = get<uint64_t>(bytes, 40);
+    postingOffset = get<uint64_t>(bytes, 48);
+
+    // check every table fits before anything is read from it
+    auto size = bytes.size();
+    auto stringStart = imageOffset + (static_cast<uint64_t>(imageEntries) + 1) * 4;
+    if (get<uint64_t>(bytes, 56) != size ||
+        imageOffset < HEADER_SIZE ||
+        stringStart > documentOffset ||
+        documentOffset + static_cast<uint64_t>(documents) * DOCUMENT_SIZE > trigramOffset ||
+        trigramOffset + static_cast<uint64_t>(trigramEntries) * TRIGRAM_SIZE > postingOffset ||
+        postingOffset > size ||
+        stringStart + get<uint32_t>(bytes, stringStart - 4) > documentOffset) {
+        throw std::invalid_argument("Corrupt trigram index");
+    }
+    for (uint32_t i = 0; i < imageEntries; ++i) {
+        if (get<uint32_t>(bytes, imageOffset + i * 4) > get<uint32_t>(bytes, imageOffset + (i + 1) * 4)) {
+            throw std::invalid_argument("Corrupt trigram index");
+        }
+    }
+    for (uint32_t i = 0; i < trigramEntries; ++i) {
+        auto record = trigramOffset + static_cast<uint64_t>(i) * TRIGRAM_SIZE;
+        if (postingOffset + get<uint32_t>(bytes, record + 8) + get<uint32_t>(bytes, record + 12) > size) {
+            throw std::invalid_argument("Corrupt trigram index");
+        }
+    }
+}
+
+std::string_view TrigramIndex::image(uint32_t id) const
+{
+    if (id >= imageEntries) return {};
+    auto start = get<uint32_t>(bytes, imageOffset + id * 4);
+    auto end = get<uint32_t>(bytes, imageOffset + (id + 1) * 4);
+    auto strings = imageOffset + (static_cast<uint64_t>(imageEntries) + 1) * 4;
+    return std::string_view(reinterpret_cast<const char*>(bytes.data() + strings + start), end - start);
+}
+
+std::optional<std::span<const uint8_t>> TrigramIndex::postings(uint32_t trigram, uint32_t& count) const
+{
+    size_t lo = 0;
+    size_t hi = trigramEntries;
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        auto record = trigramOffset + mid * TRIGRAM_SIZE;
+        auto key = get<uint32_t>(bytes, record);
+        if (key == trigram) {
+            count = get<uint32_t>(bytes, record + 4);
+            return bytes.subspan(postingOffset + get<uint32_t>(bytes, record + 8), get<uint32_t>(bytes, record + 12));
+        }
+        if (key < trigram) lo = mid + 1;
+        else hi = mid;
+    }
+    return std::nullopt;
+}
+
+std::vector<Result> TrigramIndex::query(std::string_view text, size_t limit, double minScore, petscii::Charset charset) const
+{
+    std::vector<uint8_t> name(text.size());
+    name.resize(petscii::fromAscii(text, name, charset));
+    auto grams = trigrams(name);
+
+    std::unordered_map<uint32_t, uint32_t> shared;
+    for (auto gram : grams) {
+        uint32_t count = 0;
+        auto list = postings(gram, count);
+        if (!list.has_value()) continue;
+
+        // a number longer than 32 bits means a corrupt list, none of it is counted
+        std::vector<uint32_t> ids;
+        uint32_t id = 0;
+        uint32_t value = 0;
+        int shift = 0;
+        for (auto b : list.value()) {
+            if (shift >= 32) break;
+            value |= static_cast<uint32_t>(b & 0x7F) << shift;
+            shift += 7;
+            if (b & 0x80) continue;
+            id += value;
+            if (id < documents) ids.push_back(id);
+            value = 0;
+            shift = 0;
+        }
+        if (shift >= 32) continue;
+        for (auto document : ids) ++shared[document];
+    }
+
+    struct Scored {
+        uint32_t id;
+        double score;
+    };
+    std::vector<Scored> scored;
+    for (const auto& [id, count] : shared) {
+        auto record = documentOffset + static_cast<uint64_t>(id) * DOCUMENT_SIZE;
+        auto documentGrams = bytes[record + 5];
+        // a document can not share more trigrams than it has, a count that says so would break the score
+        if (count > documentGrams || count > grams.size()) continue;
+        auto score = static_cast<double>(count) / (grams.size() + documentGrams - count);
+        if (score >= minScore) scored.push_back({ id, score });
+    }
+    auto best = std::min(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + best, scored.end(), [](const Scored& a, const Scored& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.id < b.id;
+    });
+
+    std::vector<Result> results;
+    for (size_t i = 0; i < best; ++i) {
+        auto record = documentOffset + static_cast<uint64_t>(scored[i].id) * DOCUMENT_SIZE;
+        Result result;
+        result.image = image(get<uint32_t>(bytes, record));
+        result.kind = static_cast<Kind>(bytes[record + 4]);
+        result.name = petscii_name::fromRaw(reinterpret_cast<const char*>(bytes.data() + record + 8));
+        result.score = scored[i].score;
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+} // namespace d64lib::trigram
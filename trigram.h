@@ -0,0 +1,159 @@
+#pragma once
+
+#include "bloom.h"
+#include "d64.h"
+#include "petscii.h"
+#include "petscii_name.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace d64lib::trigram {
+
+enum class Kind : uint8_t {
+    File = 0,
+    Disk = 1
+};
+
+/// <summary>
+/// Get the trigrams of a name
+/// letters are folded to one case and the name is padded with spaces so short names
+/// and the start of a name still produce trigrams
+/// </summary>
+/// <param name="name">PETSCII name</param>
+/// <returns>sorted distinct trigrams, three bytes packed into each value</returns>
+std::vector<uint32_t> trigrams(std::span<const uint8_t> name);
+
+/// <summary>
+/// Collects file and disk names and writes them as a trigram index
+/// </summary>
+class TrigramIndexBuilder {
+public:
+    /// <summary>
+    /// Add one name
+    /// </summary>
+    /// <param name="image">name of the image the name belongs to</param>
+    /// <param name="kind">file name or disk name</param>
+    /// <param name="name">PETSCII name</param>
+    void add(const std::string& image, Kind kind, const petscii_name& name);
+
+    /// <summary>
+    /// Add the disk name and file names of a disk
+    /// </summary>
+    /// <param name="image">name of the image</param>
+    /// <param name="disk">d64 disk instance</param>
+    void addDisk(const std::string& image, d64& disk);
+
+    /// <summary>
+    /// Read the directories of many images in parallel and add their names
+    /// </summary>
+    /// <param name="images">paths of .d64 files</param>
+    /// <param name="threads">number of worker threads, 0 for one per core</param>
+    /// <returns>number of images that were added</returns>
+    size_t addImages(const std::vector<std::string>& images, unsigned threads = 0);
+
+    size_t size() const { return documents.size(); }
+
+    /// <summary>
+    /// Bloom filters of the file names of each image, built while the names are added
+    /// </summary>
+    const bloom::FilterSet& filters() const { return nameFilters; }
+
+    /// <summary>
+    /// Write the index
+    /// posting lists are delta encoded as LEB128 and all tables have fixed size records
+    /// so the index can be used straight from a memory mapped file
+    /// </summary>
+    /// <returns>bytes of the index</returns>
+    std::vector<uint8_t> build() const;
+
+    /// <summary>
+    /// Write the index to a file
+    /// </summary>
+    /// <param name="filename">file to write</param>
+    /// <returns>true if successful</returns>
+    bool save(const std::string& filename) const;
+
+private:
+    struct Document {
+        uint32_t image;
+        Kind kind;
+        petscii_name name;
+    };
+
+    uint32_t imageId(const std::string& image);
+
+    std::vector<std::string> images;
+    std::vector<Document> documents;
+    bloom::FilterSet nameFilters;
+};
+
+struct Result {
+    std::string image;
+    Kind kind = Kind::File;
+    petscii_name name;
+    double score = 0.0;         // Jaccard similarity of the trigram sets
+};
+
+/// <summary>
+/// Read only view of an index written by TrigramIndexBuilder
+/// </summary>
+class TrigramIndex {
+public:
+    /// <summary>
+    /// Use index bytes that stay alive elsewhere
+    /// throws std::invalid_argument if the bytes are not an index
+    /// </summary>
+    /// <param name="bytes">bytes of the index</param>
+    explicit TrigramIndex(std::span<const uint8_t> bytes);
+
+    /// <summary>
+    /// Take ownership of index bytes
+    /// throws std::invalid_argument if the bytes are not an index
+    /// </summary>
+    /// <param name="bytes">bytes of the index</param>
+    explicit TrigramIndex(std::vector<uint8_t> bytes);
+
+    /// <summary>
+    /// Memory map an index file
+    /// </summary>
+    /// <param name="filename">file to open</param>
+    /// <returns>index or nullopt if the file could not be mapped or is not an index</returns>
+    static std::optional<TrigramIndex> open(const std::string& filename);
+
+    /// <summary>
+    /// Find names like the query
+    /// </summary>
+    /// <param name="text">query as ASCII</param>
+    /// <param name="limit">most results to return</param>
+    /// <param name="minScore">lowest score to return</param>
+    /// <param name="charset">character set used to turn the query into PETSCII</param>
+    /// <returns>results, best first</returns>
+    std::vector<Result> query(std::string_view text, size_t limit = 20, double minScore = 0.3, petscii::Charset charset = petscii::Charset::Uppercase) const;
+
+    size_t documentCount() const { return documents; }
+    size_t trigramCount() const { return trigramEntries; }
+    size_t imageCount() const { return imageEntries; }
+
+private:
+    TrigramIndex(std::shared_ptr<const void> owner, std::span<const uint8_t> bytes);
+    void parse();
+    std::string_view image(uint32_t id) const;
+    std::optional<std::span<const uint8_t>> postings(uint32_t trigram, uint32_t& count) const;
+
+    std::shared_ptr<const void> owner;
+    std::span<const uint8_t> bytes;
+    uint32_t imageEntries = 0;
+    uint32_t documents = 0;
+    uint32_t trigramEntries = 0;
+    uint64_t imageOffset = 0;
+    uint64_t documentOffset = 0;
+    uint64_t trigramOffset = 0;
+    uint64_t postingOffset = 0;
+};
+
+} // namespace d64lib::trigram
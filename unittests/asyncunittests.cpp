@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../async.h"
+#include "testdata.h"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace d64lib;
+
+namespace {
+
+    // starts running at once and reports through a std::promise, enough to drive the awaitables
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    // runs work on the calling thread and counts it
+    class InlineScheduler : public async::Scheduler {
+    public:
+        void post(std::function<void()> work) override
+        {
+            ++posted;
+            work();
+        }
+
+        std::atomic<int> posted = 0;
+    };
+
+    Detached roundTrip(std::string image, std::promise<std::vector<uint8_t>>& done)
+    {
+        try {
+            auto disk = co_await async::open(image);
+            disk.addFile("ADDED", d64FileTypes::PRG, fileData(900, 0x5A));
+            if (!co_await async::save(disk, image)) throw std::runtime_error("save failed");
+
+            auto reopened = co_await async::open(image);
+            if (!co_await async::verify(reopened)) throw std::runtime_error("BAM mismatch");
+            auto bytes = co_await async::readFile(reopened, "ADDED");
+            done.set_value(bytes.value_or(std::vector<uint8_t>()));
+        }
+        catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    }
+
+    TEST(async_unit_test, round_trip_test) {
+        d64 disk;
+        disk.addFile("FIRST", d64FileTypes::PRG, fileData(300, 1));
+        ASSERT_TRUE(disk.save("async_1.d64"));
+
+        std::promise<std::vector<uint8_t>> done;
+        roundTrip("async_1.d64", done);
+        EXPECT_EQ(done.get_future().get(), fileData(900, 0x5A));
+
+        std::remove("async_1.d64");
+    }
+
+    Detached openMissing(std::promise<bool>& done)
+    {
+        try {
+            co_await async::open("missing.d64");
+            done.set_value(false);
+        }
+        catch (const std::invalid_argument&) {
+            done.set_value(true);
+        }
+    }
+
+    TEST(async_unit_test, error_test) {
+        std::promise<bool> done;
+        openMissing(done);
+        EXPECT_TRUE(done.get_future().get());
+    }
+
+    Detached extractOn(async::Scheduler& io, async::Scheduler& workers, std::promise<std::pair<bool, bool>>& done)
+    {
+        d64 disk;
+        disk.addFile("ASYNCOUT", d64FileTypes::SEQ, fileData(200, 7));
+        auto extracted = co_await async::extract(disk, "ASYNCOUT", io);
+
+        // the CPU heavy part moves to the worker pool
+        auto caller = std::this_thread::get_id();
+        co_await async::on{ workers };
+        auto moved = std::this_thread::get_id() != caller;
+        auto intact = disk.verifyBAMIntegrity(false, "");
+        done.set_value({ extracted && intact, moved });
+    }
+
+    TEST(async_unit_test, scheduler_test) {
+        InlineScheduler io;
+        async::ThreadPool workers(2);
+        std::promise<std::pair<bool, bool>> done;
+        extractOn(io, workers, done);
+
+        auto [ok, moved] = done.get_future().get();
+        EXPECT_TRUE(ok);
+        EXPECT_TRUE(moved);
+        EXPECT_EQ(io.posted, 1);
+        EXPECT_TRUE(std::filesystem::exists("ASYNCOUT.seq"));
+        std::remove("ASYNCOUT.seq");
+    }
+}
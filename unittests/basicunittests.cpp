@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../basic.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+using namespace d64lib;
+using namespace d64lib::basic;
+
+namespace {
+
+    // 10 PRINT "HELLO" : 20 FORK=1TO10 ... 60 END
+    const std::vector<uint8_t> prog = {
+        0x01, 0x08, 0x0f, 0x08, 0x0a, 0x00, 0x99, 0x20, 0x22, 0x48, 0x45, 0x4c, 0x4c, 0x4f, 0x22, 0x00,
+        0x1b, 0x08, 0x14, 0x00, 0x81, 0x4b, 0xb2, 0x31, 0xa4, 0x31, 0x30, 0x00, 0x27, 0x08, 0x1e, 0x00,
+        0x81, 0x4c, 0xb2, 0x4b, 0xa4, 0x31, 0x31, 0x00, 0x31, 0x08, 0x28, 0x00, 0x99, 0x20, 0x4b, 0x2c,
+        0x4c, 0x00, 0x39, 0x08, 0x32, 0x00, 0x82, 0x3a, 0x82, 0x00, 0x3f, 0x08, 0x3c, 0x00, 0x80, 0x00,
+        0x00, 0x00
+    };
+
+    const std::vector<std::string> listing = {
+        "10 PRINT \"HELLO\"",
+        "20 FORK=1TO10",
+        "30 FORL=KTO11",
+        "40 PRINT K,L",
+        "50 NEXT:NEXT",
+        "60 END"
+    };
+
+    // a long program so lines cross sector boundaries
+    std::vector<uint8_t> makeLongProgram(int lines)
+    {
+        std::vector<uint8_t> program = { 0x01, 0x08 };
+        uint16_t address = BASIC_START;
+        for (auto i = 0; i < lines; ++i) {
+            std::vector<uint8_t> text = { 0x99, ' ', '"' };
+            for (auto j = 0; j < 30; ++j) text.push_back(static_cast<uint8_t>('A' + j % 26));
+            text.push_back('"');
+            text.push_back(0x00);
+            address += static_cast<uint16_t>(4 + text.size());
+            program.push_back(address & 0xFF);
+            program.push_back(address >> 8);
+            program.push_back(static_cast<uint8_t>(i & 0xFF));
+            program.push_back(static_cast<uint8_t>(i >> 8));
+            program.insert(program.end(), text.begin(), text.end());
+        }
+        program.push_back(0x00);
+        program.push_back(0x00);
+        return program;
+    }
+
+    TEST(basic_unit_test, keyword_test) {
+        static_assert(keyword(0x99).value() == "PRINT");
+        static_assert(keyword(0x80).value() == "END");
+        static_assert(keyword(0xCB).value() == "GO");
+        static_assert(!keyword(0xCC).has_value());
+        static_assert(!keyword('A').has_value());
+    }
+
+    TEST(basic_unit_test, detokenize_test) {
+        d64 disk;
+        ASSERT_TRUE(disk.addFile("HELLO", d64FileTypes::PRG, prog));
+
+        std::vector<std::string> lines;
+        EXPECT_TRUE(listProgram(disk, "HELLO", [&](std::string_view line) {
+            lines.emplace_back(line);
+            return true;
+        }));
+        EXPECT_EQ(lines, listing);
+
+        auto entry = disk.findFile("HELLO");
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_TRUE(isBasicProgram(disk, *entry.value()));
+
+        Detokenizer lower(disk, *entry.value(), petscii::Charset::Lowercase);
+        EXPECT_EQ(lower.loadAddress().value(), BASIC_START);
+        EXPECT_EQ(lower.next().value(), "10 print \"hello\"");
+    }
+
+    TEST(basic_unit_test, long_program_test) {
+        d64 disk;
+        auto program = makeLongProgram(100);
+        ASSERT_TRUE(disk.addFile("LONG", d64FileTypes::PRG, program));
+
+        auto listings = listPrograms(disk);
+        ASSERT_EQ(listings.size(), 1);
+        EXPECT_EQ(listings[0].filename, "LONG");
+        ASSERT_EQ(listings[0].lines.size(), 100);
+        EXPECT_EQ(listings[0].lines[99], "99 PRINT \"ABCDEFGHIJKLMNOPQRSTUVWXYZABCD\"");
+    }
+
+    TEST(basic_unit_test, list_corpus_test) {
+        d64 disk1;
+        disk1.addFile("HELLO", d64FileTypes::PRG, prog);
+        disk1.addFile("DATA", d64FileTypes::SEQ, prog);
+        disk1.save("basic_corpus_1.d64");
+
+        d64 disk2;
+        disk2.addFile("LONG", d64FileTypes::PRG, makeLongProgram(10));
+        disk2.addFile("HELLO2", d64FileTypes::PRG, prog);
+        disk2.save("basic_corpus_2.d64");
+
+        auto results = listCorpus({ "basic_corpus_1.d64", "basic_corpus_2.d64", "missing.d64" }, petscii::Charset::Uppercase, 2);
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_TRUE(results[0].loaded);
+        ASSERT_EQ(results[0].programs.size(), 1);
+        EXPECT_EQ(results[0].programs[0].lines, listing);
+        EXPECT_TRUE(results[1].loaded);
+        ASSERT_EQ(results[1].programs.size(), 2);
+        EXPECT_EQ(results[1].programs[0].lines.size(), 10);
+        EXPECT_EQ(results[1].programs[1].filename, "HELLO2");
+        EXPECT_FALSE(results[2].loaded);
+
+        std::remove("basic_corpus_1.d64");
+        std::remove("basic_corpus_2.d64");
+    }
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../bloom.h"
+#include "../trigram.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+using namespace d64lib;
+using namespace d64lib::bloom;
+
+namespace {
+
+    const std::vector<uint8_t> data = { 0x01, 0x08, 0x00, 0x00 };
+
+    TEST(bloom_unit_test, filter_test) {
+        NameFilter filter;
+        for (auto i = 0; i < 144; ++i) {
+            filter.add(petscii_name("FILE " + std::to_string(i)));
+        }
+        for (auto i = 0; i < 144; ++i) {
+            EXPECT_TRUE(filter.mayContain(petscii_name("FILE " + std::to_string(i))));
+        }
+
+        // a full directory should still reject most names
+        auto positives = 0;
+        for (auto i = 0; i < 1000; ++i) {
+            positives += filter.mayContain(petscii_name("OTHER " + std::to_string(i)));
+        }
+        EXPECT_LT(positives, 80);
+
+        NameFilter empty;
+        EXPECT_FALSE(empty.mayContain(petscii_name("FILE 1")));
+    }
+
+    TEST(bloom_unit_test, filter_set_test) {
+        d64 disk1;
+        disk1.addFile("PACMAN", d64FileTypes::PRG, data);
+        disk1.addFile("GALAXIAN", d64FileTypes::PRG, data);
+        disk1.save("bloom_1.d64");
+
+        d64 disk2;
+        disk2.addFile("PACMAN", d64FileTypes::PRG, data);
+        disk2.save("bloom_2.d64");
+
+        d64 disk3;
+        disk3.addFile("FROGGER", d64FileTypes::PRG, data);
+        disk3.save("bloom_3.d64");
+
+        FilterSet filters;
+        EXPECT_EQ(filters.addImages({ "bloom_1.d64", "bloom_2.d64", "bloom_3.d64", "missing.d64" }, 2), 3);
+        EXPECT_EQ(filters.size(), 3);
+        ASSERT_NE(filters.find("bloom_1.d64"), nullptr);
+        EXPECT_EQ(filters.find("missing.d64"), nullptr);
+
+        auto found = filters.locate(petscii_name("PACMAN"));
+        EXPECT_EQ(found, std::vector<std::string>({ "bloom_1.d64", "bloom_2.d64" }));
+        EXPECT_EQ(filters.locate(petscii_name("FROGGER")), std::vector<std::string>({ "bloom_3.d64" }));
+        EXPECT_TRUE(filters.locate(petscii_name("PACMA")).empty());
+
+        ASSERT_TRUE(filters.save("bloom.flt"));
+        FilterSet loaded;
+        ASSERT_TRUE(loaded.load("bloom.flt"));
+        EXPECT_EQ(loaded.size(), 3);
+        EXPECT_EQ(*loaded.find("bloom_3.d64"), *filters.find("bloom_3.d64"));
+        EXPECT_FALSE(loaded.load("bloom_1.d64"));
+
+        // the catalog scan builds the same filters on the side
+        trigram::TrigramIndexBuilder builder;
+        builder.addImages({ "bloom_1.d64", "bloom_2.d64", "bloom_3.d64" });
+        EXPECT_EQ(builder.filters().size(), 3);
+        EXPECT_EQ(*builder.filters().find("bloom_1.d64"), *filters.find("bloom_1.d64"));
+
+        std::remove("bloom_1.d64");
+        std::remove("bloom_2.d64");
+        std::remove("bloom_3.d64");
+        std::remove("bloom.flt");
+    }
+}
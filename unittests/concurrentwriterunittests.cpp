@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../concurrent_writer.h"
+#include "../parallel.h"
+#include "testdata.h"
+#include <string>
+#include <vector>
+
+using namespace d64lib;
+
+namespace {
+
+    void addInParallel(d64& disk, int files, size_t size)
+    {
+        ConcurrentWriter writer(disk);
+        parallelFor(files, 8, [&](size_t index) {
+            auto name = "FILE" + std::to_string(index);
+            ASSERT_TRUE(writer.addFile(name, d64FileTypes::PRG, fileData(size + index * 37, static_cast<uint8_t>(index))));
+        });
+    }
+
+    TEST(concurrent_writer_unit_test, parallel_add_test) {
+        constexpr int FILES = 60;
+        d64 disk;
+        addInParallel(disk, FILES, 500);
+
+        // the directory grew past its first sector and every chain is intact
+        EXPECT_EQ(disk.directory().size(), FILES);
+        for (auto index = 0; index < FILES; ++index) {
+            EXPECT_EQ(disk.readFile("FILE" + std::to_string(index)), fileData(500 + index * 37, static_cast<uint8_t>(index)));
+        }
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+    }
+
+    TEST(concurrent_writer_unit_test, d71_d81_test) {
+        for (auto type : { diskType::seventy_track, diskType::eighty_track }) {
+            d64 disk(type);
+            addInParallel(disk, 40, 3000);
+            EXPECT_EQ(disk.directory().size(), 40);
+            EXPECT_EQ(disk.readFile("FILE39"), fileData(3000 + 39 * 37, 39));
+            EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+        }
+    }
+
+    TEST(concurrent_writer_unit_test, disk_full_test) {
+        d64 disk;
+        ConcurrentWriter writer(disk);
+        auto free = disk.getFreeSectorCount();
+
+        // a file that does not fit gives back what it claimed
+        EXPECT_FALSE(writer.addFile("HUGE", d64FileTypes::PRG, fileData(700 * 254, 0)));
+        EXPECT_EQ(disk.getFreeSectorCount(), free);
+        EXPECT_TRUE(disk.directory().empty());
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        EXPECT_THROW(writer.addFile("REL", d64FileTypes::REL, fileData(100, 0)), std::invalid_argument);
+        EXPECT_THROW(writer.addFile("", d64FileTypes::PRG, fileData(100, 0)), std::runtime_error);
+    }
+
+}
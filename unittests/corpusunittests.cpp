@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../corpus.h"
+#include "testdata.h"
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace d64lib;
+
+namespace {
+
+    // images whose index is also their number of files, plus one that is not an image
+    std::vector<std::string> makeCorpus(int count)
+    {
+        std::filesystem::create_directories("corpus_set/nested");
+        std::vector<std::string> images;
+        for (auto index = 0; index < count; ++index) {
+            d64 disk(index % 2 ? diskType::forty_track : diskType::thirty_five_track);
+            for (auto file = 0; file < index; ++file) {
+                disk.addFile("FILE" + std::to_string(file), d64FileTypes::PRG, fileData(300, static_cast<uint8_t>(file)));
+            }
+            auto name = (index % 3 ? "corpus_set/" : "corpus_set/nested/") + std::to_string(index) + ".d64";
+            disk.save(name);
+            images.push_back(name);
+        }
+        std::ofstream("corpus_set/broken.D64") << "not a disk";
+        std::ofstream("corpus_set/notes.txt") << "not an image either";
+        return images;
+    }
+
+    TEST(corpus_unit_test, find_images_test) {
+        makeCorpus(6);
+        auto all = corpus::findImages("corpus_set");
+        EXPECT_EQ(all.size(), 7);
+        EXPECT_TRUE(std::is_sorted(all.begin(), all.end()));
+        EXPECT_EQ(corpus::findImages("corpus_set", false).size(), 5);
+        std::filesystem::remove_all("corpus_set");
+    }
+
+    TEST(corpus_unit_test, run_test) {
+        auto images = makeCorpus(12);
+        images.push_back("corpus_set/broken.D64");
+
+        std::set<std::string> reported;
+        corpus::Progress last;
+        corpus::Options options;
+        options.threads = 4;
+        options.maxResident = 2;
+        options.progress = [&](const corpus::Progress& progress, const std::string& image) {
+            reported.insert(image);
+            last = progress;
+        };
+        auto results = corpus::run(images, corpus::verify, options);
+
+        ASSERT_EQ(results.size(), images.size());
+        for (auto index = 0; index < 12; ++index) {
+            EXPECT_EQ(results[index].image, images[index]);
+            ASSERT_TRUE(results[index].result.has_value());
+            EXPECT_TRUE(results[index].result->intact);
+            EXPECT_EQ(results[index].result->files, index);
+        }
+        EXPECT_FALSE(results.back().result.has_value());
+        EXPECT_FALSE(results.back().error.empty());
+
+        EXPECT_EQ(reported.size(), images.size());
+        EXPECT_EQ(last.done, images.size());
+        EXPECT_EQ(last.failed, 1);
+        EXPECT_EQ(last.total, images.size());
+        std::filesystem::remove_all("corpus_set");
+    }
+
+    TEST(corpus_unit_test, operation_test) {
+        auto images = makeCorpus(5);
+
+        // a throwing operation fails only its own image
+        auto results = corpus::run(images, [](d64& disk) {
+            auto files = corpus::catalog(disk);
+            if (files.size() == 3) throw std::runtime_error("three files");
+            return files.size() ? d64::Trim(files.back().fileName) : std::string();
+        });
+        EXPECT_EQ(results[4].result, "FILE3");
+        EXPECT_FALSE(results[3].result.has_value());
+        EXPECT_EQ(results[3].error, "three files");
+        EXPECT_EQ(results[0].result, "");
+        std::filesystem::remove_all("corpus_set");
+    }
+}
@@ -61,9 +61,9 @@ namespace d64lib_unit_test
                 count = disk->getFreeSectorCount();
                 EXPECT_EQ(count, expected_free_sectors);
                 for (auto track = 1; track <= disk->TRACKS; ++track) {
-                    EXPECT_EQ(trackFreeUsage[track - 1], disk->bamtrack(track - 1)->free);
+                    EXPECT_EQ(trackFreeUsage[track - 1], disk->bamtrack(track - 1).free);
                     for (auto s = 0; s < disk->SECTORS_PER_TRACK[track - 1]; ++s) {
-                        EXPECT_NE(disk->bamtrack(track - 1)->test(s), sectorUsage[track - 1][s]);
+                        EXPECT_NE(disk->bamtrack(track - 1).test(s), sectorUsage[track - 1][s]);
                     }
                 }
 
@@ -467,6 +467,53 @@ namespace d64lib_unit_test
         d64lib_unit_test_method_cleanup(disk);
     }
 
+    TEST(d64lib_unit_test, span_sector_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk;
+        std::array<uint8_t, SECTOR_SIZE> bytes;
+        for (auto i = 0; i < SECTOR_SIZE; ++i) bytes[i] = static_cast<uint8_t>(i);
+        EXPECT_TRUE(disk.writeSector(1, 3, std::span<const uint8_t>(bytes)));
+
+        std::array<uint8_t, SECTOR_SIZE> readBack{};
+        EXPECT_TRUE(disk.readSector(1, 3, readBack));
+        EXPECT_EQ(bytes, readBack);
+        EXPECT_FALSE(disk.readSector(36, 0, readBack));
+        EXPECT_FALSE(disk.readSector(1, 0, std::span<uint8_t>(readBack).first(10)));
+
+        EXPECT_TRUE(disk.writeByte(1, 3, 5, 0xEE));
+        EXPECT_EQ(disk.readByte(1, 3, 5).value(), 0xEE);
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, track_read_write_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk;
+        EXPECT_EQ(disk.trackSize(1), 21 * SECTOR_SIZE);
+        EXPECT_EQ(disk.trackSize(35), 17 * SECTOR_SIZE);
+        EXPECT_EQ(disk.trackSize(36), 0);
+
+        std::vector<uint8_t> track(disk.trackSize(20));
+        for (size_t i = 0; i < track.size(); ++i) track[i] = static_cast<uint8_t>(i * 7);
+        EXPECT_TRUE(disk.writeTrack(20, track));
+
+        std::vector<uint8_t> readBack(disk.trackSize(20));
+        EXPECT_TRUE(disk.readTrack(20, readBack));
+        EXPECT_EQ(track, readBack);
+
+        auto sector = disk.readSector(20, 2);
+        ASSERT_TRUE(sector.has_value());
+        EXPECT_TRUE(std::equal(sector->begin(), sector->end(), track.begin() + 2 * SECTOR_SIZE));
+
+        EXPECT_FALSE(disk.writeTrack(20, std::span<const uint8_t>(track).first(SECTOR_SIZE)));
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
     TEST(d64lib_unit_test, freeSector_test)
     {
         d64lib_unit_test_method_initialize();
@@ -628,6 +675,87 @@ namespace d64lib_unit_test
         d64lib_unit_test_method_cleanup(disk);
     }
     
+    TEST(d64lib_unit_test, pmr_result_test)
+    {
+        d64lib_unit_test_method_initialize();
+        constexpr int RECORD_SIZE = 32;
+
+        d64 disk;
+        std::vector<uint8_t> fileData(600);
+        for (size_t i = 0; i < fileData.size(); ++i) fileData[i] = static_cast<uint8_t>(i);
+        ASSERT_TRUE(disk.addFile("PMRFILE", d64FileTypes::PRG, fileData));
+
+        std::vector<uint8_t> relData(RECORD_SIZE * 4, 0x11);
+        ASSERT_TRUE(disk.addFile("PMRREL", d64FileTypes::REL, relData, RECORD_SIZE));
+
+        // every allocation must come out of the arena
+        std::array<std::byte, 16384> buffer;
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+        auto file = disk.readFile("PMRFILE", &arena);
+        ASSERT_TRUE(file.has_value());
+        EXPECT_TRUE(std::equal(file->begin(), file->end(), fileData.begin(), fileData.end()));
+        EXPECT_EQ(file->get_allocator().resource(), &arena);
+
+        auto dir = disk.directory(&arena);
+        EXPECT_EQ(dir.size(), 2);
+        EXPECT_TRUE(std::equal(dir.begin(), dir.end(), disk.directory().begin()));
+
+        auto record = disk.readRecord("PMRREL", 2, &arena);
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(record->size(), RECORD_SIZE);
+        EXPECT_EQ((*record)[0], 0x11);
+        EXPECT_FALSE(disk.readRecord("PMRREL", 10, &arena).has_value());
+
+        auto entry = disk.findFile("PMRREL");
+        ASSERT_TRUE(entry.has_value());
+        auto chain = disk.parseSideSectors(entry.value()->side.track, entry.value()->side.sector, &arena);
+        EXPECT_EQ(chain.size(), 1);
+        EXPECT_EQ(chain[0], entry.value()->start);
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, petscii_name_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        constexpr petscii_name literal("HELLO");
+        static_assert(literal.size() == 5);
+        static_assert(literal.padded()[5] == static_cast<char>(A0_VALUE));
+        static_assert(literal == petscii_name("HELLO\xA0JUNK"));
+        static_assert(petscii_name("0123456789ABCDEFGHIJ").view() == "0123456789ABCDEF");
+        static_assert(petscii_name().empty());
+
+        EXPECT_EQ(literal, petscii_name(std::string("HELLO")));
+        EXPECT_FALSE(literal == petscii_name("HELLO2"));
+        EXPECT_EQ(literal.hash(), petscii_name("HELLO").hash());
+        EXPECT_NE(literal.hash(), petscii_name("HELLP").hash());
+        EXPECT_EQ(std::hash<petscii_name>{}(literal), literal.hash());
+
+        d64 disk;
+        std::vector<uint8_t> fileData = { 0x01, 0x08, 0x00 };
+        ASSERT_TRUE(disk.addFile("HELLO", d64FileTypes::PRG, fileData));
+
+        auto entry = disk.findFile(literal);
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry, disk.findFile("HELLO"));
+        EXPECT_FALSE(disk.findFile("HELLO WORLD AND MORE").has_value());
+
+        // trailing bytes after the first A0 are ignored like findFile always did
+        entry.value()->fileName[10] = 'X';
+        EXPECT_TRUE(disk.findFile(literal).has_value());
+
+        EXPECT_TRUE(disk.renameFile(literal, petscii_name("WORLD")));
+        EXPECT_FALSE(disk.findFile(literal).has_value());
+        EXPECT_EQ(d64::Trim(disk.findFile("WORLD").value()->fileName), "WORLD");
+
+        EXPECT_TRUE(disk.rename_disk(petscii_name("MY DISK")));
+        EXPECT_EQ(disk.diskname(), "MY DISK");
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
     TEST(d64lib_unit_test, relfile_extended_read_write_test)
     {
         d64lib_unit_test_method_initialize();
@@ -750,4 +878,217 @@ namespace d64lib_unit_test
         d64lib_unit_test_method_cleanup(disk);
     }
 
+    TEST(d64lib_unit_test, d71_format_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk(diskType::seventy_track);
+        EXPECT_EQ(disk.TRACKS, TRACKS_70);
+        EXPECT_EQ(disk.getFreeSectorCount(), 1328);
+        EXPECT_EQ(disk.sectorCount(36), 21);
+        EXPECT_EQ(disk.sectorCount(70), 17);
+        EXPECT_EQ(disk.bamtrack(D71_BAM_TRACK - 1).free, 0);
+
+        std::array<uint8_t, SECTOR_SIZE> bamSector;
+        disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, bamSector);
+        EXPECT_EQ(bamSector[3], D71_DOUBLE_SIDED);
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, d71_second_side_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        // more than one side holds, so the file continues on the second side
+        d64 disk(diskType::seventy_track);
+        std::vector<uint8_t> fileData(800 * 254);
+        for (size_t i = 0; i < fileData.size(); ++i) {
+            fileData[i] = static_cast<uint8_t>(i * 7);
+        }
+        ASSERT_TRUE(disk.addFile("BIGFILE", d64FileTypes::PRG, fileData));
+        EXPECT_LT(disk.bamtrack(D71_BAM_TRACK - 2).free, disk.sectorCount(D71_BAM_TRACK - 1));
+        EXPECT_EQ(disk.bamtrack(D71_BAM_TRACK - 1).free, 0);
+
+        constexpr int RECORD_SIZE = 64;
+        std::vector<uint8_t> records(RECORD_SIZE * 10);
+        for (size_t i = 0; i < records.size(); ++i) {
+            records[i] = static_cast<uint8_t>(i / RECORD_SIZE);
+        }
+        ASSERT_TRUE(disk.addFile("RELFILE", d64FileTypes::REL, records, RECORD_SIZE));
+
+        auto readBack = disk.readFile("BIGFILE");
+        ASSERT_TRUE(readBack.has_value());
+        EXPECT_EQ(readBack.value(), fileData);
+        auto record = disk.readRecord("RELFILE", 4);
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(record.value()[0], 3);
+
+        ASSERT_TRUE(disk.save("d71_second_side_test.d71"));
+        d64 loaded;
+        ASSERT_TRUE(loaded.load("d71_second_side_test.d71"));
+        EXPECT_EQ(loaded.TRACKS, TRACKS_70);
+        EXPECT_EQ(loaded.getFreeSectorCount(), disk.getFreeSectorCount());
+        EXPECT_TRUE(loaded.verifyBAMIntegrity(false, ""));
+        auto loadedFile = loaded.readFile("BIGFILE");
+        ASSERT_TRUE(loadedFile.has_value());
+        EXPECT_EQ(loadedFile.value(), fileData);
+    }
+
+    TEST(d64lib_unit_test, d81_format_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk(diskType::eighty_track);
+        EXPECT_EQ(disk.TRACKS, TRACKS_80);
+        EXPECT_EQ(disk.sectorCount(80), D81_TRACK_SECTORS);
+        EXPECT_EQ(disk.getFreeSectorCount(), 3160);
+        EXPECT_EQ(disk.diskname(), "NEW DISK");
+
+        std::array<uint8_t, SECTOR_SIZE> header;
+        disk.readSector(D81_DIRECTORY_TRACK, BAM_SECTOR, header);
+        EXPECT_EQ(header[0], D81_DIRECTORY_TRACK);
+        EXPECT_EQ(header[1], D81_DIRECTORY_SECTOR);
+        EXPECT_EQ(header[2], D81_DOS_VERSION);
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        disk.rename_disk("SIDE A");
+        EXPECT_EQ(disk.diskname(), "SIDE A");
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, d81_super_side_sector_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        // more than six side sectors, so the records span two groups
+        constexpr int RECORD_SIZE = 100;
+        constexpr int RECORDS = 2100;
+        d64 disk(diskType::eighty_track);
+        std::vector<uint8_t> records(RECORD_SIZE * RECORDS);
+        for (auto r = 0; r < RECORDS; ++r) {
+            records[r * RECORD_SIZE] = static_cast<uint8_t>(r);
+            records[r * RECORD_SIZE + 1] = static_cast<uint8_t>(r >> 8);
+        }
+        ASSERT_TRUE(disk.addFile("DATABASE", d64FileTypes::REL, records, RECORD_SIZE));
+        EXPECT_EQ(disk.getRecordCount("DATABASE"), RECORDS);
+
+        auto entry = disk.findFile("DATABASE");
+        ASSERT_TRUE(entry.has_value());
+        auto super = disk.readSector(entry.value()->side.track, entry.value()->side.sector);
+        ASSERT_TRUE(super.has_value());
+        EXPECT_EQ(super.value()[2], SUPER_SIDE_SECTOR_ID);
+        EXPECT_NE(super.value()[5], 0);     // second group
+
+        for (auto r : { 1, 900, 1500, RECORDS }) {
+            auto record = disk.readRecord("DATABASE", r);
+            ASSERT_TRUE(record.has_value());
+            EXPECT_EQ(record.value()[0] | (record.value()[1] << 8), r - 1);
+        }
+        EXPECT_FALSE(disk.readRecord("DATABASE", RECORDS + 1).has_value());
+        EXPECT_EQ(disk.parseSideSectors(entry.value()->side.track, entry.value()->side.sector).size(),
+            static_cast<size_t>(entry.value()->fileSize[0] | (entry.value()->fileSize[1] << 8)));
+
+        // growing the file past the last side sector adds to the group
+        std::vector<uint8_t> record(RECORD_SIZE, 0x5A);
+        ASSERT_TRUE(disk.writeRecord("DATABASE", 3000, record));
+        auto readBack = disk.readRecord("DATABASE", 3000);
+        ASSERT_TRUE(readBack.has_value());
+        EXPECT_EQ(readBack.value(), record);
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        ASSERT_TRUE(disk.save("d81_super_side_sector_test.d81"));
+        d64 loaded;
+        ASSERT_TRUE(loaded.load("d81_super_side_sector_test.d81"));
+        EXPECT_EQ(loaded.TRACKS, TRACKS_80);
+        auto loadedRecord = loaded.readRecord("DATABASE", 1500);
+        ASSERT_TRUE(loadedRecord.has_value());
+        EXPECT_EQ(loadedRecord.value()[0] | (loadedRecord.value()[1] << 8), 1499);
+    }
+
+    TEST(d64lib_unit_test, d81_partition_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk(diskType::eighty_track);
+        auto free = disk.getFreeSectorCount();
+        ASSERT_TRUE(disk.createPartition("GAMES", 1, 5));
+        EXPECT_EQ(disk.getFreeSectorCount(), free - 5 * D81_TRACK_SECTORS);
+        EXPECT_FALSE(disk.createPartition("MORE", 3, 3));
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        ASSERT_TRUE(disk.openPartition("GAMES"));
+        EXPECT_EQ(disk.diskname(), "GAMES");
+        EXPECT_EQ(disk.getFreeSectorCount(), 4 * D81_TRACK_SECTORS);
+        auto allocatable = disk.getAllocatableSectorCount();
+        std::vector<uint8_t> fileData(50 * 254, 0x42);
+        ASSERT_TRUE(disk.addFile("INSIDE", d64FileTypes::PRG, fileData));
+        EXPECT_EQ(disk.getAllocatableSectorCount(), allocatable - 50);
+        auto readBack = disk.readFile("INSIDE");
+        ASSERT_TRUE(readBack.has_value());
+        EXPECT_EQ(readBack.value(), fileData);
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        // the partition keeps its files to itself
+        disk.openRoot();
+        EXPECT_FALSE(disk.findFile("INSIDE").has_value());
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+        ASSERT_TRUE(disk.removeFile("GAMES"));
+        EXPECT_EQ(disk.getFreeSectorCount(), free);
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, add_file_full_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        // a file that runs out of sectors half way gives them all back
+        d64 disk;
+        auto free = disk.getAllocatableSectorCount();
+        std::vector<uint8_t> huge(700 * 254, 0x11);
+        EXPECT_THROW(disk.addFile("HUGE", d64FileTypes::PRG, huge), std::runtime_error);
+        EXPECT_EQ(disk.getAllocatableSectorCount(), free);
+        EXPECT_THROW(disk.addFile("HUGE", d64FileTypes::REL, huge, 100), std::runtime_error);
+        EXPECT_EQ(disk.getAllocatableSectorCount(), free);
+        EXPECT_TRUE(disk.directory().empty());
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        // the rest of the disk still takes a file
+        std::vector<uint8_t> fits(static_cast<size_t>(free) * 254, 0x22);
+        EXPECT_TRUE(disk.addFile("FITS", d64FileTypes::PRG, fits));
+        EXPECT_EQ(disk.getAllocatableSectorCount(), 0);
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
+    TEST(d64lib_unit_test, copy_test)
+    {
+        d64lib_unit_test_method_initialize();
+
+        d64 disk;
+        std::vector<uint8_t> fileData(1000, 0x24);
+        ASSERT_TRUE(disk.addFile("ORIGINAL", d64FileTypes::PRG, fileData));
+
+        // the copy has its own image and BAM
+        d64 copy(disk);
+        ASSERT_TRUE(copy.addFile("COPY", d64FileTypes::PRG, fileData));
+        ASSERT_TRUE(copy.rename_disk("COPIED"));
+        EXPECT_FALSE(disk.findFile("COPY").has_value());
+        EXPECT_EQ(disk.diskname(), "NEW DISK");
+        EXPECT_EQ(copy.readFile("ORIGINAL"), fileData);
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+        EXPECT_TRUE(copy.verifyBAMIntegrity(false, ""));
+
+        d64 d81(diskType::eighty_track);
+        d81 = copy;
+        EXPECT_EQ(d81.diskname(), "COPIED");
+        EXPECT_EQ(d81.readFile("COPY"), fileData);
+        EXPECT_TRUE(d81.verifyBAMIntegrity(false, ""));
+
+        d64lib_unit_test_method_cleanup(disk);
+    }
+
 }
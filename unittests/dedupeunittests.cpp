@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../dedupe.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace d64lib;
+using namespace d64lib::dedupe;
+
+namespace {
+
+    std::string nameOf(const FileLocation& file)
+    {
+        std::string name(file.entry.fileName, FILE_NAME_SZ);
+        return name.substr(0, name.find('\xA0'));
+    }
+
+    TEST(dedupe_unit_test, duplicates_test) {
+        d64 disk1;
+        disk1.addFile("GAME", d64FileTypes::PRG, makeData(1000, 1));
+        disk1.addFile("NOTES", d64FileTypes::SEQ, makeData(100, 2));
+        d64 disk2;
+        disk2.addFile("GAME COPY", d64FileTypes::PRG, makeData(1000, 1));
+        disk2.addFile("NOTES", d64FileTypes::SEQ, makeData(100, 3));
+        disk2.addFile("GAME AGAIN", d64FileTypes::PRG, makeData(1000, 1));
+
+        DedupeIndex index;
+        index.addDisk("one", disk1);
+        index.addDisk("two", disk2);
+        EXPECT_EQ(index.imageCount(), 2);
+        EXPECT_EQ(index.fileCount(), 5);
+
+        auto groups = index.duplicates();
+        ASSERT_EQ(groups.size(), 1);
+        EXPECT_EQ(groups[0].size, 1000);
+        EXPECT_EQ(groups[0].blocks, 4);
+        EXPECT_EQ(groups[0].wastedBlocks, 8);
+        ASSERT_EQ(groups[0].files.size(), 3);
+        EXPECT_EQ(groups[0].files[0].image, "one");
+        EXPECT_EQ(nameOf(groups[0].files[0]), "GAME");
+        EXPECT_EQ(nameOf(groups[0].files[1]), "GAME AGAIN");
+        EXPECT_EQ(index.find(groups[0].xxh64).size(), 3);
+
+        // adding the same image again replaces its files
+        index.addDisk("two", disk1);
+        EXPECT_EQ(index.fileCount(), 4);
+        groups = index.duplicates();
+        ASSERT_EQ(groups.size(), 2);
+        EXPECT_EQ(groups[0].wastedBlocks, 4);
+        EXPECT_EQ(groups[1].wastedBlocks, 1);
+
+        EXPECT_TRUE(index.removeImage("two"));
+        EXPECT_FALSE(index.removeImage("two"));
+        EXPECT_TRUE(index.duplicates().empty());
+    }
+
+    TEST(dedupe_unit_test, incremental_test) {
+        d64 disk1;
+        disk1.addFile("GAME", d64FileTypes::PRG, makeData(600, 1));
+        disk1.save("dedupe_1.d64");
+        d64 disk2;
+        disk2.addFile("GAME", d64FileTypes::PRG, makeData(600, 1));
+        disk2.save("dedupe_2.d64");
+
+        DedupeIndex index;
+        EXPECT_EQ(index.addImages({ "dedupe_1.d64", "dedupe_2.d64", "missing.d64" }, 2), 2);
+        EXPECT_EQ(index.duplicates().size(), 1);
+
+        // nothing changed so nothing is scanned
+        EXPECT_EQ(index.addImages({ "dedupe_1.d64", "dedupe_2.d64" }), 0);
+
+        ASSERT_TRUE(index.save("dedupe_index.bin"));
+        DedupeIndex loaded;
+        ASSERT_TRUE(loaded.load("dedupe_index.bin"));
+        EXPECT_EQ(loaded.imageCount(), 2);
+        EXPECT_EQ(loaded.fileCount(), 2);
+        auto groups = loaded.duplicates();
+        ASSERT_EQ(groups.size(), 1);
+        EXPECT_EQ(groups[0].files[1].image, "dedupe_2.d64");
+        EXPECT_TRUE(groups[0].files[1].entry == index.duplicates()[0].files[1].entry);
+
+        d64 disk3;
+        disk3.addFile("GAME", d64FileTypes::PRG, makeData(600, 1));
+        disk3.save("dedupe_3.d64");
+        EXPECT_EQ(loaded.addImages({ "dedupe_1.d64", "dedupe_2.d64", "dedupe_3.d64" }), 1);
+        groups = loaded.duplicates();
+        ASSERT_EQ(groups.size(), 1);
+        EXPECT_EQ(groups[0].files.size(), 3);
+        EXPECT_EQ(groups[0].wastedBlocks, 6);
+
+        EXPECT_FALSE(loaded.load("dedupe_1.d64"));
+        EXPECT_EQ(loaded.imageCount(), 3);
+
+        // counts larger than the rest of the file are rejected before anything is allocated
+        std::ifstream in("dedupe_index.bin", std::ios::binary);
+        std::vector<char> saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        for (auto offset : { 12, 16 }) {
+            auto corrupt = saved;
+            std::memset(corrupt.data() + offset, 0xFF, 4);
+            std::ofstream("dedupe_index.bin", std::ios::binary).write(corrupt.data(), corrupt.size());
+            EXPECT_FALSE(loaded.load("dedupe_index.bin"));
+            EXPECT_EQ(loaded.imageCount(), 3);
+        }
+
+        std::remove("dedupe_1.d64");
+        std::remove("dedupe_2.d64");
+        std::remove("dedupe_3.d64");
+        std::remove("dedupe_index.bin");
+    }
+}
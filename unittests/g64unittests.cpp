@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../g64.h"
+#include "../parallel.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace d64lib;
+using namespace d64lib::g64;
+
+namespace {
+
+    std::vector<uint8_t> encode(const std::vector<uint8_t>& bytes)
+    {
+        std::vector<uint8_t> gcr(bytes.size() / 4 * 5);
+        encodeGcr(bytes, gcr);
+        return gcr;
+    }
+
+    TEST(g64_unit_test, gcr_test) {
+        EXPECT_EQ(encode({ 0x00, 0x00, 0x00, 0x00 }), std::vector<uint8_t>({ 0x52, 0x94, 0xA5, 0x29, 0x4A }));
+        EXPECT_EQ(encode({ 0xFF, 0xFF, 0xFF, 0xFF }), std::vector<uint8_t>({ 0xAD, 0x6B, 0x5A, 0xD6, 0xB5 }));
+        EXPECT_EQ(encode({ 0x07, 0x00, 0x00, 0x00 }), std::vector<uint8_t>({ 0x55, 0xD4, 0xA5, 0x29, 0x4A }));
+
+        std::vector<uint8_t> odd(3);
+        std::vector<uint8_t> gcr(5);
+        EXPECT_THROW(encodeGcr(odd, gcr), std::invalid_argument);
+
+        EXPECT_EQ(speedZone(1), 3);
+        EXPECT_EQ(speedZone(18), 2);
+        EXPECT_EQ(speedZone(30), 1);
+        EXPECT_EQ(trackLength(35), 6250);
+    }
+
+    TEST(g64_unit_test, track_test) {
+        d64 disk;
+        disk.formatDisk("GCR DISK");
+        disk.addFile("HELLO", d64FileTypes::PRG, std::vector<uint8_t>(1000, 0x42));
+
+        std::array<uint8_t, SECTOR_SIZE> bamSector;
+        disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, bamSector);
+        auto id1 = bamSector[0xA2];
+        auto id2 = bamSector[0xA3];
+
+        Exporter exporter(disk);
+        auto track = exporter.track(DIRECTORY_TRACK);
+        ASSERT_EQ(track.size(), 7142);
+        for (auto i = 0; i < SYNC_SIZE; ++i) EXPECT_EQ(track[i], 0xFF);
+
+        uint8_t checksum = static_cast<uint8_t>(0 ^ DIRECTORY_TRACK ^ id1 ^ id2);
+        auto header = encode({ HEADER_BLOCK_ID, checksum, 0, DIRECTORY_TRACK, id2, id1, 0x0F, 0x0F });
+        EXPECT_TRUE(std::equal(header.begin(), header.end(), track.begin() + SYNC_SIZE));
+
+        // the data block of sector 0 is the BAM
+        std::vector<uint8_t> block = { DATA_BLOCK_ID };
+        block.insert(block.end(), bamSector.begin(), bamSector.end());
+        uint8_t sum = 0;
+        for (auto value : bamSector) sum ^= value;
+        block.insert(block.end(), { sum, 0, 0 });
+        auto data = encode(block);
+        auto dataStart = 2 * SYNC_SIZE + HEADER_GCR_SIZE + HEADER_GAP_SIZE;
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), track.begin() + dataStart));
+
+        // tracks asked for from many threads are encoded once and stay put
+        parallelFor(TRACKS_35 * 4, 4, [&](size_t index) {
+            auto t = static_cast<int>(index % TRACKS_35) + 1;
+            EXPECT_EQ(exporter.track(t).size(), static_cast<size_t>(trackLength(t)));
+        });
+        EXPECT_EQ(exporter.track(1).data(), exporter.track(1).data());
+        EXPECT_THROW(exporter.track(36), std::invalid_argument);
+    }
+
+    TEST(g64_unit_test, image_test) {
+        d64 disk;
+        disk.save("gcr_1.d64");
+        auto results = convertBatch({ "gcr_1.d64", "missing.d64" }, ".", 2);
+        ASSERT_EQ(results.size(), 2);
+        EXPECT_TRUE(results[1].g64.empty());
+
+        std::ifstream in(results[0].g64, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        ASSERT_EQ(bytes.size(), HEADER_SIZE + HALF_TRACKS * 8 + TRACKS_35 * (2 + MAX_TRACK_SIZE));
+        EXPECT_TRUE(std::equal(std::begin(SIGNATURE), std::end(SIGNATURE), bytes.begin()));
+        EXPECT_EQ(bytes[9], HALF_TRACKS);
+
+        auto read32 = [&](size_t offset) {
+            return bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24);
+        };
+        auto track18 = static_cast<size_t>(read32(HEADER_SIZE + 34 * 4));
+        EXPECT_EQ(read32(HEADER_SIZE + 35 * 4), 0);
+        EXPECT_EQ(read32(HEADER_SIZE + HALF_TRACKS * 4 + 34 * 4), 2);
+        EXPECT_EQ(bytes[track18] | (bytes[track18 + 1] << 8), 7142);
+
+        Exporter exporter(disk);
+        auto gcr = exporter.track(DIRECTORY_TRACK);
+        EXPECT_TRUE(std::equal(gcr.begin(), gcr.end(), bytes.begin() + track18 + 2));
+
+        in.close();
+        std::remove("gcr_1.d64");
+        std::remove(results[0].g64.c_str());
+    }
+
+    std::vector<uint8_t> makeDisk(d64& disk)
+    {
+        disk.formatDisk("GCR DISK");
+        std::vector<uint8_t> data(20000);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7 + i / 300);
+        disk.addFile("DATA", d64FileTypes::PRG, data);
+        return Exporter(disk).image();
+    }
+
+    size_t trackOffset(const std::vector<uint8_t>& image, int track)
+    {
+        auto entry = HEADER_SIZE + (track - 1) * 8;
+        return image[entry] | (image[entry + 1] << 8) | (image[entry + 2] << 16);
+    }
+
+    TEST(g64_unit_test, decode_test) {
+        std::vector<uint8_t> gcr = { 0x52, 0x94, 0xA5, 0x29, 0x4A, 0x55, 0xD4, 0xA5, 0x29, 0x4A };
+        std::vector<uint8_t> bytes(8);
+        ASSERT_TRUE(decodeGcr(gcr, bytes));
+        EXPECT_EQ(bytes, std::vector<uint8_t>({ 0, 0, 0, 0, 0x07, 0, 0, 0 }));
+        gcr[0] = 0x00;
+        EXPECT_FALSE(decodeGcr(gcr, bytes));
+    }
+
+    TEST(g64_unit_test, import_test) {
+        d64 disk;
+        auto image = makeDisk(disk);
+
+        d64 copy;
+        auto result = importImage(image, copy, 4);
+        ASSERT_EQ(result.errors.size(), 683);
+        EXPECT_EQ(result.badSectors(), 0);
+        for (auto track = 1; track <= TRACKS_35; ++track) {
+            for (auto sector = 0; sector < d64::SECTORS_PER_TRACK[track - 1]; ++sector) {
+                ASSERT_EQ(copy.readSector(track, sector), disk.readSector(track, sector));
+            }
+        }
+
+        // a track that does not start on a byte boundary decodes the same
+        auto offset = trackOffset(image, 2) + 2;
+        auto length = static_cast<size_t>(trackLength(2));
+        std::vector<uint8_t> track(image.begin() + offset, image.begin() + offset + length);
+        for (size_t i = 0; i < length; ++i) {
+            image[offset + i] = static_cast<uint8_t>((track[i] >> 3) | (track[(i + length - 1) % length] << 5));
+        }
+        d64 shifted;
+        EXPECT_EQ(importImage(image, shifted).badSectors(), 0);
+        EXPECT_EQ(shifted.readSector(2, 7), disk.readSector(2, 7));
+    }
+
+    TEST(g64_unit_test, error_table_test) {
+        d64 disk;
+        auto image = makeDisk(disk);
+        auto track1 = trackOffset(image, 1) + 2;
+        auto sectorSize = static_cast<size_t>(SECTOR_GCR_SIZE + (trackLength(1) - 21 * SECTOR_GCR_SIZE) / 21);
+
+        // sector 0 gets a data block with a bad checksum
+        std::vector<uint8_t> block(SECTOR_SIZE + 4, 0);
+        block[0] = DATA_BLOCK_ID;
+        block[SECTOR_SIZE + 1] = 0x55;
+        std::vector<uint8_t> gcr(DATA_GCR_SIZE);
+        encodeGcr(block, gcr);
+        auto dataStart = 2 * SYNC_SIZE + HEADER_GCR_SIZE + HEADER_GAP_SIZE;
+        std::copy(gcr.begin(), gcr.end(), image.begin() + track1 + dataStart);
+
+        // sector 1 loses its header and sector 2 its header checksum
+        std::fill_n(image.begin() + track1 + sectorSize + SYNC_SIZE, HEADER_GCR_SIZE, 0x52);
+        std::vector<uint8_t> header = { HEADER_BLOCK_ID, 0, 2, 1, 0, 0, 0x0F, 0x0F };
+        encodeGcr(header, std::span<uint8_t>(image).subspan(track1 + 2 * sectorSize + SYNC_SIZE, HEADER_GCR_SIZE));
+
+        // track 3 is missing
+        std::fill_n(image.begin() + HEADER_SIZE + 4 * 4, 4, 0);
+
+        d64 copy;
+        auto result = importImage(image, copy);
+        EXPECT_EQ(result.errors[0], DATA_CHECKSUM_ERROR);
+        EXPECT_EQ(result.errors[1], HEADER_NOT_FOUND);
+        EXPECT_EQ(result.errors[2], HEADER_CHECKSUM_ERROR);
+        EXPECT_EQ(result.errors[3], SECTOR_OK);
+        EXPECT_EQ(result.errors[42], NO_SYNC);
+        EXPECT_EQ(result.badSectors(), 3 + 21);
+
+        std::vector<uint8_t> bad(10, 0);
+        EXPECT_THROW(importImage(bad, copy), std::invalid_argument);
+
+        {
+            std::ofstream out("gcr_bad.g64", std::ios::binary);
+            out.write(reinterpret_cast<const char*>(image.data()), image.size());
+        }
+        auto results = importBatch({ "gcr_bad.g64", "missing.g64" }, ".", 2);
+        ASSERT_EQ(results.size(), 2);
+        EXPECT_EQ(results[0].badSectors, 24);
+        EXPECT_TRUE(results[1].image.empty());
+        EXPECT_EQ(std::filesystem::file_size(results[0].image), D64_DISK35_SZ + 683);
+
+        std::remove("gcr_bad.g64");
+        std::remove(results[0].image.c_str());
+    }
+}
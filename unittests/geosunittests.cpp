@@ -43,6 +43,10 @@ namespace {
         d64 disk2;
         disk2.formatDisk("NORMALDISK");
         EXPECT_FALSE(isGeosDisk(disk2));
+
+        d64 d81(diskType::eighty_track);
+        EXPECT_THROW(formatGeosDisk(d81, "GEOSDISK"), std::invalid_argument);
+        EXPECT_FALSE(isGeosDisk(d81));
         
         d64lib_unit_test_method_cleanup(disk);
     }
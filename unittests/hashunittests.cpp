@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../hash.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+
+using namespace d64lib;
+using namespace d64lib::hash;
+
+namespace {
+
+    std::span<const uint8_t> bytesOf(std::string_view text)
+    {
+        return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+
+    TEST(hash_unit_test, xxh64_test) {
+        EXPECT_EQ(xxh64(bytesOf("")), 0xEF46DB3751D8E999ull);
+        EXPECT_EQ(xxh64(bytesOf("abc")), 0x44BC2CF5AD770999ull);
+        EXPECT_EQ(xxh64(bytesOf("abc"), 1), 0xBEA9CA8199328908ull);
+        EXPECT_EQ(xxh64(bytesOf("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxy")), 0x0FE5F6A5AB8054BEull);
+
+        auto data = makeData(768);
+        EXPECT_EQ(xxh64(data), 0x8E03C838C596036Full);
+
+        // feeding in odd pieces gives the same digest
+        Xxh64 hasher;
+        std::span<const uint8_t> rest(data);
+        for (size_t step = 1; !rest.empty(); step += 7) {
+            auto take = std::min(step, rest.size());
+            hasher.update(rest.first(take));
+            rest = rest.subspan(take);
+        }
+        EXPECT_EQ(hasher.digest(), 0x8E03C838C596036Full);
+    }
+
+    TEST(hash_unit_test, sha_test) {
+        Sha1 sha1;
+        sha1.update(bytesOf("abc"));
+        EXPECT_EQ(toHex(sha1.digest()), "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+        Sha256 sha256;
+        sha256.update(bytesOf("abc"));
+        EXPECT_EQ(toHex(sha256.digest()), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+        auto data = makeData(768);
+        Sha1 longSha1;
+        Sha256 longSha256;
+        for (size_t offset = 0; offset < data.size(); offset += 254) {
+            auto piece = std::span<const uint8_t>(data).subspan(offset, std::min<size_t>(254, data.size() - offset));
+            longSha1.update(piece);
+            longSha256.update(piece);
+        }
+        EXPECT_EQ(toHex(longSha1.digest()), "ac2a264c8ec1f4232a40854e8239bc3a697ab1d2");
+        EXPECT_EQ(toHex(longSha256.digest()), "f3a25aa93aa2fbba28d79260535bbd6a5eb0fc1c24a8b0f04e12b484c1dfe363");
+    }
+
+    TEST(hash_unit_test, fingerprint_test) {
+        d64 disk;
+        auto data = makeData(768);
+        ASSERT_TRUE(disk.addFile("ONE", d64FileTypes::PRG, data));
+        ASSERT_TRUE(disk.addFile("TWO", d64FileTypes::SEQ, data));
+        ASSERT_TRUE(disk.addFile("THREE", d64FileTypes::PRG, makeData(100)));
+
+        auto one = fingerprint(disk, "ONE", XXH64 | SHA1 | SHA256);
+        ASSERT_TRUE(one.has_value());
+        EXPECT_EQ(one->xxh64, 0x8E03C838C596036Full);
+        EXPECT_EQ(toHex(one->sha1.value()), "ac2a264c8ec1f4232a40854e8239bc3a697ab1d2");
+        EXPECT_EQ(one->size, 768);
+        EXPECT_EQ(one->blocks, 4);
+
+        auto two = fingerprint(disk, "TWO", XXH64 | SHA1 | SHA256);
+        EXPECT_EQ(one, two);
+        EXPECT_NE(fingerprint(disk, "THREE"), fingerprint(disk, "ONE"));
+        EXPECT_FALSE(fingerprint(disk, "MISSING").has_value());
+
+        auto all = fingerprintAll(disk);
+        ASSERT_EQ(all.size(), 3);
+        EXPECT_EQ(all[2].fingerprint.size, 100);
+        EXPECT_FALSE(all[0].fingerprint.sha1.has_value());
+    }
+
+    TEST(hash_unit_test, cache_test) {
+        d64 disk;
+        ASSERT_TRUE(disk.addFile("ONE", d64FileTypes::PRG, makeData(300)));
+        ASSERT_TRUE(disk.addFile("TWO", d64FileTypes::PRG, makeData(50)));
+
+        FingerprintCache cache;
+        cache.getAll(disk);
+        EXPECT_EQ(cache.misses(), 2);
+        EXPECT_EQ(cache.hits(), 0);
+
+        cache.getAll(disk);
+        EXPECT_EQ(cache.misses(), 2);
+        EXPECT_EQ(cache.hits(), 2);
+
+        // asking for an algorithm that was not computed hashes again
+        auto entry = disk.findFile("ONE");
+        ASSERT_TRUE(entry.has_value());
+        auto fp = cache.get(disk, *entry.value(), SHA256);
+        EXPECT_TRUE(fp.sha256.has_value());
+        EXPECT_EQ(cache.misses(), 3);
+
+        ASSERT_TRUE(disk.removeFile("TWO"));
+        ASSERT_TRUE(disk.addFile("THREE", d64FileTypes::PRG, makeData(600)));
+        auto all = cache.getAll(disk);
+        ASSERT_EQ(all.size(), 2);
+        EXPECT_EQ(cache.size(), 2);
+        EXPECT_EQ(cache.misses(), 4);
+        EXPECT_EQ(all[1].fingerprint.size, 600);
+
+        cache.clear();
+        EXPECT_EQ(cache.size(), 0);
+        EXPECT_EQ(cache.hits(), 0);
+    }
+}
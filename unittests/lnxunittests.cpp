@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../lnx.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+using namespace d64lib;
+using namespace d64lib::lnx;
+
+namespace {
+
+    struct Member {
+        std::string name;
+        char type;
+        std::vector<uint8_t> data;
+        uint8_t recordSize = 0;
+    };
+
+    void append(std::vector<uint8_t>& bytes, const std::string& text)
+    {
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        bytes.push_back(0x0D);
+    }
+
+    std::vector<uint8_t> makeLynx(const std::vector<Member>& members, bool truncateLast = true)
+    {
+        // 10 SYS 2061
+        std::vector<uint8_t> lynx = { 0x01, 0x08, 0x0B, 0x08, 0x0A, 0x00, 0x9E, '2', '0', '6', '1', 0x00, 0x00, 0x00, 0x0D };
+        append(lynx, " 1  *LYNX XII  BY WILL CORLEY");
+        append(lynx, " " + std::to_string(members.size()) + " ");
+
+        std::vector<uint8_t> body;
+        for (const auto& member : members) {
+            auto dataBlocks = std::max<size_t>(1, (member.data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+            auto side = member.type == 'R' ? (dataBlocks + SIDE_SECTOR_CHAIN_SZ - 1) / SIDE_SECTOR_CHAIN_SZ : 0;
+            auto last = member.data.size() - (dataBlocks - 1) * BLOCK_SIZE;
+
+            auto name = member.name;
+            name.resize(FILE_NAME_SZ, static_cast<char>(0xA0));
+            append(lynx, name);
+            append(lynx, " " + std::to_string(dataBlocks + side) + " ");
+            append(lynx, std::string(1, member.type));
+            append(lynx, " " + std::to_string(last + 1) + " ");
+            if (member.type == 'R') append(lynx, " " + std::to_string(member.recordSize) + " ");
+
+            body.insert(body.end(), side * BLOCK_SIZE, 0xEE);
+            body.insert(body.end(), member.data.begin(), member.data.end());
+            body.resize(body.size() + dataBlocks * BLOCK_SIZE - member.data.size(), 0);
+        }
+        if (truncateLast && !members.empty()) {
+            const auto& member = members.back();
+            auto dataBlocks = std::max<size_t>(1, (member.data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+            body.resize(body.size() - (dataBlocks * BLOCK_SIZE - member.data.size()));
+        }
+        lynx.resize(BLOCK_SIZE, 0);
+        lynx.insert(lynx.end(), body.begin(), body.end());
+        return lynx;
+    }
+
+    void writeFile(const std::string& filename, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    TEST(lnx_unit_test, parse_test) {
+        auto lynx = makeLynx({
+            { "GAME", 'P', makeData(600, 1) },
+            { "RECORDS", 'R', makeData(32 * 40, 2), 32 },
+            { "NOTES", 'S', makeData(100, 3) },
+        });
+
+        Archive archive(lynx);
+        EXPECT_EQ(archive.directoryBlocks(), 1);
+        ASSERT_EQ(archive.entries().size(), 3);
+
+        const auto& entries = archive.entries();
+        EXPECT_EQ(entries[0].name, petscii_name("GAME"));
+        EXPECT_EQ(entries[0].blocks, 3);
+        EXPECT_EQ(entries[0].length, 600);
+        EXPECT_EQ(entries[1].fileType, d64FileTypes::REL);
+        EXPECT_EQ(entries[1].recordSize, 32);
+        EXPECT_EQ(entries[1].blocks, 7);
+        EXPECT_EQ(entries[1].length, 32 * 40);
+        EXPECT_EQ(entries[2].fileType, d64FileTypes::SEQ);
+
+        auto data = archive.data(entries[1]);
+        EXPECT_EQ(data.data(), lynx.data() + entries[1].offset);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), makeData(32 * 40, 2).begin()));
+        auto notes = archive.data(entries[2]);
+        EXPECT_TRUE(std::equal(notes.begin(), notes.end(), makeData(100, 3).begin()));
+
+        std::vector<uint8_t> garbage(300, 0x20);
+        EXPECT_THROW(Archive{ std::span<const uint8_t>(garbage) }, std::invalid_argument);
+    }
+
+    TEST(lnx_unit_test, import_test) {
+        auto lynx = makeLynx({
+            { "GAME", 'P', makeData(600, 1) },
+            { "RECORDS", 'R', makeData(32 * 40, 2), 32 },
+            { "GAME", 'P', makeData(10, 3) },
+            { "HUGE", 'P', makeData(BLOCK_SIZE * 700, 4) },
+        });
+
+        d64 disk;
+        auto result = importArchive(Archive(lynx), disk);
+        ASSERT_EQ(result.imported.size(), 2);
+        ASSERT_EQ(result.skipped.size(), 2);
+        EXPECT_EQ(result.skipped[0].name, petscii_name("GAME"));
+        EXPECT_TRUE(result.skipped[1].reason.starts_with("Disk full"));
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        auto game = disk.readFile("GAME");
+        ASSERT_TRUE(game.has_value());
+        EXPECT_EQ(*game, makeData(600, 1));
+
+        EXPECT_EQ(disk.getRecordSize("RECORDS"), 32);
+        auto record = disk.readRecord("RECORDS", 3);
+        ASSERT_TRUE(record.has_value());
+        auto expected = makeData(32 * 40, 2);
+        EXPECT_TRUE(std::equal(record->begin(), record->end(), expected.begin() + 2 * 32));
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+    }
+
+    TEST(lnx_unit_test, batch_test) {
+        writeFile("lynx_1.lnx", makeLynx({ { "ONE", 'P', makeData(20, 1) } }));
+        writeFile("lynx_2.lnx", makeLynx({ { "TWO", 'U', makeData(30, 2) } }, false));
+        writeFile("lynx_3.lnx", { 'N', 'O', 'P', 'E' });
+
+        auto results = convertBatch({ "lynx_1.lnx", "lynx_2.lnx", "lynx_3.lnx" }, ".", 2);
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_EQ(results[0].result.imported.size(), 1);
+        EXPECT_TRUE(results[2].image.empty());
+
+        d64 second(results[1].image);
+        auto file = second.findFile("TWO");
+        ASSERT_TRUE(file.has_value());
+        EXPECT_EQ(file.value()->file_type.type, d64FileTypes::USR);
+
+        std::remove("lynx_1.lnx");
+        std::remove("lynx_2.lnx");
+        std::remove("lynx_3.lnx");
+        std::remove(results[0].image.c_str());
+        std::remove(results[1].image.c_str());
+    }
+}
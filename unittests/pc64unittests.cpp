@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../pc64.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <fstream>
+
+using namespace d64lib;
+using namespace d64lib::pc64;
+
+namespace {
+
+    std::vector<uint8_t> readAll(const std::string& filename)
+    {
+        std::ifstream in(filename, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    TEST(pc64_unit_test, container_test) {
+        EXPECT_EQ(typeFromExtension(".P00"), d64FileTypes::PRG);
+        EXPECT_EQ(typeFromExtension("s12"), d64FileTypes::SEQ);
+        EXPECT_EQ(typeFromExtension(".r99"), d64FileTypes::REL);
+        EXPECT_FALSE(typeFromExtension(".prg").has_value());
+        EXPECT_FALSE(typeFromExtension(".x00").has_value());
+
+        auto header = makeHeader(petscii_name("HELLO"), 0);
+        std::vector<uint8_t> bytes(header.begin(), header.end());
+        bytes.push_back(0x01);
+        bytes.push_back(0x08);
+
+        Container container(bytes, d64FileTypes::PRG);
+        EXPECT_EQ(container.name(), petscii_name("HELLO"));
+        EXPECT_EQ(container.recordSize(), 0);
+        ASSERT_EQ(container.data().size(), 2);
+        EXPECT_EQ(container.data().data(), bytes.data() + HEADER_SIZE);
+
+        EXPECT_THROW(Container(bytes, d64FileTypes::REL), std::invalid_argument);
+        bytes[0] = 'X';
+        EXPECT_THROW(Container(bytes, d64FileTypes::PRG), std::invalid_argument);
+
+        EXPECT_EQ(hostName(petscii_name("MY GAME"), d64FileTypes::PRG), "my_game.p00");
+        EXPECT_EQ(hostName(petscii_name("LOG"), d64FileTypes::SEQ, 3), "log.s03");
+        EXPECT_EQ(hostName(petscii_name("LOG"), d64FileTypes::SEQ, 123), "log.s23");
+        EXPECT_EQ(hostName(petscii_name("LOG"), d64FileTypes::USR, -1), "log.u99");
+    }
+
+    TEST(pc64_unit_test, round_trip_test) {
+        d64 disk;
+        auto program = makeData(1000, 1);
+        auto text = makeData(300, 2);
+        ASSERT_TRUE(disk.addFile("GAME", d64FileTypes::PRG, program));
+        ASSERT_TRUE(disk.addFile("GAME!", d64FileTypes::PRG, makeData(10, 3)));
+        ASSERT_TRUE(disk.addFile("NOTES", d64FileTypes::SEQ, text));
+        ASSERT_TRUE(disk.addFile("RECORDS", d64FileTypes::REL, makeData(64 * 20, 4), 64));
+
+        auto files = exportDisk(disk, "pc64_set");
+        ASSERT_EQ(files.size(), 4);
+        EXPECT_EQ(std::filesystem::path(files[0]).filename(), "game.p00");
+        EXPECT_EQ(std::filesystem::path(files[1]).filename(), "game_.p00");
+        EXPECT_EQ(std::filesystem::path(files[3]).filename(), "records.r00");
+
+        auto rel = readAll(files[3]);
+        ASSERT_GE(rel.size(), HEADER_SIZE);
+        EXPECT_EQ(rel[25], 64);
+
+        d64 copy;
+        auto result = importDirectory("pc64_set", copy);
+        EXPECT_EQ(result.imported.size(), 4);
+        EXPECT_TRUE(result.failed.empty());
+
+        EXPECT_EQ(copy.readFile("GAME"), disk.readFile("GAME"));
+        EXPECT_EQ(copy.readFile("NOTES"), disk.readFile("NOTES"));
+        auto records = copy.findFile("RECORDS");
+        ASSERT_TRUE(records.has_value());
+        EXPECT_EQ(records.value()->file_type.type, d64FileTypes::REL);
+        EXPECT_EQ(records.value()->recordLength, 64);
+        EXPECT_EQ(copy.readRecord("RECORDS", 5), disk.readRecord("RECORDS", 5));
+        EXPECT_TRUE(copy.verifyBAMIntegrity(false, ""));
+
+        // the same set again only hits name clashes
+        result = importDirectory("pc64_set", copy);
+        EXPECT_TRUE(result.imported.empty());
+        EXPECT_EQ(result.failed.size(), 4);
+
+        std::filesystem::remove_all("pc64_set");
+    }
+
+    TEST(pc64_unit_test, bulk_test) {
+        d64 first;
+        first.addFile("ONE", d64FileTypes::PRG, makeData(10, 1));
+        first.save("pc64_1.d64");
+        d64 second;
+        second.addFile("TWO", d64FileTypes::USR, makeData(20, 2));
+        second.addFile("THREE", d64FileTypes::PRG, makeData(30, 3));
+        second.save("pc64_2.d64");
+
+        auto results = exportImages({ "pc64_1.d64", "pc64_2.d64", "missing.d64" }, "pc64_out", 2);
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_EQ(results[0].files.size(), 1);
+        EXPECT_EQ(results[1].files.size(), 2);
+        EXPECT_TRUE(results[2].directory.empty());
+        EXPECT_EQ(std::filesystem::path(results[1].files[0]).extension(), ".u00");
+
+        d64 rebuilt;
+        auto result = importFiles(results[1].files, rebuilt);
+        EXPECT_EQ(result.imported.size(), 2);
+        EXPECT_EQ(rebuilt.readFile("THREE"), second.readFile("THREE"));
+
+        std::remove("pc64_1.d64");
+        std::remove("pc64_2.d64");
+        std::filesystem::remove_all("pc64_out");
+    }
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../petscii.h"
+#include <vector>
+#include <string>
+
+using namespace d64lib;
+using namespace d64lib::petscii;
+
+namespace {
+
+    TEST(petscii_unit_test, table_test) {
+        static_assert(toUnicode('A') == U'A');
+        static_assert(toUnicode('A', Charset::Lowercase) == U'a');
+        static_assert(toUnicode(0xC1, Charset::Lowercase) == U'A');
+        static_assert(toUnicode(0x61, Charset::Lowercase) == U'A');
+        static_assert(toUnicode(0x5C) == U'£');
+        static_assert(toUnicode(0xDE) == U'π');
+        static_assert(toUnicode(0x7E) == toUnicode(0xDE));
+        static_assert(fromUnicode(U'a') == 'A');
+        static_assert(fromUnicode(U'a', Charset::Lowercase) == 'A');
+        static_assert(fromUnicode(U'A', Charset::Lowercase) == 0xC1);
+        static_assert(fromUnicode(U'π') == 0xDE);
+
+        // every mapped character survives a round trip
+        for (auto c = 0x20; c < 0x100; ++c) {
+            for (auto charset : { Charset::Uppercase, Charset::Lowercase }) {
+                auto u = toUnicode(static_cast<uint8_t>(c), charset);
+                EXPECT_EQ(toUnicode(fromUnicode(u, charset), charset), u) << c;
+            }
+        }
+    }
+
+    TEST(petscii_unit_test, ascii_test) {
+        // long enough to go through the vector path and the tail
+        std::string text = "HELLO WORLD 0123456789 [THE QUICK BROWN FOX] JUMPS OVER THE LAZY DOG";
+        std::vector<uint8_t> petscii(text.size());
+        EXPECT_EQ(fromAscii(text, petscii), text.size());
+        EXPECT_TRUE(std::equal(text.begin(), text.end(), petscii.begin()));
+
+        std::string ascii(petscii.size(), ' ');
+        toAscii(petscii, ascii);
+        EXPECT_EQ(ascii, text);
+
+        std::string mixed = "Hello World, the quick brown fox jumps over the lazy dog!";
+        std::vector<uint8_t> lower(mixed.size());
+        fromAscii(mixed, lower, Charset::Lowercase);
+        EXPECT_EQ(lower[0], 0xC8);
+        EXPECT_EQ(lower[1], 'E');
+
+        std::string back(lower.size(), ' ');
+        toAscii(lower, back, Charset::Lowercase);
+        EXPECT_EQ(back, mixed);
+
+        std::vector<uint8_t> graphics(40, 0xD3);
+        graphics[20] = 'A';
+        std::string hearts(graphics.size(), ' ');
+        toAscii(graphics, hearts);
+        EXPECT_EQ(hearts[0], '?');
+        EXPECT_EQ(hearts[20], 'A');
+    }
+
+    TEST(petscii_unit_test, utf8_test) {
+        std::vector<uint8_t> petscii = { 'P', 'I', '=', 0xDE, ' ', 0x5C, '5' };
+        EXPECT_EQ(toUtf8(petscii), "PI=π £5");
+        EXPECT_EQ(fromUtf8("PI=π £5"), petscii);
+        EXPECT_EQ(fromUtf8("\xFF"), std::vector<uint8_t>{ UNMAPPED_PETSCII });
+
+        std::string longName(100, 'A');
+        longName[50] = static_cast<char>(0xD3);
+        auto utf8 = toUtf8(std::string_view(longName));
+        EXPECT_EQ(utf8.size(), 99 + 3);
+        EXPECT_EQ(utf8.substr(50, 3), "♥");
+
+        // a heart in every block takes the slow path each time
+        std::string hearts;
+        for (auto i = 0; i < 1000; ++i) hearts += i % 16 ? 'A' : static_cast<char>(0xD3);
+        auto text = toUtf8(std::string_view(hearts));
+        EXPECT_EQ(text.size(), 1000 + 63 * 2);
+        EXPECT_EQ(text.substr(0, 4), "♥A");
+        EXPECT_EQ(text.substr(text.size() - 10, 3), "♥");
+
+        std::vector<petscii_name> names = { petscii_name("GAME"), petscii_name("INTRO"), petscii_name() };
+        auto converted = toUtf8(names, Charset::Lowercase);
+        ASSERT_EQ(converted.size(), 3);
+        EXPECT_EQ(converted[0], "game");
+        EXPECT_EQ(converted[1], "intro");
+        EXPECT_EQ(converted[2], "");
+
+        d64 disk;
+        disk.rename_disk("DEMO DISK");
+        EXPECT_EQ(toUtf8(disk.diskname(), Charset::Lowercase), "demo disk");
+    }
+
+    TEST(petscii_unit_test, seq_lines_test) {
+        d64 disk;
+
+        // lines long enough to cross several sector boundaries
+        std::vector<std::string> expected;
+        std::vector<uint8_t> text;
+        for (auto i = 0; i < 60; ++i) {
+            std::string line = "LINE " + std::to_string(i) + " " + std::string(i * 3, 'X');
+            expected.push_back(line);
+            text.insert(text.end(), line.begin(), line.end());
+            text.push_back(CARRIAGE_RETURN);
+        }
+        expected.push_back("");
+        text.push_back(CARRIAGE_RETURN);
+        expected.push_back("NO CR");
+        text.insert(text.end(), { 'N', 'O', ' ', 'C', 'R' });
+        ASSERT_TRUE(disk.addFile("TEXT", d64FileTypes::SEQ, text));
+
+        std::vector<std::string> lines;
+        EXPECT_TRUE(readSeqLines(disk, "TEXT", [&](std::string_view line) {
+            lines.emplace_back(line);
+            return true;
+        }));
+        EXPECT_EQ(lines, expected);
+
+        auto entry = disk.findFile("TEXT");
+        ASSERT_TRUE(entry.has_value());
+        SeqTextReader reader(disk, *entry.value(), Charset::Lowercase);
+        EXPECT_EQ(reader.next().value(), "line 0 ");
+        EXPECT_EQ(reader.next().value(), "line 1 xxx");
+
+        EXPECT_FALSE(readSeqLines(disk, "MISSING", [](std::string_view) { return true; }));
+    }
+}
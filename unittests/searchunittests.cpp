@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../search.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+using namespace d64lib;
+using namespace d64lib::search;
+
+namespace {
+
+    void place(std::vector<uint8_t>& data, size_t offset, std::string_view text)
+    {
+        std::memcpy(data.data() + offset, text.data(), text.size());
+    }
+
+    TEST(search_unit_test, fold_case_test) {
+        std::vector<uint8_t> bytes(300);
+        for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i);
+        auto folded = bytes;
+        foldCase(folded);
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            EXPECT_EQ(folded[i], foldCase(bytes[i])) << i;
+        }
+        static_assert(foldCase(0x61) == 0x41);
+        static_assert(foldCase(0xDA) == 0x5A);
+        static_assert(foldCase(0xDB) == 0xDB);
+    }
+
+    TEST(search_unit_test, stream_test) {
+        auto data = randomData(5000, 1);
+        place(data, 0, "NEEDLE");
+        place(data, 17, "NEEDLE");
+        place(data, 253, "NEEDLE");
+        place(data, 4994, "NEEDLE");
+        place(data, 1000, "NN");
+
+        PatternSet patterns({ { 'N', 'E', 'E', 'D', 'L', 'E' }, { 'N' } });
+
+        // every split of the stream finds the same matches as one big block
+        std::vector<Match> whole;
+        StreamMatcher one(patterns);
+        one.feed(data, whole);
+
+        for (size_t step : { 1, 5, 16, 254 }) {
+            std::vector<Match> pieces;
+            StreamMatcher matcher(patterns);
+            for (size_t offset = 0; offset < data.size(); offset += step) {
+                matcher.feed(std::span<const uint8_t>(data).subspan(offset, std::min(step, data.size() - offset)), pieces);
+            }
+            auto byOffset = [](const Match& a, const Match& b) { return a.offset < b.offset || (a.offset == b.offset && a.pattern < b.pattern); };
+            std::sort(pieces.begin(), pieces.end(), byOffset);
+            std::sort(whole.begin(), whole.end(), byOffset);
+            ASSERT_EQ(pieces.size(), whole.size()) << step;
+            for (size_t i = 0; i < whole.size(); ++i) {
+                EXPECT_EQ(pieces[i].offset, whole[i].offset);
+                EXPECT_EQ(pieces[i].pattern, whole[i].pattern);
+            }
+        }
+
+        std::vector<uint32_t> needles;
+        size_t singles = 0;
+        for (const auto& match : whole) {
+            if (match.pattern == 0) needles.push_back(match.offset);
+            else ++singles;
+        }
+        EXPECT_EQ(needles, std::vector<uint32_t>({ 0, 17, 253, 4994 }));
+        EXPECT_EQ(singles, static_cast<size_t>(std::count(data.begin(), data.end(), 'N')));
+
+        EXPECT_THROW(PatternSet(std::vector<std::vector<uint8_t>>(1)), std::invalid_argument);
+    }
+
+    TEST(search_unit_test, file_test) {
+        auto data = randomData(2000, 2);
+        place(data, 250, "VERSION 1.2");      // crosses into the second sector
+        place(data, 1500, "\xC3\xD2\xC5\xC4\xC9\xD4\xD3");  // CREDITS typed with shift
+
+        d64 disk;
+        ASSERT_TRUE(disk.addFile("GAME", d64FileTypes::PRG, data));
+        auto entry = disk.findFile("GAME");
+        ASSERT_TRUE(entry.has_value());
+
+        auto exact = PatternSet::fromText({ "VERSION", "CREDITS" });
+        auto matches = searchFile(disk, *entry.value(), exact);
+        ASSERT_EQ(matches.size(), 1);
+        EXPECT_EQ(matches[0].pattern, 0);
+        EXPECT_EQ(matches[0].offset, 250);
+
+        auto folded = PatternSet::fromText({ "version", "credits" }, true, petscii::Charset::Lowercase);
+        matches = searchFile(disk, *entry.value(), folded);
+        ASSERT_EQ(matches.size(), 2);
+        EXPECT_EQ(matches[1].pattern, 1);
+        EXPECT_EQ(matches[1].offset, 1500);
+    }
+
+    TEST(search_unit_test, corpus_test) {
+        auto data = randomData(1000, 3);
+        place(data, 600, "CRACKED BY");
+
+        d64 disk1;
+        disk1.addFile("ONE", d64FileTypes::PRG, randomData(1000, 4));
+        disk1.addFile("TWO", d64FileTypes::PRG, data);
+        disk1.save("search_1.d64");
+
+        d64 disk2;
+        disk2.addFile("THREE", d64FileTypes::SEQ, data);
+        disk2.save("search_2.d64");
+
+        auto hits = searchCorpus({ "search_1.d64", "missing.d64", "search_2.d64" }, PatternSet::fromText({ "CRACKED BY" }), 2);
+        ASSERT_EQ(hits.size(), 2);
+        EXPECT_EQ(hits[0].image, "search_1.d64");
+        EXPECT_EQ(std::string(hits[0].entry.fileName, 3), "TWO");
+        EXPECT_EQ(hits[0].offset, 600);
+        EXPECT_EQ(hits[1].image, "search_2.d64");
+
+        std::remove("search_1.d64");
+        std::remove("search_2.d64");
+    }
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../shared_disk.h"
+#include "testdata.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace d64lib;
+
+namespace {
+
+    TEST(shared_disk_unit_test, read_write_test) {
+        SharedDisk disk{ d64() };
+        auto bytes = fileData(600, 0x33);
+        ASSERT_TRUE(disk.addFile("FIRST", d64FileTypes::PRG, bytes));
+
+        auto entry = disk.findFile("FIRST");
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(d64::Trim(entry->fileName), "FIRST");
+        EXPECT_EQ(disk.readFile("FIRST"), bytes);
+        EXPECT_FALSE(disk.readFile("MISSING").has_value());
+        EXPECT_EQ(disk.directory().size(), 1);
+
+        ASSERT_TRUE(disk.renameFile("FIRST", "SECOND"));
+        EXPECT_FALSE(disk.findFile("FIRST").has_value());
+        ASSERT_TRUE(disk.removeFile("SECOND"));
+        EXPECT_EQ(disk.getFreeSectorCount(), 664);
+    }
+
+    TEST(shared_disk_unit_test, concurrent_test) {
+        constexpr int WRITERS = 4;
+        constexpr int FILES = 10;
+        SharedDisk disk{ d64() };
+        auto base = fileData(2000, 0x11);
+        ASSERT_TRUE(disk.addFile("BASE", d64FileTypes::PRG, base));
+
+        std::atomic<bool> done = false;
+        std::atomic<int> badReads = 0;
+        std::vector<std::thread> readers;
+        for (auto r = 0; r < 4; ++r) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    if (disk.readFile("BASE") != base) ++badReads;
+                    disk.directory();
+                }
+            });
+        }
+
+        std::vector<std::thread> writers;
+        for (auto w = 0; w < WRITERS; ++w) {
+            writers.emplace_back([&, w] {
+                for (auto f = 0; f < FILES; ++f) {
+                    disk.addFile("W" + std::to_string(w) + "F" + std::to_string(f), d64FileTypes::PRG, fileData(700, static_cast<uint8_t>(w)));
+                }
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        done = true;
+        for (auto& reader : readers) reader.join();
+
+        EXPECT_EQ(badReads, 0);
+        EXPECT_EQ(disk.directory().size(), WRITERS * FILES + 1);
+        for (auto w = 0; w < WRITERS; ++w) {
+            EXPECT_EQ(disk.readFile("W" + std::to_string(w) + "F3"), fileData(700, static_cast<uint8_t>(w)));
+        }
+        EXPECT_TRUE(disk.withRead([](d64& image) { return image.verifyBAMIntegrity(false, ""); }));
+    }
+
+    TEST(shared_disk_unit_test, with_write_test) {
+        SharedDisk disk{ d64() };
+        ASSERT_TRUE(disk.addFile("CONFIG", d64FileTypes::SEQ, fileData(100, 0)));
+
+        // readers never see the file missing while it is replaced
+        std::atomic<bool> done = false;
+        std::atomic<int> missing = 0;
+        std::thread reader([&] {
+            while (!done) {
+                if (!disk.findFile("CONFIG").has_value()) ++missing;
+            }
+        });
+        for (auto version = 1; version <= 200; ++version) {
+            disk.withWrite([&](d64& image) {
+                image.removeFile("CONFIG");
+                return image.addFile("CONFIG", d64FileTypes::SEQ, fileData(100, static_cast<uint8_t>(version)));
+            });
+        }
+        done = true;
+        reader.join();
+
+        EXPECT_EQ(missing, 0);
+        EXPECT_EQ(disk.readFile("CONFIG"), fileData(100, 200));
+    }
+
+    TEST(shared_disk_unit_test, mixed_read_write_test) {
+        constexpr int THREADS = 4;
+        constexpr int OPERATIONS = 200;
+        SharedDisk disk{ d64() };
+        auto base = fileData(4000, 0x22);
+        ASSERT_TRUE(disk.addFile("BASE", d64FileTypes::PRG, base));
+        auto freeSectors = disk.getFreeSectorCount();
+
+        std::atomic<int> failures = 0;
+        std::vector<std::thread> threads;
+        for (auto t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                auto name = "T" + std::to_string(t);
+                auto bytes = fileData(300, static_cast<uint8_t>(t));
+                for (auto i = 0; i < OPERATIONS; ++i) {
+                    if (i % 5 != 0) {
+                        if (disk.readFile("BASE") != base) ++failures;
+                    }
+                    else if (!disk.addFile(name, d64FileTypes::PRG, bytes) || disk.readFile(name) != bytes || !disk.removeFile(name)) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        EXPECT_EQ(failures, 0);
+        auto files = disk.directory();
+        ASSERT_EQ(files.size(), 1);
+        EXPECT_EQ(d64::Trim(files[0].fileName), "BASE");
+        EXPECT_EQ(disk.readFile("BASE"), base);
+        EXPECT_EQ(disk.getFreeSectorCount(), freeSectors);
+        EXPECT_TRUE(disk.withWrite([](d64& image) { return image.verifyBAMIntegrity(false, ""); }));
+    }
+
+    // prints throughput for several read/write mixes, run with --gtest_also_run_disabled_tests
+    TEST(shared_disk_unit_test, DISABLED_contention_benchmark) {
+        constexpr int THREADS = 4;
+        constexpr int OPERATIONS = 2000;
+        SharedDisk disk{ d64() };
+        ASSERT_TRUE(disk.addFile("BASE", d64FileTypes::PRG, fileData(4000, 0x22)));
+
+        // each write adds and removes a small file, each read reads a 16 block file
+        for (auto readPercent : { 100, 95, 80, 50 }) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (auto t = 0; t < THREADS; ++t) {
+                threads.emplace_back([&, t] {
+                    auto name = "T" + std::to_string(t);
+                    auto bytes = fileData(300, static_cast<uint8_t>(t));
+                    for (auto i = 0; i < OPERATIONS; ++i) {
+                        if (i % 100 < readPercent) {
+                            disk.readFile("BASE");
+                        }
+                        else {
+                            disk.addFile(name, d64FileTypes::PRG, bytes);
+                            disk.removeFile(name);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join();
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << readPercent << "% reads: " << static_cast<int>(THREADS * OPERATIONS / seconds) << " operations/s" << std::endl;
+            EXPECT_EQ(disk.directory().size(), 1);
+        }
+    }
+
+}
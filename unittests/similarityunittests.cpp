@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../similarity.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+using namespace d64lib;
+using namespace d64lib::similarity;
+
+namespace {
+
+    TEST(similarity_unit_test, empty_sector_test) {
+        std::vector<uint8_t> sector(SECTOR_SIZE, 0x01);
+        EXPECT_TRUE(isEmptySector(sector));
+        sector[0] = 0x4B;
+        EXPECT_TRUE(isEmptySector(sector));
+        sector[10] = 0x00;
+        EXPECT_FALSE(isEmptySector(sector));
+
+        d64 disk;
+        EXPECT_EQ(signature(disk).sectors, 0);
+
+        // a 1571 keeps the BAM of its second side on 53/0
+        d64 d71(diskType::seventy_track);
+        EXPECT_EQ(signature(d71).sectors, 0);
+
+        // the header, BAM and directory of a 1581 sit on track 40
+        d64 d81(diskType::eighty_track);
+        EXPECT_EQ(signature(d81).sectors, 0);
+        std::vector<uint8_t> fileData(254 * 3, 0x42);
+        d81.addFile("FILE", d64FileTypes::PRG, fileData);
+        EXPECT_EQ(signature(d81).sectors, 3);
+    }
+
+    TEST(similarity_unit_test, signature_test) {
+        d64 original;
+        ASSERT_TRUE(original.addFile("GAME", d64FileTypes::PRG, randomData(254 * 100, 1)));
+
+        // a patched copy differs in one sector and has a crack intro added
+        d64 patched;
+        ASSERT_TRUE(patched.addFile("GAME", d64FileTypes::PRG, randomData(254 * 100, 1)));
+        auto entry = patched.findFile("GAME");
+        ASSERT_TRUE(entry.has_value());
+        std::array<uint8_t, SECTOR_SIZE> sector;
+        ASSERT_TRUE(patched.readSector(entry.value()->start.track, entry.value()->start.sector, sector));
+        sector[100] ^= 0xFF;
+        ASSERT_TRUE(patched.writeSector(entry.value()->start.track, entry.value()->start.sector, std::span<const uint8_t>(sector)));
+        ASSERT_TRUE(patched.addFile("INTRO", d64FileTypes::PRG, randomData(254 * 2, 2)));
+
+        d64 other;
+        ASSERT_TRUE(other.addFile("OTHER", d64FileTypes::PRG, randomData(254 * 100, 3)));
+
+        auto a = signature(original);
+        auto b = signature(patched);
+        auto c = signature(other);
+        EXPECT_EQ(a.sectors, 100);
+        EXPECT_EQ(b.sectors, 102);
+        EXPECT_DOUBLE_EQ(a.similarity(a), 1.0);
+        EXPECT_GT(a.similarity(b), 0.9);
+        EXPECT_LT(a.similarity(c), 0.1);
+    }
+
+    TEST(similarity_unit_test, index_test) {
+        d64 original;
+        original.addFile("GAME", d64FileTypes::PRG, randomData(254 * 100, 1));
+        original.save("similar_1.d64");
+
+        d64 copy;
+        copy.addFile("GAME", d64FileTypes::PRG, randomData(254 * 100, 1));
+        copy.addFile("README", d64FileTypes::SEQ, randomData(254 * 3, 7));
+        copy.save("similar_2.d64");
+
+        d64 other;
+        other.addFile("OTHER", d64FileTypes::PRG, randomData(254 * 100, 3));
+        other.save("similar_3.d64");
+
+        SimilarityIndex index;
+        EXPECT_EQ(index.addImages({ "similar_1.d64", "similar_2.d64", "similar_3.d64", "missing.d64" }, 2), 3);
+        EXPECT_EQ(index.size(), 3);
+
+        auto matches = index.query("similar_1.d64");
+        ASSERT_EQ(matches.size(), 1);
+        EXPECT_EQ(matches[0].image, "similar_2.d64");
+        EXPECT_GT(matches[0].similarity, 0.9);
+        EXPECT_TRUE(index.query("similar_3.d64").empty());
+        EXPECT_TRUE(index.query("missing.d64").empty());
+
+        // replacing a signature moves the image to its new buckets
+        index.add("similar_3.d64", signature(original));
+        EXPECT_EQ(index.size(), 3);
+        matches = index.query("similar_1.d64");
+        ASSERT_EQ(matches.size(), 2);
+        EXPECT_EQ(matches[0].image, "similar_3.d64");
+        EXPECT_DOUBLE_EQ(matches[0].similarity, 1.0);
+
+        std::remove("similar_1.d64");
+        std::remove("similar_2.d64");
+        std::remove("similar_3.d64");
+    }
+}
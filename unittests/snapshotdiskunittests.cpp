@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../snapshot_disk.h"
+#include "testdata.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace d64lib;
+
+namespace {
+
+    TEST(snapshot_disk_unit_test, isolation_test) {
+        SnapshotDisk disk{ d64() };
+        auto before = disk.snapshot();
+        auto bytes = fileData(600, 0x33);
+        ASSERT_TRUE(disk.addFile("FIRST", d64FileTypes::PRG, bytes));
+
+        // the pinned version does not see the change
+        EXPECT_EQ(before.version(), 0);
+        EXPECT_FALSE(before.findFile("FIRST").has_value());
+        EXPECT_EQ(before.directory().size(), 0);
+
+        auto after = disk.snapshot();
+        EXPECT_EQ(after.version(), 1);
+        EXPECT_EQ(after.readFile("FIRST"), bytes);
+        EXPECT_EQ(after.directory().size(), 1);
+
+        // failed changes are not published
+        EXPECT_FALSE(disk.removeFile("MISSING"));
+        EXPECT_EQ(disk.snapshot().version(), 1);
+    }
+
+    TEST(snapshot_disk_unit_test, with_write_test) {
+        SnapshotDisk disk{ d64() };
+        ASSERT_TRUE(disk.addFile("CONFIG", d64FileTypes::SEQ, fileData(100, 0)));
+        auto before = disk.snapshot();
+
+        disk.withWrite([](d64& image) {
+            image.removeFile("CONFIG");
+            image.addFile("CONFIG", d64FileTypes::SEQ, fileData(100, 1));
+        });
+        EXPECT_EQ(before.readFile("CONFIG"), fileData(100, 0));
+        EXPECT_EQ(disk.snapshot().readFile("CONFIG"), fileData(100, 1));
+
+        // a throwing change leaves the latest version alone
+        EXPECT_THROW(disk.withWrite([](d64& image) -> bool {
+            image.removeFile("CONFIG");
+            throw std::runtime_error("abandoned");
+        }), std::runtime_error);
+        EXPECT_EQ(disk.snapshot().readFile("CONFIG"), fileData(100, 1));
+    }
+
+    TEST(snapshot_disk_unit_test, outlives_disk_test) {
+        auto disk = std::make_unique<SnapshotDisk>(d64());
+        ASSERT_TRUE(disk->addFile("KEPT", d64FileTypes::PRG, fileData(300, 0x44)));
+        auto pinned = disk->snapshot();
+        disk.reset();
+
+        EXPECT_EQ(pinned.readFile("KEPT"), fileData(300, 0x44));
+    }
+
+    TEST(snapshot_disk_unit_test, concurrent_test) {
+        constexpr int FILES = 40;
+        SnapshotDisk disk{ d64() };
+
+        // every version holds exactly as many files as changes published before it
+        std::atomic<bool> done = false;
+        std::atomic<int> torn = 0;
+        std::vector<std::thread> readers;
+        for (auto r = 0; r < 4; ++r) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    auto pinned = disk.snapshot();
+                    auto files = pinned.directory();
+                    if (files.size() != pinned.version()) ++torn;
+                    if (!files.empty() && pinned.readFile(d64::Trim(files.back().fileName)) != fileData(700, static_cast<uint8_t>(files.size()))) ++torn;
+                }
+            });
+        }
+        for (auto f = 1; f <= FILES; ++f) {
+            ASSERT_TRUE(disk.addFile("F" + std::to_string(f), d64FileTypes::PRG, fileData(700, static_cast<uint8_t>(f))));
+        }
+        done = true;
+        for (auto& reader : readers) reader.join();
+
+        EXPECT_EQ(torn, 0);
+        EXPECT_EQ(disk.snapshot().directory().size(), FILES);
+    }
+
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../t64.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace d64lib;
+using namespace d64lib::t64;
+
+namespace {
+
+    struct TapeFile {
+        std::string name;
+        uint8_t type;
+        uint16_t start;
+        uint16_t end;           // written as is, may be wrong on purpose
+        std::vector<uint8_t> data;
+    };
+
+    void put16(std::vector<uint8_t>& bytes, size_t offset, uint32_t value)
+    {
+        bytes[offset] = static_cast<uint8_t>(value);
+        bytes[offset + 1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    std::vector<uint8_t> makeTape(const std::string& tapeName, const std::vector<TapeFile>& files, size_t slots)
+    {
+        std::vector<uint8_t> tape(HEADER_SIZE + slots * ENTRY_SIZE, 0);
+        std::memcpy(tape.data(), "C64S tape image file", 20);
+        put16(tape, 0x20, 0x0101);
+        put16(tape, 0x22, static_cast<uint32_t>(slots));
+        put16(tape, 0x24, static_cast<uint32_t>(files.size()));
+        std::memset(tape.data() + 0x28, 0x20, TAPE_NAME_SIZE);
+        std::memcpy(tape.data() + 0x28, tapeName.data(), tapeName.size());
+
+        for (size_t i = 0; i < files.size(); ++i) {
+            auto entry = HEADER_SIZE + i * ENTRY_SIZE;
+            tape[entry] = 1;
+            tape[entry + 1] = files[i].type;
+            put16(tape, entry + 2, files[i].start);
+            put16(tape, entry + 4, files[i].end);
+            put16(tape, entry + 8, static_cast<uint32_t>(tape.size()));
+            put16(tape, entry + 10, static_cast<uint32_t>(tape.size() >> 16));
+            std::memset(tape.data() + entry + 0x10, 0x20, FILE_NAME_SZ);
+            std::memcpy(tape.data() + entry + 0x10, files[i].name.data(), files[i].name.size());
+            tape.insert(tape.end(), files[i].data.begin(), files[i].data.end());
+        }
+        return tape;
+    }
+
+    void writeFile(const std::string& filename, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    TEST(t64_unit_test, parse_test) {
+        auto tape = makeTape("MY TAPE", {
+            { "GAME", 0x82, 0x0801, 0x0801 + 500, makeData(500, 1) },
+            { "BROKEN END", 0x01, 0x1000, 0xC3C6, makeData(300, 2) },
+            { "NOTES", 0x81, 0x0000, 0x0064, makeData(100, 3) },
+        }, 8);
+
+        Archive archive(tape);
+        EXPECT_EQ(archive.version(), 0x0101);
+        EXPECT_EQ(archive.tapeName(), petscii_name("MY TAPE"));
+        ASSERT_EQ(archive.entries().size(), 3);
+
+        const auto& entries = archive.entries();
+        EXPECT_EQ(entries[0].name, petscii_name("GAME"));
+        EXPECT_EQ(entries[0].fileType, d64FileTypes::PRG);
+        EXPECT_EQ(entries[0].length, 500);
+        EXPECT_EQ(entries[1].fileType, d64FileTypes::PRG);
+        EXPECT_EQ(entries[1].length, 300);
+        EXPECT_EQ(entries[2].fileType, d64FileTypes::SEQ);
+        auto data = archive.data(entries[1]);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), makeData(300, 2).begin()));
+
+        std::vector<uint8_t> garbage(100, 0);
+        EXPECT_THROW(Archive{ std::span<const uint8_t>(garbage) }, std::invalid_argument);
+    }
+
+    TEST(t64_unit_test, import_test) {
+        auto tape = makeTape("TAPE", {
+            { "GAME", 0x82, 0x0801, 0x0801 + 500, makeData(500, 1) },
+            { "", 0x82, 0xC000, 0xC010, makeData(16, 2) },
+            { "GAME", 0x82, 0x0801, 0x0805, makeData(4, 3) },
+            { "HUGE", 0x82, 0x0000, 0x0000, makeData(0xFFFF, 4) },
+            { "HUGE 2", 0x82, 0x0000, 0x0000, makeData(0xFFFF, 5) },
+            { "HUGE 3", 0x82, 0x0000, 0x0000, makeData(0xFFFF, 6) },
+        }, 6);
+
+        d64 disk;
+        Archive archive(tape);
+        auto result = importArchive(archive, disk);
+        ASSERT_EQ(result.imported.size(), 4);
+        EXPECT_EQ(result.imported[1], petscii_name("FILE 2"));
+        ASSERT_EQ(result.skipped.size(), 2);
+        EXPECT_EQ(result.skipped[0].name, petscii_name("GAME"));
+        EXPECT_EQ(result.skipped[1].name, petscii_name("HUGE 3"));
+        EXPECT_TRUE(result.skipped[1].reason.starts_with("Disk full"));
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+
+        auto game = disk.readFile("GAME");
+        ASSERT_TRUE(game.has_value());
+        ASSERT_EQ(game->size(), 502);
+        EXPECT_EQ((*game)[0], 0x01);
+        EXPECT_EQ((*game)[1], 0x08);
+        EXPECT_TRUE(std::equal(game->begin() + 2, game->end(), makeData(500, 1).begin()));
+        EXPECT_TRUE(disk.verifyBAMIntegrity(false, ""));
+    }
+
+    TEST(t64_unit_test, batch_test) {
+        writeFile("tape_1.t64", makeTape("FIRST", { { "ONE", 0x82, 0x0801, 0x0803, { 0x00, 0x00 } } }, 1));
+        writeFile("tape_2.t64", makeTape("SECOND", { { "TWO", 0x81, 0x0000, 0x0003, { 'A', 'B', 'C' } } }, 4));
+        writeFile("tape_3.t64", { 'N', 'O', 'P', 'E' });
+
+        auto results = convertBatch({ "tape_1.t64", "tape_2.t64", "tape_3.t64" }, ".", 2);
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_EQ(results[0].result.imported.size(), 1);
+        EXPECT_TRUE(results[2].image.empty());
+
+        d64 second(results[1].image);
+        EXPECT_EQ(second.diskname(), "SECOND");
+        auto file = second.findFile("TWO");
+        ASSERT_TRUE(file.has_value());
+        EXPECT_EQ(file.value()->file_type.type, d64FileTypes::SEQ);
+
+        std::remove("tape_1.t64");
+        std::remove("tape_2.t64");
+        std::remove("tape_3.t64");
+        std::remove(results[0].image.c_str());
+        std::remove(results[1].image.c_str());
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// file contents shared by the unit tests
+
+// a PRG loading at $0801 and filled with value
+inline std::vector<uint8_t> fileData(size_t size, uint8_t value)
+{
+    std::vector<uint8_t> bytes(size, value);
+    bytes[0] = 0x01;
+    bytes[1] = 0x08;
+    return bytes;
+}
+
+// bytes counting up from seed
+inline std::vector<uint8_t> makeData(size_t size, uint8_t seed = 0)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = static_cast<uint8_t>(i + seed);
+    return data;
+}
+
+// bytes that do not repeat or compress, the same for the same seed
+inline std::vector<uint8_t> randomData(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = static_cast<uint8_t>(seed >> 16);
+    }
+    return data;
+}
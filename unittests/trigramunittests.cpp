@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../trigram.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+using namespace d64lib;
+using namespace d64lib::trigram;
+
+namespace {
+
+    const std::vector<uint8_t> data = { 0x01, 0x08, 0x00, 0x00 };
+
+    std::span<const uint8_t> bytesOf(std::string_view text)
+    {
+        return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+
+    TEST(trigram_unit_test, trigrams_test) {
+        auto grams = trigrams(bytesOf("AB"));
+        // "  A", " AB", "AB "
+        ASSERT_EQ(grams.size(), 3);
+        EXPECT_EQ(grams[0], 0x202041u);
+        EXPECT_EQ(trigrams(bytesOf("\xC1\xC2")), grams);
+        EXPECT_EQ(trigrams(bytesOf("ab")), grams);
+        EXPECT_EQ(trigrams(bytesOf("AAAA")).size(), 4);
+    }
+
+    TEST(trigram_unit_test, query_test) {
+        TrigramIndexBuilder builder;
+        builder.add("one.d64", Kind::Disk, petscii_name("GAMES 1"));
+        builder.add("one.d64", Kind::File, petscii_name("BOULDER DASH"));
+        builder.add("one.d64", Kind::File, petscii_name("BOULDER DASH II"));
+        builder.add("one.d64", Kind::File, petscii_name("GHOSTBUSTERS"));
+        builder.add("two.d64", Kind::Disk, petscii_name("BOULDER"));
+        builder.add("two.d64", Kind::File, petscii_name("DASH"));
+        builder.add("two.d64", Kind::File, petscii_name(""));
+        EXPECT_EQ(builder.size(), 6);
+
+        TrigramIndex index(builder.build());
+        EXPECT_EQ(index.documentCount(), 6);
+        EXPECT_EQ(index.imageCount(), 2);
+
+        auto results = index.query("bouldr dash");
+        ASSERT_GE(results.size(), 2);
+        EXPECT_EQ(results[0].name, petscii_name("BOULDER DASH"));
+        EXPECT_EQ(results[0].image, "one.d64");
+        EXPECT_EQ(results[0].kind, Kind::File);
+        EXPECT_EQ(results[1].name, petscii_name("BOULDER DASH II"));
+        for (size_t i = 1; i < results.size(); ++i) {
+            EXPECT_GE(results[i - 1].score, results[i].score);
+        }
+
+        results = index.query("BOULDER DASH", 1, 0.0);
+        ASSERT_EQ(results.size(), 1);
+        EXPECT_DOUBLE_EQ(results[0].score, 1.0);
+
+        results = index.query("boulder", 20, 0.9);
+        ASSERT_EQ(results.size(), 1);
+        EXPECT_EQ(results[0].kind, Kind::Disk);
+        EXPECT_EQ(results[0].image, "two.d64");
+
+        EXPECT_TRUE(index.query("zzzz").empty());
+    }
+
+    TEST(trigram_unit_test, corrupt_query_test) {
+        TrigramIndexBuilder builder;
+        for (auto i = 0; i < 200; ++i) {
+            builder.add("one.d64", Kind::File, petscii_name("PACMAN"));
+        }
+        auto bytes = builder.build();
+        uint64_t documentOffset, postingOffset;
+        std::memcpy(&documentOffset, bytes.data() + 32, sizeof(documentOffset));
+        std::memcpy(&postingOffset, bytes.data() + 48, sizeof(postingOffset));
+
+        // documents that claim fewer trigrams than they share are skipped
+        auto noGrams = bytes;
+        for (size_t record = documentOffset; record < documentOffset + 200 * 24; record += 24) {
+            noGrams[record + 5] = 0;
+        }
+        EXPECT_TRUE(TrigramIndex(std::move(noGrams)).query("PACMAN").empty());
+
+        // posting lists that never end a number are rejected
+        std::fill(bytes.begin() + postingOffset, bytes.end(), 0x80);
+        EXPECT_TRUE(TrigramIndex(std::move(bytes)).query("PACMAN").empty());
+    }
+
+    TEST(trigram_unit_test, file_test) {
+        d64 disk1;
+        disk1.rename_disk("ARCADE");
+        disk1.addFile("PACMAN", d64FileTypes::PRG, data);
+        disk1.addFile("GALAXIAN", d64FileTypes::PRG, data);
+        disk1.save("trigram_1.d64");
+
+        d64 disk2;
+        disk2.rename_disk("PUZZLE");
+        disk2.addFile("PAC LAND", d64FileTypes::PRG, data);
+        disk2.save("trigram_2.d64");
+
+        TrigramIndexBuilder builder;
+        EXPECT_EQ(builder.addImages({ "trigram_1.d64", "missing.d64", "trigram_2.d64" }, 2), 2);
+        EXPECT_EQ(builder.size(), 5);
+        ASSERT_TRUE(builder.save("trigram.idx"));
+
+        auto index = TrigramIndex::open("trigram.idx");
+        ASSERT_TRUE(index.has_value());
+        auto results = index->query("pacman");
+        ASSERT_FALSE(results.empty());
+        EXPECT_EQ(results[0].name, petscii_name("PACMAN"));
+        EXPECT_EQ(results[0].image, "trigram_1.d64");
+
+        results = index->query("puzzle");
+        ASSERT_EQ(results.size(), 1);
+        EXPECT_EQ(results[0].kind, Kind::Disk);
+        EXPECT_EQ(results[0].image, "trigram_2.d64");
+
+        EXPECT_FALSE(TrigramIndex::open("trigram_1.d64").has_value());
+        EXPECT_FALSE(TrigramIndex::open("missing.idx").has_value());
+
+        auto bytes = builder.build();
+        bytes.resize(bytes.size() - 1);
+        EXPECT_THROW(TrigramIndex(std::move(bytes)), std::invalid_argument);
+
+        std::remove("trigram_1.d64");
+        std::remove("trigram_2.d64");
+        std::remove("trigram.idx");
+    }
+}
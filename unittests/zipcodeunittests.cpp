@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "../d64.h"
+#include "../zipcode.h"
+#include "testdata.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace d64lib;
+using namespace d64lib::zipcode;
+
+namespace {
+
+    void makeDisk(d64& disk)
+    {
+        disk.rename_disk("ZIPPED");
+        disk.addFile("RANDOM", d64FileTypes::PRG, randomData(5000, 1));
+        disk.addFile("ZEROS", d64FileTypes::SEQ, std::vector<uint8_t>(3000, 0));
+        std::vector<uint8_t> runs;
+        for (auto i = 0; i < 2000; ++i) runs.push_back(static_cast<uint8_t>(i / 50));
+        disk.addFile("RUNS", d64FileTypes::PRG, runs);
+    }
+
+    bool sameSectors(d64& a, d64& b)
+    {
+        for (auto track = 1; track <= TRACKS_35; ++track) {
+            for (auto sector = 0; sector < d64::SECTORS_PER_TRACK[track - 1]; ++sector) {
+                if (a.readSector(track, sector) != b.readSector(track, sector)) return false;
+            }
+        }
+        return true;
+    }
+
+    TEST(zipcode_unit_test, round_trip_test) {
+        d64 disk;
+        makeDisk(disk);
+
+        std::array<std::vector<uint8_t>, PARTS> encoded;
+        std::array<std::span<const uint8_t>, PARTS> parts;
+        for (auto part = 1; part <= PARTS; ++part) {
+            encoded[part - 1] = encodePart(disk, part);
+            parts[part - 1] = encoded[part - 1];
+        }
+        EXPECT_EQ(encoded[0][0], 0xFE);
+        EXPECT_EQ(encoded[0][1], 0x03);
+        EXPECT_EQ(encoded[1][1], 0x04);
+
+        // empty sectors are filled, runs are packed, the random file stays raw
+        size_t total = 0;
+        for (const auto& part : encoded) total += part.size();
+        EXPECT_LT(total, 30 * SECTOR_SIZE);
+
+        d64 copy;
+        EXPECT_EQ(decode(parts, copy, PARTS), 683);
+        EXPECT_TRUE(sameSectors(disk, copy));
+        EXPECT_EQ(copy.diskname(), "ZIPPED");
+        EXPECT_EQ(copy.readFile("RUNS"), disk.readFile("RUNS"));
+    }
+
+    TEST(zipcode_unit_test, damaged_test) {
+        d64 disk;
+        makeDisk(disk);
+
+        auto part = encodePart(disk, 2);
+        EXPECT_THROW(decodePart(part, 1, disk), std::invalid_argument);
+        EXPECT_THROW(decodePart(part, 5, disk), std::invalid_argument);
+
+        part.resize(part.size() - 1);
+        d64 copy;
+        EXPECT_THROW(decodePart(part, 2, copy), std::invalid_argument);
+
+        // the parts only describe a 1541 disk
+        d64 d81(diskType::eighty_track);
+        EXPECT_THROW(encodePart(d81, 1), std::invalid_argument);
+        EXPECT_THROW(decodePart(encodePart(disk, 1), 1, d81), std::invalid_argument);
+
+        EXPECT_THROW(partNames("pacman"), std::invalid_argument);
+        auto names = partNames("games/3!pacman");
+        EXPECT_EQ(std::filesystem::path(names[0]), std::filesystem::path("games/1!pacman"));
+        EXPECT_EQ(std::filesystem::path(names[3]), std::filesystem::path("games/4!pacman"));
+    }
+
+    TEST(zipcode_unit_test, batch_test) {
+        d64 disk;
+        makeDisk(disk);
+        auto files = encodeSet(disk, ".", "zipped");
+        {
+            std::ofstream out("1!broken", std::ios::binary);
+            out << "NOPE";
+        }
+
+        auto results = convertBatch({ files[0], "1!broken", "1!missing" }, ".", 2);
+        ASSERT_EQ(results.size(), 3);
+        EXPECT_EQ(results[0].sectors, 683);
+        EXPECT_TRUE(results[1].image.empty());
+        EXPECT_TRUE(results[2].image.empty());
+
+        d64 copy(results[0].image);
+        EXPECT_TRUE(sameSectors(disk, copy));
+
+        for (const auto& file : files) std::remove(file.c_str());
+        std::remove("1!broken");
+        std::remove(results[0].image.c_str());
+    }
+}
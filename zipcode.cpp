@@ -0,0 +1,287 @@
+#include "zipcode.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace d64lib::zipcode {
+
+namespace {
+
+// part 1 starts with load address $03FE and the disk id, the others with $0400
+constexpr uint16_t FIRST_LOAD_ADDRESS = 0x03FE;
+constexpr uint16_t LOAD_ADDRESS = 0x0400;
+
+// shorter runs are cheaper as literals
+constexpr int MIN_RUN = 4;
+
+void checkPart(int part)
+{
+    if (part < 1 || part > PARTS) {
+        throw std::invalid_argument("Zipcode part must be 1 to 4");
+    }
+}
+
+// the parts follow the 1541 layout, other drives put data where it expects the BAM
+void checkDisk(const d64& disk)
+{
+    if (disk.TRACKS > TRACKS_40) {
+        throw std::invalid_argument("Zipcode holds a single sided 1541 disk");
+    }
+}
+
+/// <summary>
+/// Order in which a track is written, sectors from both halves of the track alternate
+/// </summary>
+std::vector<int> sectorOrder(int sectors)
+{
+    std::vector<int> order;
+    auto half = (sectors + 1) / 2;
+    for (auto sector = 0; sector < half; ++sector) {
+        order.push_back(sector);
+        if (sector + half < sectors) order.push_back(sector + half);
+    }
+    return order;
+}
+
+/// <summary>
+/// Expand the run length encoded payload of a sector into the sector buffer
+/// </summary>
+void unpack(std::span<const uint8_t> packed, uint8_t escape, std::span<uint8_t> sector)
+{
+    size_t out = 0;
+    for (size_t in = 0; in < packed.size(); ) {
+        if (packed[in] == escape) {
+            if (in + 2 >= packed.size()) {
+                throw std::invalid_argument("Truncated Zipcode run");
+            }
+            auto count = packed[in + 1];
+            if (out + count > sector.size()) break;
+            std::fill_n(sector.begin() + out, count, packed[in + 2]);
+            out += count;
+            in += 3;
+        }
+        else {
+            if (out >= sector.size()) break;
+            sector[out++] = packed[in++];
+        }
+    }
+    if (out != sector.size()) {
+        throw std::invalid_argument("Zipcode sector does not decode to 256 bytes");
+    }
+}
+
+void encodeSector(int track, int sector, std::span<const uint8_t> bytes, std::vector<uint8_t>& out)
+{
+    if (std::all_of(bytes.begin(), bytes.end(), [&](auto value) { return value == bytes[0]; })) {
+        out.insert(out.end(), { static_cast<uint8_t>(track | MODE_FILL), static_cast<uint8_t>(sector), bytes[0] });
+        return;
+    }
+
+    // the escape byte must not occur in the sector
+    std::array<bool, 256> used{};
+    for (auto value : bytes) used[value] = true;
+    auto escape = std::find(used.begin(), used.end(), false);
+
+    if (escape != used.end()) {
+        auto escapeByte = static_cast<uint8_t>(escape - used.begin());
+        std::array<uint8_t, SECTOR_SIZE> packed;
+        size_t size = 0;
+        size_t i = 0;
+        while (i < bytes.size() && size <= packed.size() - 3) {
+            size_t run = 1;
+            while (i + run < bytes.size() && run < 255 && bytes[i + run] == bytes[i]) ++run;
+            if (run >= MIN_RUN) {
+                packed[size++] = escapeByte;
+                packed[size++] = static_cast<uint8_t>(run);
+                packed[size++] = bytes[i];
+                i += run;
+            }
+            else {
+                packed[size++] = bytes[i++];
+            }
+        }
+
+        // worth it only if the record is shorter than a raw sector
+        if (i == bytes.size() && size < SECTOR_SIZE - 2) {
+            out.insert(out.end(), { static_cast<uint8_t>(track | MODE_RLE), static_cast<uint8_t>(sector),
+                static_cast<uint8_t>(size), escapeByte });
+            out.insert(out.end(), packed.begin(), packed.begin() + size);
+            return;
+        }
+    }
+
+    out.push_back(static_cast<uint8_t>(track | MODE_RAW));
+    out.push_back(static_cast<uint8_t>(sector));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+} // namespace
+
+int decodePart(std::span<const uint8_t> bytes, int part, d64& disk)
+{
+    checkPart(part);
+    checkDisk(disk);
+    size_t position = part == 1 ? 4 : 2;
+    if (bytes.size() < position) {
+        throw std::invalid_argument("Truncated Zipcode part");
+    }
+
+    std::array<uint8_t, SECTOR_SIZE> sector;
+    int written = 0;
+    while (position + 2 <= bytes.size()) {
+        auto mode = bytes[position] & MODE_MASK;
+        int track = bytes[position] & ~MODE_MASK;
+        int sectorNumber = bytes[position + 1];
+        position += 2;
+
+        // another part may be writing the same disk, so stay on the tracks of this one
+        if (track < PART_TRACKS[part - 1] || track >= PART_TRACKS[part] ||
+            sectorNumber >= d64::SECTORS_PER_TRACK[track - 1]) {
+            throw std::invalid_argument("Zipcode sector outside its part");
+        }
+
+        switch (mode) {
+        case MODE_RAW:
+            if (position + SECTOR_SIZE > bytes.size()) {
+                throw std::invalid_argument("Truncated Zipcode sector");
+            }
+            std::copy_n(bytes.begin() + position, SECTOR_SIZE, sector.begin());
+            position += SECTOR_SIZE;
+            break;
+        case MODE_FILL:
+            if (position >= bytes.size()) {
+                throw std::invalid_argument("Truncated Zipcode sector");
+            }
+            sector.fill(bytes[position++]);
+            break;
+        case MODE_RLE: {
+            if (position + 2 > bytes.size() || position + 2 + bytes[position] > bytes.size()) {
+                throw std::invalid_argument("Truncated Zipcode sector");
+            }
+            auto length = bytes[position];
+            unpack(bytes.subspan(position + 2, length), bytes[position + 1], sector);
+            position += 2 + length;
+            break;
+        }
+        default:
+            throw std::invalid_argument("Unknown Zipcode sector mode");
+        }
+
+        disk.writeSector(track, sectorNumber, std::span<const uint8_t>(sector));
+        ++written;
+    }
+    return written;
+}
+
+int decode(const std::array<std::span<const uint8_t>, PARTS>& parts, d64& disk, unsigned threads)
+{
+    std::array<int, PARTS> written{};
+    parallelFor(PARTS, threads, [&](size_t index) {
+        written[index] = decodePart(parts[index], static_cast<int>(index) + 1, disk);
+    });
+    return written[0] + written[1] + written[2] + written[3];
+}
+
+std::array<std::string, PARTS> partNames(const std::string& path)
+{
+    auto file = std::filesystem::path(path);
+    auto name = file.filename().string();
+    if (name.size() < 3 || name[1] != '!' || name[0] < '1' || name[0] > '0' + PARTS) {
+        throw std::invalid_argument("Not a Zipcode file name: " + path);
+    }
+
+    std::array<std::string, PARTS> names;
+    for (auto part = 0; part < PARTS; ++part) {
+        name[0] = static_cast<char>('1' + part);
+        names[part] = (file.parent_path() / name).string();
+    }
+    return names;
+}
+
+int decodeSet(const std::string& path, d64& disk, unsigned threads)
+{
+    auto names = partNames(path);
+    std::array<MappedFile, PARTS> files = {
+        MappedFile(names[0]), MappedFile(names[1]), MappedFile(names[2]), MappedFile(names[3])
+    };
+    std::array<std::span<const uint8_t>, PARTS> parts;
+    for (auto part = 0; part < PARTS; ++part) {
+        if (!files[part].valid()) return 0;
+        parts[part] = files[part].bytes();
+    }
+    return decode(parts, disk, threads);
+}
+
+std::vector<uint8_t> encodePart(d64& disk, int part)
+{
+    checkPart(part);
+    checkDisk(disk);
+    std::vector<uint8_t> out;
+    if (part == 1) {
+        std::array<uint8_t, SECTOR_SIZE> bamSector;
+        disk.readSector(DIRECTORY_TRACK, BAM_SECTOR, bamSector);
+        auto id = offsetof(bam, diskId);
+        out = { FIRST_LOAD_ADDRESS & 0xFF, FIRST_LOAD_ADDRESS >> 8, bamSector[id], bamSector[id + 1] };
+    }
+    else {
+        out = { LOAD_ADDRESS & 0xFF, LOAD_ADDRESS >> 8 };
+    }
+
+    std::array<uint8_t, SECTOR_SIZE> sector;
+    for (auto track = PART_TRACKS[part - 1]; track < PART_TRACKS[part]; ++track) {
+        for (auto number : sectorOrder(d64::SECTORS_PER_TRACK[track - 1])) {
+            disk.readSector(track, number, sector);
+            encodeSector(track, number, sector, out);
+        }
+    }
+    return out;
+}
+
+std::array<std::string, PARTS> encodeSet(d64& disk, const std::string& directory, const std::string& name)
+{
+    std::array<std::string, PARTS> names;
+    for (auto part = 1; part <= PARTS; ++part) {
+        auto path = std::filesystem::path(directory) / (std::to_string(part) + "!" + name);
+        std::ofstream out(path, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Error: Could not open file for writing");
+        }
+        auto bytes = encodePart(disk, part);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        names[part - 1] = path.string();
+    }
+    return names;
+}
+
+std::vector<Conversion> convertBatch(const std::vector<std::string>& sets, const std::string& outputDirectory, unsigned threads)
+{
+    std::vector<Conversion> results(sets.size());
+    parallelFor(sets.size(), threads, [&](size_t index) {
+        auto& conversion = results[index];
+        conversion.set = sets[index];
+        try {
+            // the sets already keep every worker busy, so each one decodes its parts in turn
+            d64 disk;
+            conversion.sectors = decodeSet(sets[index], disk, 1);
+            if (conversion.sectors == 0) {
+                std::cerr << "Error: " << sets[index] << ": not a Zipcode set" << std::endl;
+                return;
+            }
+
+            auto image = std::filesystem::path(outputDirectory) / std::filesystem::path(sets[index]).filename().string().substr(2);
+            image += ".d64";
+            disk.save(image.string());
+            conversion.image = image.string();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << sets[index] << ": " << e.what() << std::endl;
+        }
+    });
+    return results;
+}
+
+} // namespace d64lib::zipcode
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "d64.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace d64lib::zipcode {
+
+inline constexpr int PARTS = 4;
+
+// first track of each part, the last value ends part 4
+inline constexpr std::array<int, PARTS + 1> PART_TRACKS = { 1, 9, 17, 26, TRACKS_35 + 1 };
+
+// the top two bits of the track byte say how the sector is stored
+inline constexpr uint8_t MODE_RAW = 0x00;
+inline constexpr uint8_t MODE_FILL = 0x40;
+inline constexpr uint8_t MODE_RLE = 0x80;
+inline constexpr uint8_t MODE_MASK = 0xC0;
+
+/// <summary>
+/// Decode one part of a Zipcode set and write its sectors to a disk
+/// parts cover disjoint tracks, so different parts can be decoded into the same disk at once
+/// throws std::invalid_argument if the part is damaged or the disk is not a 1541 disk
+/// </summary>
+/// <param name="bytes">contents of the n! file</param>
+/// <param name="part">part number, 1 to 4</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <returns>number of sectors written</returns>
+int decodePart(std::span<const uint8_t> bytes, int part, d64& disk);
+
+/// <summary>
+/// Decode a whole Zipcode set, the four parts in parallel
+/// </summary>
+/// <param name="parts">contents of the 1! to 4! files</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>number of sectors written, a complete disk has 683</returns>
+int decode(const std::array<std::span<const uint8_t>, PARTS>& parts, d64& disk, unsigned threads = 0);
+
+/// <summary>
+/// Names of the four files of a set
+/// </summary>
+/// <param name="path">path of any part, like games/1!pacman</param>
+/// <returns>paths of 1!pacman to 4!pacman</returns>
+std::array<std::string, PARTS> partNames(const std::string& path);
+
+/// <summary>
+/// Memory map and decode the files of a set
+/// </summary>
+/// <param name="path">path of any part</param>
+/// <param name="disk">d64 disk instance to write to</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>number of sectors written, 0 if a part could not be read</returns>
+int decodeSet(const std::string& path, d64& disk, unsigned threads = 0);
+
+/// <summary>
+/// Encode the tracks of one part
+/// throws std::invalid_argument if the disk is not a 1541 disk
+/// </summary>
+/// <param name="disk">d64 disk instance to read</param>
+/// <param name="part">part number, 1 to 4</param>
+/// <returns>contents of the n! file</returns>
+std::vector<uint8_t> encodePart(d64& disk, int part);
+
+/// <summary>
+/// Encode a disk as a set of four files
+/// </summary>
+/// <param name="disk">d64 disk instance to read</param>
+/// <param name="directory">directory for the files</param>
+/// <param name="name">name of the set without the n! prefix</param>
+/// <returns>paths of the files written</returns>
+std::array<std::string, PARTS> encodeSet(d64& disk, const std::string& directory, const std::string& name);
+
+struct Conversion {
+    std::string set;
+    std::string image;          // empty if the set could not be read
+    int sectors = 0;
+};
+
+/// <summary>
+/// Convert many Zipcode sets to disk images in parallel
+/// each set becomes a .d64 named after the set without its prefix
+/// </summary>
+/// <param name="sets">path of one part of each set</param>
+/// <param name="outputDirectory">directory for the .d64 files</param>
+/// <param name="threads">number of worker threads, 0 for one per core</param>
+/// <returns>one result per set in the same order as sets</returns>
+std::vector<Conversion> convertBatch(const std::vector<std::string>& sets, const std::string& outputDirectory, unsigned threads = 0);
+
+} // namespace d64lib::zipcode